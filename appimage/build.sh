@@ -14,6 +14,7 @@ echo "Configuring"
 cd "$BUILD_DIR"
 cmake "$ROOT_DIR" \
   -DCMAKE_BUILD_TYPE=Release \
+  -DWARPQT_BUILD_TESTS=OFF \
   -DCMAKE_INSTALL_PREFIX=/usr
 
 echo "Building"
@@ -0,0 +1,47 @@
+#include "linescanner.h"
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <cstdlib>
+
+// Feeds a long synthetic "warp-cli settings" output through LineScanner in pipe sized chunks,
+// with the wanted lines at the very end so every byte is scanned.
+// usage: bench_linescanner [lines]
+int main(int argc, char **argv) {
+    const int lines = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    if (lines <= 0)
+        return 2;
+
+    QByteArray output;
+    output.reserve(lines * 48 + 64);
+    for (int i = 0; i < lines; ++i)
+        output += "  Excluded host: host" + QByteArray::number(i) + ".corp.example.com\n";
+    output += "Mode: WarpProxy\tPort: 40000\nAlways On: true";
+
+    QTextStream out(stdout);
+    constexpr int kChunk = 65536;
+    constexpr int kRounds = 5;
+    qint64 bestNs = -1;
+    for (int round = 0; round < kRounds; ++round) {
+        LineScanner scanner;
+        const int mode = scanner.addField("Mode:");
+        const int always = scanner.addField("Always On:");
+        QElapsedTimer timer;
+        timer.start();
+        for (int pos = 0; pos < output.size(); pos += kChunk)
+            scanner.feed(output.constData() + pos, qMin(kChunk, static_cast<int>(output.size()) - pos));
+        scanner.finish();
+        const qint64 ns = timer.nsecsElapsed();
+        if (scanner.line(mode).isEmpty() || scanner.line(always).isEmpty()) {
+            out << "scanner missed a field\n";
+            return 1;
+        }
+        if (bestNs < 0 || ns < bestNs)
+            bestNs = ns;
+    }
+
+    const double secs = qMax<qint64>(bestNs, 1) / 1e9;
+    out << "lines: " << lines << "  bytes: " << output.size() << "\n";
+    out << "best of " << kRounds << ": " << bestNs / 1000 << " us, "
+        << QString::number(output.size() / secs / (1024.0 * 1024.0), 'f', 1) << " MiB/s\n";
+    return 0;
+}
@@ -0,0 +1,83 @@
+#include "splittunnel.h"
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <cstdlib>
+
+namespace {
+    // fixed seed, every run plans the same lists
+    quint32 nextRandom(quint32 &state) {
+        state = state * 1664525u + 1013904223u;
+        return state;
+    }
+
+    QString ipv4(quint32 addr, int prefixLen) {
+        return QString("%1.%2.%3.%4/%5")
+                .arg(addr >> 24).arg((addr >> 16) & 0xff).arg((addr >> 8) & 0xff).arg(addr & 0xff)
+                .arg(prefixLen);
+    }
+}
+
+// Plans a sync of a large generated exclusion list against a daemon list that shares about
+// half of it. Every fourth range comes with its sibling so aggregation has work to do, and
+// a tenth of the entries are host names.
+// usage: bench_splittunnel [entries]
+int main(int argc, char **argv) {
+    const int entries = argc > 1 ? std::atoi(argv[1]) : 50000;
+    if (entries <= 0)
+        return 2;
+
+    quint32 seed = 0x5eed;
+    QStringList import;
+    QString ipList = QStringLiteral("Excluded IPs:\n");
+    QString hostList = QStringLiteral("Excluded hosts:\n");
+    import.reserve(entries);
+    while (import.size() < entries) {
+        const int i = import.size();
+        const quint32 r = nextRandom(seed);
+        QString entry;
+        if (i % 10 == 9) {
+            entry = QString("host%1.corp.example.com").arg(r % 1000000);
+            if (r & 1)
+                hostList += "  " + entry + "\n";
+        } else {
+            const int prefixLen = 16 + static_cast<int>(r % 17);
+            const quint32 mask = ~0u << (32 - prefixLen);
+            const quint32 addr = nextRandom(seed) & mask;
+            entry = ipv4(addr, prefixLen);
+            if (i % 4 == 0 && import.size() + 1 < entries)
+                import << ipv4(addr ^ (1u << (32 - prefixLen)), prefixLen);
+            if (r & 1)
+                ipList += "  " + entry + "\n";
+        }
+        import << entry;
+    }
+    // stale daemon entries the plan has to remove
+    for (int i = 0; i < entries / 20; ++i)
+        ipList += "  " + ipv4(0xc0a80000u | (static_cast<quint32>(i) << 8), 24) + "\n";
+
+    QTextStream out(stdout);
+    constexpr int kRounds = 5;
+    qint64 bestNs = -1;
+    SplitTunnel::Plan plan;
+    int commands = 0;
+    for (int round = 0; round < kRounds; ++round) {
+        QElapsedTimer timer;
+        timer.start();
+        plan = SplitTunnel::plan(import, ipList, hostList);
+        commands = SplitTunnel::commands(plan).size();
+        const qint64 ns = timer.nsecsElapsed();
+        if (bestNs < 0 || ns < bestNs)
+            bestNs = ns;
+    }
+    if (plan.importedEntries != import.size()) {
+        out << "plan dropped entries: " << plan.importedEntries << " of " << import.size() << "\n";
+        return 1;
+    }
+
+    out << "entries: " << plan.importedEntries << "  aggregated ranges: " << plan.aggregatedIps << "\n";
+    out << "add: " << plan.addIps.size() << " ip, " << plan.addHosts.size() << " host  remove: "
+        << plan.removeIps.size() << " ip, " << plan.removeHosts.size() << " host  commands: " << commands << "\n";
+    out << "best of " << kRounds << ": " << bestNs / 1000 << " us ("
+        << QString::number(bestNs / 1000.0 / plan.importedEntries, 'f', 2) << " us per entry)\n";
+    return 0;
+}
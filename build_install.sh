@@ -5,6 +5,7 @@ rm -rf build
 
 cmake -S . -B build \
   -DCMAKE_BUILD_TYPE=MinSizeRel \
+  -DWARPQT_BUILD_TESTS=OFF \
   -DCMAKE_INTERPROCEDURAL_OPTIMIZATION=ON \
   -DCMAKE_CXX_FLAGS_MINSIZEREL="-Os -DNDEBUG"
 
@@ -0,0 +1,98 @@
+#!/bin/bash
+# Builds the default release, an instrumented build, runs the scripted training workload
+# against stub warp-cli/ip/systemctl, rebuilds with the profile and compares the three.
+#
+#   pgo/train.sh [runs]        (default 3 training runs)
+#
+# Output: build-pgo/report.txt
+set -euo pipefail
+
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+OUT="$ROOT/build-pgo"
+RUNS="${1:-3}"
+BIN=cloudflare-warp-qt
+
+rm -rf "$OUT"
+mkdir -p "$OUT"
+PROFILE_DIR="$OUT/profile"
+
+# a throwaway home so training never touches the real config, history or lock file
+SANDBOX="$(mktemp -d)"
+trap 'rm -rf "$SANDBOX"' EXIT
+export XDG_CONFIG_HOME="$SANDBOX/config" XDG_DATA_HOME="$SANDBOX/data" XDG_CACHE_HOME="$SANDBOX/cache"
+export TMPDIR="$SANDBOX" WARPQT_STUB_STATE="$SANDBOX/stub"
+export PATH="$ROOT/pgo/stubs:$PATH"
+export QT_QPA_PLATFORM="${QT_QPA_PLATFORM:-offscreen}"
+mkdir -p "$WARPQT_STUB_STATE"
+
+configure_build() { # dir, extra cmake args...
+  local dir="$1"; shift
+  cmake -S "$ROOT" -B "$dir" -DCMAKE_BUILD_TYPE=Release -DWARPQT_BUILD_TESTS=OFF "$@" >/dev/null
+  cmake --build "$dir" --parallel "$(nproc)" >/dev/null
+}
+
+echo "== default release build"
+configure_build "$OUT/default"
+
+echo "== instrumented build"
+configure_build "$OUT/generate" -DWARPQT_OPTIMIZED=ON -DWARPQT_PGO=GENERATE -DWARPQT_PGO_DIR="$PROFILE_DIR"
+
+echo "== training ($RUNS runs)"
+for i in $(seq "$RUNS"); do
+  rm -f "$WARPQT_STUB_STATE/connected"
+  "$OUT/generate/$BIN" --pgo-train
+  # the popup path is trained above, the headless ones are cheap to add
+  "$OUT/generate/$BIN" --status >/dev/null || true
+done
+
+# clang writes raw profiles that have to be merged, gcc reads its .gcda files directly
+if compgen -G "$PROFILE_DIR/*.profraw" >/dev/null; then
+  llvm-profdata merge -output="$PROFILE_DIR/merged.profdata" "$PROFILE_DIR"/*.profraw
+fi
+
+echo "== optimized build with profile"
+configure_build "$OUT/use" -DWARPQT_OPTIMIZED=ON -DWARPQT_PGO=USE -DWARPQT_PGO_DIR="$PROFILE_DIR"
+
+# size of the stripped binary, like `cmake --install --strip` ships it
+stripped_size() {
+  strip -o "$SANDBOX/stripped" "$1"
+  stat -c %s "$SANDBOX/stripped"
+}
+
+# only root can drop the page cache, everyone else measures with the binary and Qt already cached
+if [ "$(id -u)" = 0 ]; then
+  START=cold
+else
+  START=warm
+fi
+
+# median wall time from exec to the first event loop pass
+startup_ms() {
+  local bin="$1" samples=()
+  for _ in 1 2 3 4 5 6 7; do
+    if [ "$START" = cold ]; then
+      sync
+      echo 3 > /proc/sys/vm/drop_caches
+    fi
+    samples+=("$("$bin" --measure-startup 0 | sed -n 's/.*startup_ms=\([0-9]*\).*/\1/p')")
+  done
+  printf '%s\n' "${samples[@]}" | sort -n | sed -n 4p
+}
+
+idle_rss_kb() {
+  "$1" --measure-startup 5000 | sed -n 's/^idle_rss_kb=//p'
+}
+
+{
+  printf '%-10s %14s %14s %14s\n' build "stripped bytes" "$START start ms" "idle RSS KiB"
+  # the instrumented build is left out, its numbers are meaningless
+  for build in default use; do
+    bin="$OUT/$build/$BIN"
+    printf '%-10s %14s %14s %14s\n' "$build" "$(stripped_size "$bin")" "$(startup_ms "$bin")" "$(idle_rss_kb "$bin")"
+  done
+  echo
+  echo "default: CMAKE_BUILD_TYPE=Release"
+  echo "use:     Release + WARPQT_OPTIMIZED (LTO, section GC, hidden visibility) + PGO ($RUNS training runs)"
+  echo "$START start: median of 7, page cache $([ "$START" = cold ] && echo "dropped before each run" || echo "warm, run as root for cold starts")"
+  echo "QPA: $QT_QPA_PLATFORM, compiler: $(cmake -LA -N "$OUT/use" | sed -n 's/^CMAKE_CXX_COMPILER:[^=]*=//p')"
+} | tee "$OUT/report.txt"
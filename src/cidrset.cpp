@@ -0,0 +1,151 @@
+#include "cidrset.h"
+#include <arpa/inet.h>
+#include <cstring>
+#include <sys/socket.h>
+
+namespace {
+    inline int bitAt(const uint8_t *addr, int i) {
+        return (addr[i / 8] >> (7 - i % 8)) & 1;
+    }
+
+    inline void setBit(uint8_t *addr, int i, int value) {
+        const uint8_t mask = static_cast<uint8_t>(1u << (7 - i % 8));
+        if (value)
+            addr[i / 8] |= mask;
+        else
+            addr[i / 8] &= static_cast<uint8_t>(~mask);
+    }
+} // namespace
+
+bool CidrSet::parse(const QString &entry, int &family, uint8_t addr[16], int &prefixLen) {
+    const QString trimmed = entry.trimmed();
+    const int slash = trimmed.indexOf('/');
+    const QByteArray host = (slash < 0 ? trimmed : trimmed.left(slash)).toLatin1();
+
+    std::memset(addr, 0, 16);
+    int maxLen;
+    if (inet_pton(AF_INET, host.constData(), addr) == 1) {
+        family = AF_INET;
+        maxLen = 32;
+    } else if (inet_pton(AF_INET6, host.constData(), addr) == 1) {
+        family = AF_INET6;
+        maxLen = 128;
+    } else {
+        return false;
+    }
+
+    prefixLen = maxLen;
+    if (slash >= 0) {
+        bool ok = false;
+        prefixLen = trimmed.mid(slash + 1).toInt(&ok);
+        if (!ok || prefixLen < 0 || prefixLen > maxLen)
+            return false;
+    }
+    // clear host bits so 10.1.2.3/8 and 10.0.0.0/8 are the same prefix
+    for (int i = prefixLen; i < maxLen; ++i)
+        setBit(addr, i, 0);
+    return true;
+}
+
+bool CidrSet::add(const QString &entry) {
+    int family;
+    uint8_t addr[16];
+    int prefixLen;
+    if (!parse(entry, family, addr, prefixLen))
+        return false;
+    (family == AF_INET ? v4 : v6).insert(addr, prefixLen);
+    ++count;
+    return true;
+}
+
+int CidrSet::inserted() const {
+    return count;
+}
+
+QStringList CidrSet::aggregated() {
+    QStringList out;
+    uint8_t addr[16];
+    if (!v4.nodes.empty()) {
+        v4.collapse(0);
+        std::memset(addr, 0, sizeof(addr));
+        v4.collect(0, addr, 0, AF_INET, out);
+    }
+    if (!v6.nodes.empty()) {
+        v6.collapse(0);
+        std::memset(addr, 0, sizeof(addr));
+        v6.collect(0, addr, 0, AF_INET6, out);
+    }
+    return out;
+}
+
+QString CidrSet::canonical(const QString &entry) {
+    int family;
+    uint8_t addr[16];
+    int prefixLen;
+    if (!parse(entry, family, addr, prefixLen))
+        return QString();
+    return format(family, addr, prefixLen);
+}
+
+QString CidrSet::format(int family, const uint8_t *addr, int prefixLen) {
+    char buf[INET6_ADDRSTRLEN];
+    if (!inet_ntop(family, addr, buf, sizeof(buf)))
+        return QString();
+    return QString::fromLatin1(buf) + QLatin1Char('/') + QString::number(prefixLen);
+}
+
+void CidrSet::Trie::insert(const uint8_t *addr, int prefixLen) {
+    if (nodes.empty())
+        nodes.emplace_back();
+    int32_t idx = 0;
+    for (int depth = 0; depth < prefixLen; ++depth) {
+        if (nodes[idx].full)
+            return; // a shorter prefix already covers this one
+        const int bit = bitAt(addr, depth);
+        int32_t next = nodes[idx].child[bit];
+        if (next < 0) {
+            next = static_cast<int32_t>(nodes.size());
+            nodes.emplace_back();
+            nodes[idx].child[bit] = next;
+        }
+        idx = next;
+    }
+    // anything below is now redundant, orphaned nodes are simply never visited
+    nodes[idx].full = true;
+    nodes[idx].child[0] = -1;
+    nodes[idx].child[1] = -1;
+}
+
+bool CidrSet::Trie::collapse(int32_t idx) {
+    Node &node = nodes[idx];
+    if (node.full)
+        return true;
+    const int32_t left = node.child[0];
+    const int32_t right = node.child[1];
+    // evaluate both sides, merges can happen deep in either one
+    const bool leftFull = left >= 0 && collapse(left);
+    const bool rightFull = right >= 0 && collapse(right);
+    if (leftFull && rightFull) {
+        // collapse() never grows the vector so the reference is still valid
+        node.full = true;
+        node.child[0] = -1;
+        node.child[1] = -1;
+        return true;
+    }
+    return false;
+}
+
+void CidrSet::Trie::collect(int32_t idx, uint8_t *addr, int depth, int family, QStringList &out) const {
+    const Node &node = nodes[idx];
+    if (node.full) {
+        out << format(family, addr, depth);
+        return;
+    }
+    for (int bit = 0; bit < 2; ++bit) {
+        if (node.child[bit] < 0)
+            continue;
+        setBit(addr, depth, bit);
+        collect(node.child[bit], addr, depth + 1, family, out);
+        setBit(addr, depth, 0);
+    }
+}
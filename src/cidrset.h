@@ -0,0 +1,50 @@
+#ifndef CIDRSET_H
+#define CIDRSET_H
+
+#include <QString>
+#include <QStringList>
+#include <cstdint>
+#include <vector>
+
+// Set of IPv4/IPv6 prefixes kept in a binary prefix trie. Inserting a prefix that is
+// already covered is a no-op, and aggregated() merges sibling halves bottom-up, so
+// overlapping and adjacent ranges come out as the minimal equivalent list.
+class CidrSet {
+public:
+    // "10.0.0.0/8", "192.168.1.7", "2001:db8::/32"; false if entry is not an address
+    bool add(const QString &entry);
+
+    // minimal canonical list, IPv4 first, host bits cleared
+    QStringList aggregated();
+
+    int inserted() const;
+
+    // canonical "addr/len" form of one entry, empty if it does not parse
+    static QString canonical(const QString &entry);
+
+    static bool parse(const QString &entry, int &family, uint8_t addr[16], int &prefixLen);
+
+private:
+    struct Node {
+        int32_t child[2] = {-1, -1};
+        bool full = false;
+    };
+
+    struct Trie {
+        std::vector<Node> nodes;
+
+        void insert(const uint8_t *addr, int prefixLen);
+
+        bool collapse(int32_t idx);
+
+        void collect(int32_t idx, uint8_t *addr, int depth, int family, QStringList &out) const;
+    };
+
+    static QString format(int family, const uint8_t *addr, int prefixLen);
+
+    Trie v4;
+    Trie v6;
+    int count = 0;
+};
+
+#endif // CIDRSET_H
@@ -0,0 +1,147 @@
+#include "commandbatch.h"
+#include "commandtranscript.h"
+#include "mainfunctions.h"
+#include <QProcess>
+#include <QTimer>
+
+static constexpr int kMaxFailureMessages = 5;
+
+CommandBatch::CommandBatch(QObject *parent)
+    : QObject(parent), nextIndex(0), running(0), done(0), failed(0), maxConcurrency(4), timeoutMs(15000),
+      cancelled(false) {
+}
+
+void CommandBatch::setMaxConcurrency(int n) {
+    maxConcurrency = qMax(1, n);
+}
+
+void CommandBatch::setTimeoutMs(int ms) {
+    timeoutMs = ms;
+}
+
+void CommandBatch::start(const QVector<Command> &commands) {
+    if (isRunning())
+        return;
+    queue = commands;
+    nextIndex = 0;
+    done = 0;
+    failed = 0;
+    cancelled = false;
+    failureMessages.clear();
+    if (queue.isEmpty()) {
+        emit finished(false);
+        return;
+    }
+    launchMore();
+}
+
+void CommandBatch::cancel() {
+    if (!isRunning())
+        return;
+    cancelled = true;
+    nextIndex = queue.size(); // stop launching, running ones are killed below
+    for (QProcess *process : findChildren<QProcess *>())
+        process->kill();
+}
+
+bool CommandBatch::isRunning() const {
+    return running > 0 || nextIndex < queue.size();
+}
+
+int CommandBatch::failedCount() const {
+    return failed;
+}
+
+QStringList CommandBatch::failures() const {
+    return failureMessages;
+}
+
+void CommandBatch::launchMore() {
+    while (running < maxConcurrency && nextIndex < queue.size()) {
+        const int index = nextIndex++;
+        ++running;
+        if (CommandTranscript::isReplaying()) {
+            replayNext(index);
+            continue;
+        }
+
+        const Command &cmd = queue.at(index);
+        auto process = new QProcess(this);
+        Launched &info = launched[process];
+        info.index = index;
+        info.clock.start();
+
+        connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this,
+                [this, process](int exitCode, QProcess::ExitStatus status) {
+                    onProcessDone(process, status == QProcess::NormalExit ? exitCode : -1, QString());
+                });
+        connect(process, &QProcess::errorOccurred, this, [this, process](QProcess::ProcessError error) {
+            // finished() is not emitted when the program could not be started at all
+            if (error == QProcess::FailedToStart)
+                onProcessDone(process, MainFunctions::kExitFailedToStart, process->errorString());
+        });
+        QTimer::singleShot(timeoutMs, process, [this, process]() {
+            auto it = launched.find(process);
+            if (it != launched.end())
+                it->timedOut = true;
+            process->kill();
+        });
+
+        process->start(cmd.program, cmd.arguments);
+    }
+}
+
+void CommandBatch::replayNext(int index) {
+    const Command &cmd = queue.at(index);
+    CommandTranscript::Entry entry;
+    const bool found = CommandTranscript::take(cmd.program, cmd.arguments, entry);
+    // still asynchronous and paced like the real command, but nothing reaches the daemon
+    QTimer::singleShot(found ? CommandTranscript::replayDelayMs(entry) : 0, this, [this, index, found, entry]() {
+        if (!found) {
+            onCommandDone(index, false, QStringLiteral("Not in the replayed transcript"));
+            return;
+        }
+        const bool ok = !entry.timedOut && entry.exitCode == 0;
+        onCommandDone(index, ok, ok ? QString() : QString::fromUtf8(entry.err).trimmed());
+    });
+}
+
+void CommandBatch::onProcessDone(QProcess *process, int exitCode, const QString &error) {
+    const Launched info = launched.take(process);
+    CommandTranscript::Entry entry;
+    entry.exitCode = info.timedOut ? -1 : exitCode;
+    entry.timedOut = info.timedOut;
+    entry.out = process->readAllStandardOutput();
+    entry.err = error.isEmpty() ? process->readAllStandardError() : error.toUtf8();
+    process->disconnect(this);
+    process->deleteLater();
+    const bool ok = !entry.timedOut && entry.exitCode == 0;
+    const QString message = ok ? QString()
+                               : entry.timedOut ? QStringLiteral("timed out")
+                                                : QString::fromUtf8(entry.err).trimmed();
+    if (CommandTranscript::isRecording()) {
+        entry.program = queue.at(info.index).program;
+        entry.arguments = queue.at(info.index).arguments;
+        entry.latencyMs = static_cast<quint32>(info.clock.elapsed());
+        CommandTranscript::record(std::move(entry));
+    }
+    onCommandDone(info.index, ok, message);
+}
+
+void CommandBatch::onCommandDone(int index, bool ok, const QString &error) {
+    const Command &cmd = queue.at(index);
+    const QString what = cmd.program + QLatin1Char(' ') + cmd.arguments.join(QLatin1Char(' '));
+    --running;
+    ++done;
+    if (!ok && !cancelled) {
+        ++failed;
+        if (failureMessages.size() < kMaxFailureMessages)
+            failureMessages << (error.isEmpty() ? what : what + ": " + error);
+    }
+    emit progress(done, queue.size());
+
+    if (!cancelled)
+        launchMore();
+    if (running == 0 && nextIndex >= queue.size())
+        emit finished(cancelled);
+}
@@ -0,0 +1,73 @@
+#ifndef COMMANDBATCH_H
+#define COMMANDBATCH_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QStringList>
+#include <QVector>
+
+class QProcess;
+
+// Runs a list of commands as child processes, at most maxConcurrency at a time,
+// entirely on the event loop. Used for bulk warp-cli edits. Takes part in command
+// transcripts: recorded like any other command, answered from the transcript on replay.
+class CommandBatch : public QObject {
+    Q_OBJECT
+
+public:
+    struct Command {
+        QString program;
+        QStringList arguments;
+    };
+
+    explicit CommandBatch(QObject *parent = nullptr);
+
+    void setMaxConcurrency(int n);
+
+    void setTimeoutMs(int ms);
+
+    void start(const QVector<Command> &commands);
+
+    void cancel();
+
+    bool isRunning() const;
+
+    int failedCount() const;
+
+    // first few failure messages, for the summary
+    QStringList failures() const;
+
+signals:
+    void progress(int done, int total);
+
+    void finished(bool cancelled);
+
+private:
+    struct Launched {
+        int index = 0;
+        QElapsedTimer clock;
+        bool timedOut = false;
+    };
+
+    void launchMore();
+
+    void replayNext(int index);
+
+    void onProcessDone(QProcess *process, int exitCode, const QString &error);
+
+    void onCommandDone(int index, bool ok, const QString &error);
+
+    QVector<Command> queue;
+    QHash<QProcess *, Launched> launched;
+    int nextIndex;
+    int running;
+    int done;
+    int failed;
+    int maxConcurrency;
+    int timeoutMs;
+    bool cancelled;
+    QStringList failureMessages;
+};
+
+#endif // COMMANDBATCH_H
@@ -0,0 +1,188 @@
+#include "commandtranscript.h"
+#include <QDataStream>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+
+static constexpr quint32 kTranscriptMagic = 0x57515431; // "WQT1"
+// outputs below this are stored as is, qCompress only pays off on longer ones
+static constexpr int kCompressMinBytes = 256;
+
+namespace {
+    enum EntryFlags : quint8 {
+        TimedOut = 0x01,
+        OutCompressed = 0x02,
+        ErrCompressed = 0x04,
+        Scan = 0x08
+    };
+
+    QString commandKey(const QString &program, const QStringList &arguments, bool scan) {
+        // a scan's cut off output must not answer a full run of the same command
+        return (scan ? QStringLiteral("scan") : QStringLiteral("run")) + QChar(0) + program + QChar(0)
+               + arguments.join(QChar(0));
+    }
+
+    QByteArray packBlob(const QByteArray &data) {
+        return data.size() >= kCompressMinBytes ? qCompress(data) : data;
+    }
+
+    QByteArray readBlob(QDataStream &in, quint8 flags, quint8 compressedFlag) {
+        QByteArray data;
+        in >> data;
+        return (flags & compressedFlag) ? qUncompress(data) : data;
+    }
+
+    struct State {
+        QMutex mutex;
+        QFile recordFile;
+        QElapsedTimer recordClock;
+        bool recording = false;
+
+        bool replaying = false;
+        double speed = 1.0;
+        // per command, in recorded order
+        QHash<QString, QVector<CommandTranscript::Entry>> replayQueues;
+        QHash<QString, int> replayNext;
+
+        State() {
+            const QString replayPath = qEnvironmentVariable("WARPQT_REPLAY");
+            if (!replayPath.isEmpty()) {
+                bool ok = false;
+                const QVector<CommandTranscript::Entry> entries = CommandTranscript::load(replayPath, &ok);
+                if (!ok)
+                    qWarning() << "transcript: cannot read" << replayPath << ", replaying nothing";
+                for (const CommandTranscript::Entry &e : entries)
+                    replayQueues[commandKey(e.program, e.arguments, e.scan)].append(e);
+                replaying = true;
+                if (qEnvironmentVariableIsSet("WARPQT_REPLAY_SPEED"))
+                    speed = qMax(0.0, qEnvironmentVariable("WARPQT_REPLAY_SPEED").toDouble());
+                qDebug() << "transcript: replaying" << entries.size() << "commands from" << replayPath
+                         << "at speed" << speed;
+                // replaying and recording the replay at once is of no use
+                return;
+            }
+
+            const QString recordPath = qEnvironmentVariable("WARPQT_RECORD");
+            if (recordPath.isEmpty())
+                return;
+            recordFile.setFileName(recordPath);
+            if (!recordFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+                qWarning() << "transcript: cannot write" << recordPath;
+                return;
+            }
+            QDataStream out(&recordFile);
+            out.setVersion(QDataStream::Qt_5_12);
+            out << kTranscriptMagic;
+            recordFile.flush();
+            recordClock.start();
+            recording = true;
+            qDebug() << "transcript: recording commands to" << recordPath;
+        }
+    };
+
+    State &state() {
+        static State s;
+        return s;
+    }
+} // namespace
+
+bool CommandTranscript::isRecording() {
+    return state().recording;
+}
+
+bool CommandTranscript::isReplaying() {
+    return state().replaying;
+}
+
+void CommandTranscript::record(Entry entry) {
+    State &s = state();
+    if (!s.recording)
+        return;
+    QMutexLocker lock(&s.mutex);
+    entry.offsetMs = static_cast<quint64>(s.recordClock.elapsed());
+
+    // one record is built in memory and written at once, a crash loses at most the last one
+    quint8 flags = entry.timedOut ? TimedOut : 0;
+    if (entry.scan)
+        flags |= Scan;
+    if (entry.out.size() >= kCompressMinBytes)
+        flags |= OutCompressed;
+    if (entry.err.size() >= kCompressMinBytes)
+        flags |= ErrCompressed;
+    QByteArray buf;
+    QDataStream out(&buf, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_12);
+    out << entry.program << entry.arguments << static_cast<qint32>(entry.exitCode) << flags << entry.latencyMs
+        << entry.offsetMs << packBlob(entry.out) << packBlob(entry.err);
+
+    s.recordFile.write(buf);
+    s.recordFile.flush();
+}
+
+bool CommandTranscript::replay(const QString &program, const QStringList &arguments, Entry &out, bool scan) {
+    if (!take(program, arguments, out, scan))
+        return false;
+    // the caller blocks like it would on the real command
+    const int delay = replayDelayMs(out);
+    if (delay > 0)
+        QThread::msleep(static_cast<unsigned long>(delay));
+    return true;
+}
+
+bool CommandTranscript::take(const QString &program, const QStringList &arguments, Entry &out, bool scan) {
+    State &s = state();
+    QMutexLocker lock(&s.mutex);
+    const QString key = commandKey(program, arguments, scan);
+    auto it = s.replayQueues.constFind(key);
+    if (it == s.replayQueues.constEnd() || it->isEmpty())
+        return false;
+    int &next = s.replayNext[key];
+    out = it->at(qMin(next, it->size() - 1));
+    if (next < it->size() - 1)
+        ++next;
+    return true;
+}
+
+int CommandTranscript::replayDelayMs(const Entry &entry) {
+    // set once before any command runs, no lock needed
+    const double speed = state().speed;
+    return speed > 0.0 ? static_cast<int>(entry.latencyMs / speed) : 0;
+}
+
+QVector<CommandTranscript::Entry> CommandTranscript::load(const QString &path, bool *ok) {
+    QVector<Entry> entries;
+    if (ok)
+        *ok = false;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return entries;
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_12);
+    quint32 magic = 0;
+    in >> magic;
+    if (magic != kTranscriptMagic)
+        return entries;
+
+    while (!in.atEnd()) {
+        Entry e;
+        qint32 exitCode = -1;
+        quint8 flags = 0;
+        in >> e.program >> e.arguments >> exitCode >> flags >> e.latencyMs >> e.offsetMs;
+        e.exitCode = exitCode;
+        e.timedOut = flags & TimedOut;
+        e.scan = flags & Scan;
+        e.out = readBlob(in, flags, OutCompressed);
+        e.err = readBlob(in, flags, ErrCompressed);
+        // a record torn by a crash ends the transcript, everything before it is fine
+        if (in.status() != QDataStream::Ok)
+            break;
+        entries.append(e);
+    }
+    if (ok)
+        *ok = true;
+    return entries;
+}
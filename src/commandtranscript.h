@@ -0,0 +1,53 @@
+#ifndef COMMANDTRANSCRIPT_H
+#define COMMANDTRANSCRIPT_H
+
+#include <QByteArray>
+#include <QStringList>
+#include <QVector>
+
+// Record and replay of external commands (warp-cli, systemctl, ip), so output and timing of a
+// particular warp-cli version can be captured on a user's machine and served back offline.
+// Besides the blocking runners in MainFunctions, CommandBatch and DiagnosticsBundle take part,
+// so a replayed split tunnel import doesn't edit the real daemon's configuration.
+//
+//   WARPQT_RECORD=<file>        append every command run to a transcript
+//   WARPQT_REPLAY=<file>        serve commands from a transcript instead of running them
+//   WARPQT_REPLAY_SPEED=<n>     1 keeps the recorded latency (default), 10 is ten times faster,
+//                               0 answers at once
+//
+// Replayed commands are matched on program, arguments and whether they were scanned, and served
+// in recorded order, the last answer repeats once a command's recordings run out. Thread-safe.
+namespace CommandTranscript {
+    struct Entry {
+        QString program;
+        QStringList arguments;
+        int exitCode = -1;
+        bool timedOut = false;
+        QByteArray out; // raw, before decoding and trimming
+        QByteArray err;
+        quint32 latencyMs = 0;
+        quint64 offsetMs = 0; // since the recording started
+        // a scan stopped early, out holds only what it consumed; never served to a full run
+        bool scan = false;
+    };
+
+    bool isRecording();
+
+    bool isReplaying();
+
+    void record(Entry entry);
+
+    // false if the transcript never saw this command; sleeps for the (scaled) recorded latency
+    bool replay(const QString &program, const QStringList &arguments, Entry &out, bool scan = false);
+
+    // the next answer without the wait, for callers on the event loop
+    bool take(const QString &program, const QStringList &arguments, Entry &out, bool scan = false);
+
+    // the recorded latency scaled by WARPQT_REPLAY_SPEED
+    int replayDelayMs(const Entry &entry);
+
+    // the whole file, for tools and benchmarks that walk a corpus
+    QVector<Entry> load(const QString &path, bool *ok = nullptr);
+}
+
+#endif // COMMANDTRANSCRIPT_H
@@ -0,0 +1,340 @@
+#include "daemonmonitor.h"
+#include "ifacecounters.h"
+#include "settingsstore.h"
+#include "throughputmonitor.h"
+#include <QDebug>
+#include <QDir>
+#include <QSocketNotifier>
+#include <QTimer>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static constexpr int kSampleMs = 5000;
+// how long the CPU has to stay over the limit before it is worth a notification
+static constexpr int kCpuHotSamples = 6;
+// trend columns in the diagnostics readout, the latest two minutes
+static constexpr int kSparkSamples = 24;
+
+namespace {
+    const char kComm[] = "warp-svc";
+
+    int openProc(qint64 pid, const char *file) {
+        char path[48];
+        std::snprintf(path, sizeof(path), "/proc/%lld/%s", static_cast<long long>(pid), file);
+        return ::open(path, O_RDONLY | O_CLOEXEC);
+    }
+
+    // whole file from offset 0, NUL terminated; the descriptors stay open so pread is a must
+    ssize_t readAt(int fd, char *buf, size_t size) {
+        if (fd < 0)
+            return -1;
+        const ssize_t n = ::pread(fd, buf, size - 1, 0);
+        if (n >= 0)
+            buf[n] = '\0';
+        return n;
+    }
+
+    // a walk over /proc, only while the daemon isn't running (or before we found it)
+    qint64 findDaemon() {
+        const QStringList entries = QDir("/proc").entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+        for (const QString &entry : entries) {
+            bool numeric = false;
+            const qint64 pid = entry.toLongLong(&numeric);
+            if (!numeric)
+                continue;
+            const int fd = openProc(pid, "comm");
+            char comm[32];
+            const ssize_t n = readAt(fd, comm, sizeof(comm));
+            if (fd >= 0)
+                ::close(fd);
+            if (n > 0 && std::strncmp(comm, kComm, sizeof(kComm) - 1) == 0 && comm[sizeof(kComm) - 1] == '\n')
+                return pid;
+        }
+        return -1;
+    }
+
+    // -1 on kernels before 5.3 or headers without the syscall
+    int pidfdOpen(qint64 pid) {
+#ifdef SYS_pidfd_open
+        return static_cast<int>(::syscall(SYS_pidfd_open, static_cast<pid_t>(pid), 0));
+#else
+        Q_UNUSED(pid)
+        errno = ENOSYS;
+        return -1;
+#endif
+    }
+
+    quint64 ioField(const char *text, const char *name) {
+        const char *p = std::strstr(text, name);
+        return p ? std::strtoull(p + std::strlen(name), nullptr, 10) : 0;
+    }
+
+    QString mib(qint64 bytes) {
+        return QString::number(bytes / (1024.0 * 1024.0), 'f', 1) + " MiB";
+    }
+
+    // one block character per sample, scaled between the lowest and highest shown
+    template<typename Get>
+    QString sparkline(const DaemonMonitor::Ring &ring, Get get) {
+        static const QString kBlocks = QString::fromUtf8("▁▂▃▄▅▆▇█");
+        const int count = static_cast<int>(ring.size());
+        const int first = qMax(0, count - kSparkSamples);
+        double lo = 0, hi = 0;
+        for (int i = first; i < count; ++i) {
+            const double v = get(ring.at(i));
+            lo = i == first ? v : qMin(lo, v);
+            hi = i == first ? v : qMax(hi, v);
+        }
+        QString line;
+        for (int i = first; i < count; ++i) {
+            const double v = get(ring.at(i));
+            const int level = hi > lo ? static_cast<int>((v - lo) / (hi - lo) * (kBlocks.size() - 1) + 0.5) : 0;
+            line += kBlocks.at(level);
+        }
+        return line;
+    }
+} // namespace
+
+DaemonMonitor::DaemonMonitor(QObject *parent)
+    : QObject(parent), daemonPid(-1), pidfd(-1), exitNotifier(nullptr), statFd(-1), statmFd(-1), ioFd(-1),
+      timer(new QTimer(this)), haveLast(false), cpuHotSamples(0), cpuWarned(false), rssWarned(false),
+      suspended(false) {
+    timer->setInterval(kSampleMs);
+    timer->setTimerType(Qt::VeryCoarseTimer);
+    connect(timer, &QTimer::timeout, this, &DaemonMonitor::sample);
+}
+
+DaemonMonitor::~DaemonMonitor() {
+    detach();
+}
+
+void DaemonMonitor::start() {
+    if (timer->isActive() || suspended)
+        return;
+    attach();
+    // samples while attached, looks for the daemon again while not
+    timer->start();
+}
+
+void DaemonMonitor::setPaused(bool paused) {
+    if (paused) {
+        if (!timer->isActive())
+            return;
+        timer->stop();
+        suspended = true;
+        return;
+    }
+    if (!suspended)
+        return;
+    suspended = false;
+    // the first CPU delta would be averaged over the whole pause
+    haveLast = false;
+    cpuHotSamples = 0;
+    timer->start();
+}
+
+qint64 DaemonMonitor::pid() const {
+    return daemonPid;
+}
+
+const DaemonMonitor::Ring &DaemonMonitor::samples() const {
+    return ring;
+}
+
+QString DaemonMonitor::summary() const {
+    if (daemonPid < 0)
+        return QStringLiteral("warp-svc is not running");
+    if (ring.isEmpty())
+        return QString("pid %1, measuring...").arg(daemonPid);
+
+    const Sample &now = ring.last();
+    float cpuPeak = 0;
+    for (std::size_t i = 0; i < ring.size(); ++i)
+        cpuPeak = qMax(cpuPeak, ring.at(i).cpuPercent);
+    const qint64 rssDelta = now.rssBytes - ring.at(0).rssBytes;
+    const int minutes = qMax<qint64>(1, (now.timestampMs - ring.at(0).timestampMs) / 60000);
+
+    QString text = QString("pid %1, CPU %2% (peak %3% over %4 min) %5")
+            .arg(daemonPid)
+            .arg(now.cpuPercent, 0, 'f', 1)
+            .arg(cpuPeak, 0, 'f', 1)
+            .arg(minutes)
+            .arg(sparkline(ring, [](const Sample &s) { return double(s.cpuPercent); }));
+    text += QString("\nRSS %1 (%2%3 over %4 min) %5")
+            .arg(mib(now.rssBytes), rssDelta >= 0 ? "+" : "-", mib(qAbs(rssDelta)))
+            .arg(minutes)
+            .arg(sparkline(ring, [](const Sample &s) { return double(s.rssBytes); }));
+    if (now.readBytesPerSec >= 0) {
+        text += QString("\nDisk read %1, write %2")
+                .arg(ThroughputMonitor::formatRate(now.readBytesPerSec),
+                     ThroughputMonitor::formatRate(now.writeBytesPerSec));
+    } else {
+        text += QStringLiteral("\nDisk I/O needs the daemon's user to read");
+    }
+    return text;
+}
+
+bool DaemonMonitor::attach() {
+    const qint64 found = findDaemon();
+    if (found < 0)
+        return false;
+
+    // hold the process first, the files below then belong to it and not to a reused pid
+    pidfd = pidfdOpen(found);
+    statFd = openProc(found, "stat");
+    statmFd = openProc(found, "statm");
+    ioFd = openProc(found, "io");
+    if (statFd < 0 || statmFd < 0) {
+        detach();
+        return false;
+    }
+    if (pidfd >= 0) {
+        // a pidfd turns readable once the process has exited
+        exitNotifier = new QSocketNotifier(pidfd, QSocketNotifier::Read, this);
+        connect(exitNotifier, &QSocketNotifier::activated, this, &DaemonMonitor::onExited);
+    }
+
+    // a new process, the old one's trend says nothing about it
+    ring.clear();
+    daemonPid = found;
+    haveLast = readCounters(last);
+    cpuHotSamples = 0;
+    qDebug() << "daemon monitor: warp-svc is pid" << daemonPid << (ioFd < 0 ? "(no I/O access)" : "");
+    emit daemonChanged(daemonPid);
+    return true;
+}
+
+void DaemonMonitor::detach() {
+    if (exitNotifier) {
+        // may be called from the notifier's own signal
+        exitNotifier->setEnabled(false);
+        exitNotifier->deleteLater();
+        exitNotifier = nullptr;
+    }
+    for (int *fd : {&pidfd, &statFd, &statmFd, &ioFd}) {
+        if (*fd >= 0)
+            ::close(*fd);
+        *fd = -1;
+    }
+    haveLast = false;
+}
+
+void DaemonMonitor::onExited() {
+    qDebug() << "daemon monitor: warp-svc" << daemonPid << "exited";
+    detach();
+    daemonPid = -1;
+    emit daemonChanged(-1);
+    // usually restarted by systemd right away
+    attach();
+}
+
+void DaemonMonitor::sample() {
+    if (statFd < 0) {
+        attach();
+        return;
+    }
+    Counters now;
+    if (!readCounters(now)) {
+        // gone without a pidfd to tell us
+        onExited();
+        return;
+    }
+    if (!haveLast || now.timestampMs <= last.timestampMs) {
+        last = now;
+        haveLast = true;
+        return;
+    }
+
+    const double secs = (now.timestampMs - last.timestampMs) / 1000.0;
+    static const double ticksPerSec = static_cast<double>(::sysconf(_SC_CLK_TCK));
+    Sample s;
+    s.timestampMs = now.timestampMs;
+    s.cpuPercent = now.cpuTicks >= last.cpuTicks
+                       ? float((now.cpuTicks - last.cpuTicks) / ticksPerSec / secs * 100.0)
+                       : 0.f;
+    s.rssBytes = now.rssBytes;
+    if (now.haveIo && last.haveIo) {
+        s.readBytesPerSec = now.readBytes >= last.readBytes ? float((now.readBytes - last.readBytes) / secs) : 0.f;
+        s.writeBytesPerSec = now.writeBytes >= last.writeBytes
+                                 ? float((now.writeBytes - last.writeBytes) / secs)
+                                 : 0.f;
+    }
+    last = now;
+
+    ring.push(s);
+    checkThresholds(s);
+    emit sampleAdded();
+}
+
+bool DaemonMonitor::readCounters(Counters &out) const {
+    char buf[1024];
+    if (readAt(statFd, buf, sizeof(buf)) <= 0)
+        return false;
+    // comm may contain spaces and parentheses, the fields start after the last ')'
+    const char *p = std::strrchr(buf, ')');
+    if (!p)
+        return false;
+    // utime and stime are fields 14 and 15, the space after ')' starts field 3
+    for (int field = 3; field <= 14 && p; ++field)
+        p = std::strchr(p + 1, ' ');
+    if (!p)
+        return false;
+    char *end = nullptr;
+    const quint64 utime = std::strtoull(p + 1, &end, 10);
+    const quint64 stime = std::strtoull(end, nullptr, 10);
+    out.cpuTicks = utime + stime;
+
+    if (readAt(statmFd, buf, sizeof(buf)) <= 0)
+        return false;
+    // "size resident ...", in pages
+    const char *resident = std::strchr(buf, ' ');
+    if (!resident)
+        return false;
+    static const long pageSize = ::sysconf(_SC_PAGESIZE);
+    out.rssBytes = static_cast<qint64>(std::strtoll(resident + 1, nullptr, 10)) * pageSize;
+
+    out.haveIo = readAt(ioFd, buf, sizeof(buf)) > 0;
+    if (out.haveIo) {
+        out.readBytes = ioField(buf, "read_bytes:");
+        out.writeBytes = ioField(buf, "\nwrite_bytes:");
+    }
+    out.timestampMs = InterfaceCounters::monotonicMs();
+    return true;
+}
+
+void DaemonMonitor::checkThresholds(const Sample &s) {
+    const SettingsStore &settings = SettingsStore::instance();
+    const int cpuLimit = settings.number(SettingsStore::Key::DaemonCpuWarnPercent);
+    const qint64 rssLimit = static_cast<qint64>(settings.number(SettingsStore::Key::DaemonRssWarnMb)) * 1024 * 1024;
+
+    if (cpuLimit > 0 && s.cpuPercent >= cpuLimit) {
+        if (++cpuHotSamples >= kCpuHotSamples && !cpuWarned) {
+            cpuWarned = true;
+            emit thresholdExceeded("warp-svc busy",
+                                   QString("warp-svc has used %1% CPU or more for %2 seconds.")
+                                   .arg(cpuLimit)
+                                   .arg(kCpuHotSamples * kSampleMs / 1000));
+        }
+    } else {
+        cpuHotSamples = 0;
+        cpuWarned = false;
+    }
+
+    // some slack before warning again, RSS hovers around wherever it settled
+    if (rssLimit > 0 && s.rssBytes >= rssLimit) {
+        if (!rssWarned) {
+            rssWarned = true;
+            emit thresholdExceeded("warp-svc memory",
+                                   QString("warp-svc is using %1 of memory (limit %2 MiB).")
+                                   .arg(mib(s.rssBytes))
+                                   .arg(rssLimit / (1024 * 1024)));
+        }
+    } else if (s.rssBytes < rssLimit * 9 / 10) {
+        rssWarned = false;
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef DAEMONMONITOR_H
+#define DAEMONMONITOR_H
+
+#include <QObject>
+#include "samplering.h"
+
+class QSocketNotifier;
+class QTimer;
+
+// CPU, memory and I/O of warp-svc, to tell a slow tunnel from a daemon that spins or leaks.
+// The pid is looked up once and held by a pidfd that signals its exit, /proc/<pid>/stat, statm
+// and io are opened once and re-read with pread. /proc/<pid>/io is only readable by the
+// daemon's own user (root), without it the I/O columns stay empty.
+class DaemonMonitor : public QObject {
+    Q_OBJECT
+
+public:
+    struct Sample {
+        qint64 timestampMs = 0; // monotonic
+        float cpuPercent = 0;   // of one core, like top
+        qint64 rssBytes = 0;
+        float readBytesPerSec = -1; // -1 without access to /proc/<pid>/io
+        float writeBytesPerSec = -1;
+    };
+
+    // ten minutes at the sampling interval
+    using Ring = SampleRing<Sample, 120>;
+
+    explicit DaemonMonitor(QObject *parent = nullptr);
+
+    ~DaemonMonitor() override;
+
+    void start();
+
+    // stops sampling while the session sleeps or is locked, the pid and files are kept
+    void setPaused(bool paused);
+
+    // -1 while warp-svc isn't running
+    qint64 pid() const;
+
+    const Ring &samples() const;
+
+    // a few lines with the current values and their trend, for the diagnostics readout
+    QString summary() const;
+
+signals:
+    void sampleAdded();
+
+    // -1 once it exited
+    void daemonChanged(qint64 pid);
+
+    // sustained high CPU or RSS over the configured limit, once until it recovers
+    void thresholdExceeded(const QString &title, const QString &message);
+
+private:
+    struct Counters {
+        quint64 cpuTicks = 0;
+        qint64 rssBytes = 0;
+        quint64 readBytes = 0;
+        quint64 writeBytes = 0;
+        bool haveIo = false;
+        qint64 timestampMs = 0;
+    };
+
+    bool attach();
+
+    void detach();
+
+    void onExited();
+
+    void sample();
+
+    bool readCounters(Counters &out) const;
+
+    void checkThresholds(const Sample &s);
+
+    qint64 daemonPid;
+    int pidfd;
+    QSocketNotifier *exitNotifier;
+    int statFd;
+    int statmFd;
+    int ioFd;
+
+    QTimer *timer;
+    Ring ring;
+    Counters last;
+    bool haveLast;
+
+    // samples in a row over the CPU limit
+    int cpuHotSamples;
+    bool cpuWarned;
+    bool rssWarned;
+    // the timer was stopped by setPaused
+    bool suspended;
+};
+
+#endif // DAEMONMONITOR_H
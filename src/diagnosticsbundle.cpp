@@ -0,0 +1,493 @@
+#include "diagnosticsbundle.h"
+#include "commandtranscript.h"
+#include "mainfunctions.h"
+#include <QBuffer>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcess>
+#include <QSaveFile>
+#include <QTemporaryFile>
+#include <QTimer>
+#include <cstdio>
+#include <cstring>
+#include <zlib.h>
+
+// raw bytes copied per event loop pass
+static constexpr qint64 kChunk = 64 * 1024;
+// a command that prints more than this is stuck in a loop, not worth shipping
+static constexpr qint64 kMaxSpoolBytes = 32 * 1024 * 1024;
+static constexpr int kTarBlock = 512;
+
+namespace {
+    void putOctal(char *field, int width, quint64 value) {
+        // width - 1 digits and a NUL, the classic tar layout
+        std::snprintf(field, static_cast<size_t>(width), "%0*llo", width - 1, static_cast<unsigned long long>(value));
+    }
+
+    // ustar header for a regular file, names over 100 bytes are split into prefix/name
+    QByteArray tarHeader(const QByteArray &name, qint64 size, qint64 mtime) {
+        QByteArray block(kTarBlock, '\0');
+        char *h = block.data();
+        QByteArray base = name;
+        QByteArray dir;
+        if (base.size() > 100) {
+            const int slash = base.lastIndexOf('/', 155);
+            if (slash > 0) {
+                dir = base.left(slash);
+                base = base.mid(slash + 1);
+            }
+        }
+        std::memcpy(h, base.constData(), static_cast<size_t>(qMin(base.size(), 100)));
+        putOctal(h + 100, 8, 0644);
+        putOctal(h + 108, 8, 0);
+        putOctal(h + 116, 8, 0);
+        putOctal(h + 124, 12, static_cast<quint64>(size));
+        putOctal(h + 136, 12, static_cast<quint64>(mtime));
+        h[156] = '0';
+        std::memcpy(h + 257, "ustar", 6);
+        std::memcpy(h + 263, "00", 2);
+        std::memcpy(h + 345, dir.constData(), static_cast<size_t>(qMin(dir.size(), 155)));
+
+        // checksum over the header with its own field counted as spaces
+        std::memset(h + 148, ' ', 8);
+        unsigned sum = 0;
+        for (int i = 0; i < kTarBlock; ++i)
+            sum += static_cast<unsigned char>(h[i]);
+        std::snprintf(h + 148, 7, "%06o", sum);
+        h[155] = ' ';
+        return block;
+    }
+} // namespace
+
+DiagnosticsBundle::DiagnosticsBundle(QObject *parent)
+    : QObject(parent), nextLaunch(0), running(0), written(0), maxConcurrency(4), active(false),
+      archive(nullptr), zs(nullptr), pumpTimer(new QTimer(this)), currentIndex(-1), reader(nullptr),
+      entryLeft(0), entrySize(0) {
+    // zero interval: one chunk per pass, input and repaints get their turn in between
+    pumpTimer->setInterval(0);
+    connect(pumpTimer, &QTimer::timeout, this, &DiagnosticsBundle::pump);
+}
+
+DiagnosticsBundle::~DiagnosticsBundle() {
+    // no signals from here, whoever listened may be half destroyed already
+    abort();
+}
+
+void DiagnosticsBundle::setMaxConcurrency(int n) {
+    maxConcurrency = qMax(1, n);
+}
+
+void DiagnosticsBundle::addCommand(const QString &name, const QString &program, const QStringList &arguments,
+                                   int timeoutMs) {
+    Source src;
+    src.kind = Kind::Command;
+    src.name = name;
+    src.program = program;
+    src.arguments = arguments;
+    src.timeoutMs = timeoutMs;
+    sources.append(src);
+}
+
+void DiagnosticsBundle::addFile(const QString &name, const QString &filePath) {
+    if (!QFileInfo(filePath).isReadable())
+        return;
+    Source src;
+    src.kind = Kind::File;
+    src.name = name;
+    src.path = filePath;
+    sources.append(src);
+}
+
+void DiagnosticsBundle::addText(const QString &name, const QByteArray &text) {
+    Source src;
+    src.kind = Kind::Text;
+    src.name = name;
+    src.text = text;
+    sources.append(src);
+}
+
+void DiagnosticsBundle::addStandardSources() {
+    addCommand("warp-cli/version.txt", "warp-cli", {"--version"});
+    addCommand("warp-cli/status.txt", "warp-cli", {"status"});
+    addCommand("warp-cli/settings.txt", "warp-cli", {"settings"});
+    addCommand("warp-cli/registration.txt", "warp-cli", {"registration", "show"});
+    addCommand("warp-cli/tunnel-stats.txt", "warp-cli", {"tunnel", "stats"});
+    addCommand("service/warp-svc.txt", "systemctl", {"status", "warp-svc", "--no-pager", "--full"});
+    addCommand("network/addresses.txt", "ip", {"addr", "show"});
+    addCommand("network/routes-v4.txt", "ip", {"-4", "route", "show", "table", "all"});
+    addCommand("network/routes-v6.txt", "ip", {"-6", "route", "show", "table", "all"});
+    addCommand("network/rules.txt", "ip", {"rule", "show"});
+    addFile("network/resolv.conf", "/etc/resolv.conf");
+    addCommand("logs/warp-svc-journal.txt", "journalctl",
+               {"-u", "warp-svc", "--no-pager", "-o", "short-iso", "-n", "5000"}, 30000);
+    addFile("logs/cfwarp_service_log.txt", "/var/log/cloudflare-warp/cfwarp_service_log.txt");
+}
+
+QString DiagnosticsBundle::defaultFileName() {
+    return QString("warp-qt-diagnostics-%1.tar.gz")
+            .arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss"));
+}
+
+bool DiagnosticsBundle::start(const QString &archiveFile) {
+    if (active)
+        return false;
+    path = archiveFile;
+    error.clear();
+    problems.clear();
+    // everything unpacks into one directory named like the archive
+    prefix = QFileInfo(path).fileName();
+    if (prefix.endsWith(".tar.gz"))
+        prefix.chop(7);
+    if (prefix.isEmpty())
+        prefix = QStringLiteral("warp-qt-diagnostics");
+
+    archive = new QSaveFile(path, this);
+    if (!archive->open(QIODevice::WriteOnly)) {
+        error = archive->errorString();
+        delete archive;
+        archive = nullptr;
+        return false;
+    }
+    zs = new z_stream_s;
+    std::memset(zs, 0, sizeof(*zs));
+    // 15 + 16: gzip framing instead of a bare zlib stream
+    if (deflateInit2(zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        error = QStringLiteral("Cannot set up compression");
+        cleanup();
+        return false;
+    }
+
+    active = true;
+    nextLaunch = 0;
+    running = 0;
+    written = 0;
+    currentIndex = -1;
+    ready.clear();
+    emit progress(0, sources.size());
+    // files and text need no waiting, they go in while the commands run
+    for (int i = 0; i < sources.size(); ++i) {
+        if (sources.at(i).kind != Kind::Command)
+            markReady(i);
+    }
+    launchMore();
+    if (sources.isEmpty())
+        pumpTimer->start();
+    return true;
+}
+
+void DiagnosticsBundle::cancel() {
+    if (!active)
+        return;
+    abort();
+    emit finished(false, true);
+}
+
+bool DiagnosticsBundle::isRunning() const {
+    return active;
+}
+
+QString DiagnosticsBundle::archivePath() const {
+    return path;
+}
+
+QString DiagnosticsBundle::lastError() const {
+    return error;
+}
+
+QStringList DiagnosticsBundle::failures() const {
+    return problems;
+}
+
+void DiagnosticsBundle::launchMore() {
+    while (running < maxConcurrency && nextLaunch < sources.size()) {
+        const int index = nextLaunch++;
+        if (sources.at(index).kind == Kind::Command)
+            launch(index);
+    }
+}
+
+void DiagnosticsBundle::launch(int index) {
+    Source &src = sources[index];
+    src.spool = new QTemporaryFile(QDir::temp().filePath("warp-qt-diag-XXXXXX"), this);
+    if (!src.spool->open()) {
+        src.problem = QStringLiteral("cannot create a temporary file");
+        markReady(index);
+        return;
+    }
+    if (CommandTranscript::isReplaying()) {
+        replay(index);
+        return;
+    }
+
+    src.clock.start();
+    auto process = new QProcess(this);
+    process->setProcessChannelMode(QProcess::MergedChannels);
+    ++running;
+    connect(process, &QProcess::readyReadStandardOutput, this, [this, index, process]() {
+        spoolOutput(index, process);
+    });
+    connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this,
+            [this, index, process](int exitCode, QProcess::ExitStatus status) {
+                QString why;
+                if (status != QProcess::NormalExit)
+                    why = sources.at(index).problem.isEmpty() ? QStringLiteral("crashed") : sources.at(index).problem;
+                else if (exitCode != 0)
+                    why = QString("exit code %1").arg(exitCode);
+                onCommandDone(index, process, status == QProcess::NormalExit ? exitCode : -1, why);
+            });
+    connect(process, &QProcess::errorOccurred, this, [this, index, process](QProcess::ProcessError err) {
+        // finished() is not emitted when the program could not be started at all
+        if (err == QProcess::FailedToStart)
+            onCommandDone(index, process, MainFunctions::kExitFailedToStart, process->errorString());
+    });
+    QTimer::singleShot(src.timeoutMs, process, [this, index, process]() {
+        sources[index].problem = QStringLiteral("timed out");
+        sources[index].timedOut = true;
+        process->kill();
+    });
+
+    process->start(src.program, src.arguments);
+}
+
+void DiagnosticsBundle::replay(int index) {
+    Source &src = sources[index];
+    ++running;
+    CommandTranscript::Entry entry;
+    const bool found = CommandTranscript::take(src.program, src.arguments, entry);
+    // the spool goes away with an abort, and the pending answer with it
+    QTimer::singleShot(found ? CommandTranscript::replayDelayMs(entry) : 0, src.spool, [this, index, found, entry]() {
+        QString why;
+        if (!found) {
+            why = QStringLiteral("not in the replayed transcript");
+        } else {
+            // recorded with merged channels, err is only set for a failed start
+            spoolData(index, entry.out + entry.err);
+            if (entry.timedOut)
+                why = QStringLiteral("timed out");
+            else if (entry.exitCode != 0)
+                why = QString("exit code %1").arg(entry.exitCode);
+        }
+        finishCommand(index, why);
+    });
+}
+
+void DiagnosticsBundle::spoolOutput(int index, QProcess *process) {
+    spoolData(index, process->readAllStandardOutput());
+}
+
+void DiagnosticsBundle::spoolData(int index, const QByteArray &data) {
+    Source &src = sources[index];
+    const qint64 room = kMaxSpoolBytes - src.spooled;
+    const qint64 n = qBound<qint64>(0, room, data.size());
+    if (n > 0 && src.spool->write(data.constData(), n) == n)
+        src.spooled += n;
+    if (n < data.size() && src.problem.isEmpty())
+        src.problem = QString("output cut at %1 MiB").arg(kMaxSpoolBytes / (1024 * 1024));
+}
+
+void DiagnosticsBundle::onCommandDone(int index, QProcess *process, int exitCode, const QString &why) {
+    // whatever came in after the last readyRead
+    spoolOutput(index, process);
+    process->disconnect(this);
+    process->deleteLater();
+
+    Source &src = sources[index];
+    if (CommandTranscript::isRecording()) {
+        CommandTranscript::Entry entry;
+        entry.program = src.program;
+        entry.arguments = src.arguments;
+        entry.exitCode = src.timedOut ? -1 : exitCode;
+        entry.timedOut = src.timedOut;
+        entry.latencyMs = static_cast<quint32>(src.clock.elapsed());
+        // read back from the spool, only while recording; leaves the position at the end
+        if (src.spool->seek(0))
+            entry.out = src.spool->readAll();
+        if (exitCode == MainFunctions::kExitFailedToStart && entry.out.isEmpty())
+            entry.err = why.toUtf8();
+        CommandTranscript::record(std::move(entry));
+    }
+    finishCommand(index, why);
+}
+
+void DiagnosticsBundle::finishCommand(int index, const QString &why) {
+    --running;
+    Source &src = sources[index];
+    if (!why.isEmpty() && src.problem.isEmpty())
+        src.problem = why;
+    if (!src.problem.isEmpty()) {
+        // kept in the file too, support reads the archive and not our dialog
+        const QByteArray note = "\n[" + src.problem.toUtf8() + "]\n";
+        if (src.spool->write(note) == note.size())
+            src.spooled += note.size();
+    }
+    markReady(index);
+    launchMore();
+}
+
+void DiagnosticsBundle::markReady(int index) {
+    const Source &src = sources.at(index);
+    if (!src.problem.isEmpty()) {
+        const QString what = src.kind == Kind::Command
+                                 ? src.program + QLatin1Char(' ') + src.arguments.join(QLatin1Char(' '))
+                                 : src.name;
+        problems << what + ": " + src.problem;
+    }
+    ready.append(index);
+    if (!pumpTimer->isActive())
+        pumpTimer->start();
+}
+
+void DiagnosticsBundle::pump() {
+    if (!active)
+        return;
+    if (currentIndex < 0) {
+        if (ready.isEmpty()) {
+            // waiting on the commands still running
+            pumpTimer->stop();
+            if (written == sources.size())
+                finishArchive();
+            return;
+        }
+        currentIndex = ready.takeFirst();
+        if (!beginEntry(sources[currentIndex]))
+            return;
+    }
+
+    char buf[kChunk];
+    const qint64 want = qMin(kChunk, entryLeft);
+    qint64 got = want > 0 ? reader->read(buf, want) : 0;
+    // a file that shrank while we read it, the header promised entrySize bytes
+    if (got < want) {
+        std::memset(buf + qMax<qint64>(got, 0), 0, static_cast<size_t>(want - qMax<qint64>(got, 0)));
+        got = want;
+    }
+    if (got > 0 && !writeCompressed(buf, got))
+        return;
+    entryLeft -= got;
+    if (entryLeft > 0)
+        return;
+
+    const int padding = static_cast<int>((kTarBlock - entrySize % kTarBlock) % kTarBlock);
+    if (padding > 0) {
+        const QByteArray zeros(padding, '\0');
+        if (!writeCompressed(zeros.constData(), zeros.size()))
+            return;
+    }
+    Source &src = sources[currentIndex];
+    delete reader;
+    reader = nullptr;
+    // spooled output is gone as soon as it is in the archive
+    delete src.spool;
+    src.spool = nullptr;
+    src.text.clear();
+    currentIndex = -1;
+    ++written;
+    emit progress(written, sources.size());
+}
+
+bool DiagnosticsBundle::beginEntry(Source &src) {
+    switch (src.kind) {
+        case Kind::Command:
+            reader = src.spool;
+            // owned by reader from here, deleted with it
+            src.spool = nullptr;
+            break;
+        case Kind::File:
+            reader = new QFile(src.path);
+            break;
+        case Kind::Text:
+            reader = new QBuffer(&src.text);
+            break;
+    }
+    if (!reader || (!reader->isOpen() && !reader->open(QIODevice::ReadOnly)) || !reader->seek(0)) {
+        // still listed, as an empty entry, so the gap is visible
+        src.problem = src.problem.isEmpty() ? QStringLiteral("cannot be read") : src.problem;
+        delete reader;
+        reader = new QBuffer(this);
+        reader->open(QIODevice::ReadOnly);
+    }
+    // regular files, temp spools and buffers all know their size up front
+    entrySize = reader->size();
+    entryLeft = entrySize;
+    const QByteArray header = tarHeader((prefix + QLatin1Char('/') + src.name).toUtf8(), entrySize,
+                                        QDateTime::currentSecsSinceEpoch());
+    return writeCompressed(header.constData(), header.size());
+}
+
+bool DiagnosticsBundle::writeCompressed(const char *data, qint64 size, bool finish) {
+    char out[kChunk];
+    zs->next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    zs->avail_in = static_cast<uInt>(size);
+    do {
+        zs->next_out = reinterpret_cast<Bytef *>(out);
+        zs->avail_out = sizeof(out);
+        const int rc = deflate(zs, finish ? Z_FINISH : Z_NO_FLUSH);
+        if (rc == Z_STREAM_ERROR) {
+            fail(QStringLiteral("Compression failed"));
+            return false;
+        }
+        const qint64 produced = static_cast<qint64>(sizeof(out) - zs->avail_out);
+        if (produced > 0 && archive->write(out, produced) != produced) {
+            fail(archive->errorString());
+            return false;
+        }
+    } while (zs->avail_out == 0);
+    return true;
+}
+
+void DiagnosticsBundle::finishArchive() {
+    // end of archive: two empty blocks
+    const QByteArray trailer(2 * kTarBlock, '\0');
+    if (!writeCompressed(trailer.constData(), trailer.size()) || !writeCompressed(nullptr, 0, true))
+        return;
+    if (!archive->commit()) {
+        fail(archive->errorString());
+        return;
+    }
+    cleanup();
+    emit finished(true, false);
+}
+
+void DiagnosticsBundle::fail(const QString &why) {
+    error = why;
+    abort();
+    emit finished(false, false);
+}
+
+void DiagnosticsBundle::abort() {
+    if (!active)
+        return;
+    for (QProcess *process : findChildren<QProcess *>()) {
+        process->disconnect(this);
+        process->kill();
+        process->waitForFinished(500);
+        delete process;
+    }
+    running = 0;
+    // nothing ever shows up at the target path
+    if (archive)
+        archive->cancelWriting();
+    cleanup();
+}
+
+void DiagnosticsBundle::cleanup() {
+    active = false;
+    pumpTimer->stop();
+    if (zs) {
+        deflateEnd(zs);
+        delete zs;
+        zs = nullptr;
+    }
+    delete archive;
+    archive = nullptr;
+    delete reader;
+    reader = nullptr;
+    currentIndex = -1;
+    ready.clear();
+    for (Source &src : sources) {
+        delete src.spool;
+        src.spool = nullptr;
+    }
+}
@@ -0,0 +1,143 @@
+#ifndef DIAGNOSTICSBUNDLE_H
+#define DIAGNOSTICSBUNDLE_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QStringList>
+#include <QVector>
+
+class QIODevice;
+class QProcess;
+class QSaveFile;
+class QTemporaryFile;
+class QTimer;
+struct z_stream_s;
+
+// Collects support data into a .tar.gz without blocking the event loop. Commands run as child
+// processes, a few at a time like CommandBatch, and spool their output to temporary files as it
+// arrives; finished sources are then compressed into the archive one chunk per event loop pass.
+// Memory use stays at a chunk plus the deflate state no matter how much the commands print.
+// The commands take part in command transcripts like every other one.
+class DiagnosticsBundle : public QObject {
+    Q_OBJECT
+
+public:
+    explicit DiagnosticsBundle(QObject *parent = nullptr);
+
+    ~DiagnosticsBundle() override;
+
+    void setMaxConcurrency(int n);
+
+    // name is the path inside the archive, stdout and stderr end up in the same file
+    void addCommand(const QString &name, const QString &program, const QStringList &arguments,
+                    int timeoutMs = 15000);
+
+    // skipped when it cannot be read
+    void addFile(const QString &name, const QString &path);
+
+    void addText(const QString &name, const QByteArray &text);
+
+    // warp-cli queries, service state, addresses, routes, DNS and the daemon log
+    void addStandardSources();
+
+    // the archive only appears at path once everything is written, false if it cannot be created
+    bool start(const QString &path);
+
+    void cancel();
+
+    bool isRunning() const;
+
+    QString archivePath() const;
+
+    QString lastError() const;
+
+    // sources that failed, timed out or were cut short, their output is in the archive anyway
+    QStringList failures() const;
+
+    static QString defaultFileName();
+
+signals:
+    void progress(int done, int total);
+
+    void finished(bool ok, bool cancelled);
+
+private:
+    enum class Kind {
+        Command,
+        File,
+        Text
+    };
+
+    struct Source {
+        Kind kind = Kind::Text;
+        QString name;
+        QString program;
+        QStringList arguments;
+        int timeoutMs = 0;
+        QString path;
+        QByteArray text;
+        QTemporaryFile *spool = nullptr;
+        qint64 spooled = 0;
+        QString problem;
+        QElapsedTimer clock;
+        bool timedOut = false;
+    };
+
+    void launchMore();
+
+    void launch(int index);
+
+    // answers the command from the replayed transcript instead of running it
+    void replay(int index);
+
+    void spoolOutput(int index, QProcess *process);
+
+    void spoolData(int index, const QByteArray &data);
+
+    void onCommandDone(int index, QProcess *process, int exitCode, const QString &error);
+
+    void finishCommand(int index, const QString &error);
+
+    void markReady(int index);
+
+    void pump();
+
+    bool beginEntry(Source &src);
+
+    bool writeCompressed(const char *data, qint64 size, bool finish = false);
+
+    void finishArchive();
+
+    void fail(const QString &error);
+
+    // stops everything and drops the partial archive, without signals
+    void abort();
+
+    void cleanup();
+
+    QVector<Source> sources;
+    // complete, waiting for their turn in the archive
+    QVector<int> ready;
+    int nextLaunch;
+    int running;
+    int written;
+    int maxConcurrency;
+    bool active;
+
+    QString path;
+    QString prefix;
+    QSaveFile *archive;
+    z_stream_s *zs;
+    QTimer *pumpTimer;
+
+    // the entry being copied into the archive
+    int currentIndex;
+    QIODevice *reader;
+    qint64 entryLeft;
+    qint64 entrySize;
+
+    QString error;
+    QStringList problems;
+};
+
+#endif // DIAGNOSTICSBUNDLE_H
@@ -0,0 +1,264 @@
+#include "dnsbenchmark.h"
+#include <QFile>
+#include <QRandomGenerator>
+#include <QSocketNotifier>
+#include <QTimer>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <netinet/in.h>
+#include <unistd.h>
+
+static constexpr int kMaxQueries = 1000;
+static constexpr int kRoundTimeoutMs = 5000;
+
+namespace {
+    qint64 monotonicNs() {
+        timespec ts{};
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<qint64>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    // standard recursive A query, id is patched in per round
+    QByteArray encodeQuery(const QByteArray &name) {
+        QByteArray q;
+        q.reserve(18 + name.size());
+        const char header[] = {0, 0, 0x01, 0x00, 0x00, 0x01, 0, 0, 0, 0, 0, 0};
+        q.append(header, sizeof(header));
+        for (const QByteArray &label : name.split('.')) {
+            if (label.isEmpty())
+                continue;
+            q.append(static_cast<char>(label.size()));
+            q.append(label);
+        }
+        const char tail[] = {0x00, 0x00, 0x01, 0x00, 0x01};
+        q.append(tail, sizeof(tail));
+        return q;
+    }
+} // namespace
+
+DnsBenchmark::DnsBenchmark(QObject *parent)
+    : QObject(parent), serverLen(0), fd(-1), readNotifier(nullptr), writeNotifier(nullptr),
+      roundTimeout(new QTimer(this)), round(Round::Idle), nextToSend(0), answered(0) {
+    std::memset(&serverAddr, 0, sizeof(serverAddr));
+    roundTimeout->setSingleShot(true);
+    connect(roundTimeout, &QTimer::timeout, this, &DnsBenchmark::finishRound);
+}
+
+DnsBenchmark::~DnsBenchmark() {
+    closeSocket();
+}
+
+bool DnsBenchmark::setServer(const QString &server) {
+    QString host = server.trimmed();
+    quint16 port = 53;
+    if (host.count(':') == 1) {
+        port = static_cast<quint16>(host.section(':', 1).toUInt());
+        host = host.section(':', 0, 0);
+    }
+    if (port == 0)
+        return false;
+
+    std::memset(&serverAddr, 0, sizeof(serverAddr));
+    auto *v4 = reinterpret_cast<sockaddr_in *>(&serverAddr);
+    if (inet_pton(AF_INET, host.toLatin1().constData(), &v4->sin_addr) != 1) {
+        serverLen = 0;
+        return false;
+    }
+    v4->sin_family = AF_INET;
+    v4->sin_port = htons(port);
+    serverLen = sizeof(sockaddr_in);
+    serverSpec = server.trimmed();
+    return true;
+}
+
+QString DnsBenchmark::server() const {
+    return serverSpec;
+}
+
+QString DnsBenchmark::detectLocalProxy() {
+    // same addresses isWarpConnected() looks for in DNS-only modes
+    QFile file("/etc/resolv.conf");
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return QString();
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine().simplified();
+        if (!line.startsWith("nameserver "))
+            continue;
+        const QByteArray addr = line.mid(11);
+        if (addr == "127.0.2.2" || addr == "127.0.0.2")
+            return QString::fromLatin1(addr);
+    }
+    return QString();
+}
+
+void DnsBenchmark::start(int count) {
+    if (isRunning())
+        return;
+    if (serverLen == 0) {
+        fail(QStringLiteral("No DNS server configured"));
+        return;
+    }
+    count = qBound(1, count, kMaxQueries);
+
+    fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr *>(&serverAddr), serverLen) < 0) {
+        fail(QString::fromLocal8Bit(strerror(errno)));
+        return;
+    }
+    readNotifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(readNotifier, &QSocketNotifier::activated, this, &DnsBenchmark::onReadable);
+    writeNotifier = new QSocketNotifier(fd, QSocketNotifier::Write, this);
+    writeNotifier->setEnabled(false);
+    connect(writeNotifier, &QSocketNotifier::activated, this, &DnsBenchmark::sendPending);
+
+    // random labels under a real zone: a guaranteed cache miss that still needs an upstream answer
+    queries.clear();
+    queries.reserve(count);
+    auto *rng = QRandomGenerator::global();
+    for (int i = 0; i < count; ++i) {
+        const QByteArray label = QByteArray::number(rng->generate64(), 36);
+        queries.append(encodeQuery("wq-" + label + ".cloudflare.com"));
+    }
+    sentNs.fill(0, count);
+    latencyUs.fill(0, count);
+
+    res = Result();
+    res.sent = count;
+    error.clear();
+    startRound(Round::Cold);
+}
+
+void DnsBenchmark::cancel() {
+    if (!isRunning())
+        return;
+    roundTimeout->stop();
+    closeSocket();
+    round = Round::Idle;
+    error = QStringLiteral("Cancelled");
+    emit finished(false);
+}
+
+bool DnsBenchmark::isRunning() const {
+    return round != Round::Idle;
+}
+
+DnsBenchmark::Result DnsBenchmark::result() const {
+    return res;
+}
+
+QString DnsBenchmark::lastError() const {
+    return error;
+}
+
+void DnsBenchmark::startRound(Round r) {
+    round = r;
+    nextToSend = 0;
+    answered = 0;
+    std::fill(latencyUs.begin(), latencyUs.end(), 0u);
+    // ids are the query index, with the top bit telling the rounds apart so a
+    // straggler from the cold round cant be counted as a warm answer
+    const quint16 flag = r == Round::Warm ? 0x8000 : 0;
+    for (int i = 0; i < queries.size(); ++i) {
+        const quint16 id = static_cast<quint16>(i) | flag;
+        queries[i][0] = static_cast<char>(id >> 8);
+        queries[i][1] = static_cast<char>(id & 0xff);
+    }
+    roundTimeout->start(kRoundTimeoutMs);
+    sendPending();
+}
+
+void DnsBenchmark::sendPending() {
+    while (nextToSend < queries.size()) {
+        const QByteArray &q = queries.at(nextToSend);
+        sentNs[nextToSend] = monotonicNs();
+        if (::send(fd, q.constData(), q.size(), 0) < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                writeNotifier->setEnabled(true);
+                return;
+            }
+            fail(QString::fromLocal8Bit(strerror(errno)));
+            return;
+        }
+        ++nextToSend;
+    }
+    writeNotifier->setEnabled(false);
+}
+
+void DnsBenchmark::onReadable() {
+    unsigned char buf[1500];
+    const quint16 flag = round == Round::Warm ? 0x8000 : 0;
+    for (;;) {
+        const ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            // nothing listening on the proxy address
+            fail(QString::fromLocal8Bit(strerror(errno)));
+            return;
+        }
+        if (n < 12)
+            continue;
+        const quint16 id = static_cast<quint16>((buf[0] << 8) | buf[1]);
+        if ((id & 0x8000) != flag)
+            continue;
+        const int idx = id & 0x7fff;
+        if (idx >= queries.size() || idx >= nextToSend || latencyUs[idx] != 0)
+            continue;
+        latencyUs[idx] = static_cast<quint32>(qMax<qint64>(1, (monotonicNs() - sentNs[idx]) / 1000));
+        ++answered;
+    }
+    emit progress(answered, queries.size(), round == Round::Warm);
+    if (answered == queries.size())
+        finishRound();
+}
+
+void DnsBenchmark::finishRound() {
+    roundTimeout->stop();
+    QVector<quint32> got;
+    got.reserve(latencyUs.size());
+    for (quint32 v : latencyUs) {
+        if (v != 0)
+            got.append(v);
+    }
+    const int lost = queries.size() - got.size();
+    const LatencyStats stats = LatencyStats::compute(got.data(), got.size());
+
+    if (round == Round::Cold) {
+        res.cold = stats;
+        res.coldLost = lost;
+        startRound(Round::Warm);
+        return;
+    }
+    res.warm = stats;
+    res.warmLost = lost;
+    closeSocket();
+    round = Round::Idle;
+    emit finished(true);
+}
+
+void DnsBenchmark::fail(const QString &err) {
+    roundTimeout->stop();
+    closeSocket();
+    error = err;
+    round = Round::Idle;
+    emit finished(false);
+}
+
+void DnsBenchmark::closeSocket() {
+    if (readNotifier) {
+        readNotifier->setEnabled(false);
+        readNotifier->deleteLater();
+        readNotifier = nullptr;
+    }
+    if (writeNotifier) {
+        writeNotifier->setEnabled(false);
+        writeNotifier->deleteLater();
+        writeNotifier = nullptr;
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef DNSBENCHMARK_H
+#define DNSBENCHMARK_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QVector>
+#include <sys/socket.h>
+#include "latencystats.h"
+
+class QSocketNotifier;
+class QTimer;
+
+// Fires a batch of concurrent A queries at WARP's local DNS proxy over one non-blocking
+// UDP socket, then repeats the same names so the second round shows the cache effect.
+// Cold names are random labels, so the first round always has to go upstream.
+class DnsBenchmark : public QObject {
+    Q_OBJECT
+
+public:
+    struct Result {
+        int sent = 0;
+        int coldLost = 0;
+        int warmLost = 0;
+        LatencyStats cold;
+        LatencyStats warm;
+    };
+
+    explicit DnsBenchmark(QObject *parent = nullptr);
+
+    ~DnsBenchmark();
+
+    // numeric address with optional port, "127.0.2.2" or "127.0.0.1:5353"
+    bool setServer(const QString &server);
+
+    QString server() const;
+
+    void start(int queries);
+
+    void cancel();
+
+    bool isRunning() const;
+
+    Result result() const;
+
+    QString lastError() const;
+
+    // the local proxy address WARP put into resolv.conf, if any
+    static QString detectLocalProxy();
+
+signals:
+    void progress(int answered, int total, bool warmRound);
+
+    void finished(bool ok);
+
+private:
+    enum class Round {
+        Idle,
+        Cold,
+        Warm
+    };
+
+    void startRound(Round round);
+
+    void sendPending();
+
+    void onReadable();
+
+    void finishRound();
+
+    void fail(const QString &error);
+
+    void closeSocket();
+
+    QString serverSpec;
+    sockaddr_storage serverAddr;
+    socklen_t serverLen;
+
+    int fd;
+    QSocketNotifier *readNotifier;
+    QSocketNotifier *writeNotifier;
+    QTimer *roundTimeout;
+
+    Round round;
+    QVector<QByteArray> queries;
+    QVector<qint64> sentNs;
+    QVector<quint32> latencyUs; // 0 = no answer yet
+    int nextToSend;
+    int answered;
+
+    Result res;
+    QString error;
+};
+
+#endif // DNSBENCHMARK_H
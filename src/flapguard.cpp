@@ -0,0 +1,140 @@
+#include "flapguard.h"
+#include "ifacecounters.h"
+#include <QTimer>
+
+// this many raw transitions inside the window and the link counts as flapping
+static constexpr int kFlapTransitions = 6;
+static constexpr int kFlapWindowMs = 120000;
+// how long a new state has to hold before it is shown
+static constexpr int kHoldMs = 2000;
+static constexpr int kFlapHoldMs = 15000;
+// at most one error notification per window, the rest are summarized at its end
+static constexpr int kCoalesceMs = 30000;
+
+FlapGuard::FlapGuard(bool initialState, QObject *parent)
+    : QObject(parent), displayed(initialState), lastRaw(initialState), pendingState(initialState),
+      haveReport(false), flapping(false), holdTimer(new QTimer(this)), holdMs(kHoldMs), flapHoldMs(kFlapHoldMs),
+      flapTimer(new QTimer(this)), flapTransitions(kFlapTransitions), flapWindowMs(kFlapWindowMs),
+      coalesceTimer(new QTimer(this)), suppressedErrors(0) {
+    holdTimer->setSingleShot(true);
+    connect(holdTimer, &QTimer::timeout, this, &FlapGuard::onHoldExpired);
+    flapTimer->setSingleShot(true);
+    connect(flapTimer, &QTimer::timeout, this, &FlapGuard::updateFlapping);
+    coalesceTimer->setSingleShot(true);
+    coalesceTimer->setInterval(kCoalesceMs);
+    connect(coalesceTimer, &QTimer::timeout, this, &FlapGuard::onCoalesceExpired);
+}
+
+bool FlapGuard::displayedState() const {
+    return displayed;
+}
+
+bool FlapGuard::isFlapping() const {
+    return flapping;
+}
+
+void FlapGuard::setFlapThreshold(int transitions, int windowMs) {
+    flapTransitions = qMax(2, transitions);
+    flapWindowMs = windowMs;
+    updateFlapping();
+}
+
+void FlapGuard::setHoldMs(int normalMs, int flappingMs) {
+    holdMs = normalMs;
+    flapHoldMs = flappingMs;
+}
+
+void FlapGuard::setCoalesceMs(int ms) {
+    coalesceTimer->setInterval(ms);
+}
+
+void FlapGuard::reportState(bool connected) {
+    if (connected != lastRaw) {
+        lastRaw = connected;
+        recordTransition();
+    }
+
+    // the first real observation replaces whatever we started with, no waiting
+    if (!haveReport) {
+        haveReport = true;
+        commitState(connected);
+        return;
+    }
+
+    if (connected == displayed) {
+        // bounced back before it held, nothing to show
+        holdTimer->stop();
+        return;
+    }
+    if (holdTimer->isActive() && pendingState == connected)
+        return;
+    pendingState = connected;
+    holdTimer->start(flapping ? flapHoldMs : holdMs);
+}
+
+void FlapGuard::commitState(bool connected) {
+    holdTimer->stop();
+    lastRaw = connected;
+    if (connected == displayed)
+        return;
+    displayed = connected;
+    emit stateChanged(connected);
+}
+
+void FlapGuard::reportError(const QString &title, const QString &message) {
+    if (!coalesceTimer->isActive()) {
+        emit notify(Severity::Error, title, message);
+        coalesceTimer->start();
+        return;
+    }
+    ++suppressedErrors;
+    lastErrorTitle = title;
+    lastErrorMessage = message;
+}
+
+void FlapGuard::recordTransition() {
+    transitions.append(InterfaceCounters::monotonicMs());
+    updateFlapping();
+}
+
+void FlapGuard::updateFlapping() {
+    const qint64 now = InterfaceCounters::monotonicMs();
+    int expired = 0;
+    while (expired < transitions.size() && now - transitions.at(expired) >= flapWindowMs)
+        ++expired;
+    transitions.remove(0, expired);
+
+    const bool flappingNow = transitions.size() >= flapTransitions;
+    // look again when the oldest transition leaves the window
+    if (!transitions.isEmpty())
+        flapTimer->start(static_cast<int>(flapWindowMs - (now - transitions.first())));
+    else
+        flapTimer->stop();
+
+    if (flappingNow == flapping)
+        return;
+    flapping = flappingNow;
+    emit flappingChanged(flapping);
+}
+
+void FlapGuard::onHoldExpired() {
+    if (pendingState == displayed)
+        return;
+    displayed = pendingState;
+    emit stateChanged(displayed);
+}
+
+void FlapGuard::onCoalesceExpired() {
+    if (suppressedErrors == 0)
+        return;
+    const QString message = suppressedErrors == 1
+                                ? lastErrorMessage
+                                : QString("%1 more errors in the last %2 s, the latest:\n%3")
+                                  .arg(suppressedErrors)
+                                  .arg(coalesceTimer->interval() / 1000)
+                                  .arg(lastErrorMessage);
+    emit notify(Severity::Error, lastErrorTitle, message);
+    suppressedErrors = 0;
+    // still in a burst, keep throttling
+    coalesceTimer->start();
+}
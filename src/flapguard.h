@@ -0,0 +1,88 @@
+#ifndef FLAPGUARD_H
+#define FLAPGUARD_H
+
+#include <QObject>
+#include <QVector>
+
+class QTimer;
+
+// Sits between the raw status events and what the user sees. A displayed state change has to
+// hold for a moment before it is committed (longer while the link is flapping, i.e. after
+// many transitions in a short window), and bursts of errors are merged into one notification
+// per window instead of one each.
+class FlapGuard : public QObject {
+    Q_OBJECT
+
+public:
+    enum class Severity {
+        Info,
+        Error
+    };
+
+    explicit FlapGuard(bool initialState, QObject *parent = nullptr);
+
+    bool displayedState() const;
+
+    bool isFlapping() const;
+
+    void setFlapThreshold(int transitions, int windowMs);
+
+    void setHoldMs(int normalMs, int flappingMs);
+
+    void setCoalesceMs(int ms);
+
+public
+    slots:
+
+    
+
+    // a raw observation, only shown once it has held (the very first one is shown right away)
+    void reportState(bool connected);
+
+    // confirmed by the user's own toggle, shown at once
+    void commitState(bool connected);
+
+    void reportError(const QString &title, const QString &message);
+
+    signals:
+
+    
+
+    void stateChanged(bool connected);
+
+    void flappingChanged(bool flapping);
+
+    void notify(FlapGuard::Severity severity, const QString &title, const QString &message);
+
+private:
+    void recordTransition();
+
+    void updateFlapping();
+
+    void onHoldExpired();
+
+    void onCoalesceExpired();
+
+    bool displayed;
+    bool lastRaw;
+    bool pendingState;
+    bool haveReport;
+    bool flapping;
+
+    QTimer *holdTimer;
+    int holdMs;
+    int flapHoldMs;
+
+    // monotonic times of recent raw transitions, oldest first
+    QVector<qint64> transitions;
+    QTimer *flapTimer;
+    int flapTransitions;
+    int flapWindowMs;
+
+    QTimer *coalesceTimer;
+    int suppressedErrors;
+    QString lastErrorTitle;
+    QString lastErrorMessage;
+};
+
+#endif // FLAPGUARD_H
@@ -0,0 +1,127 @@
+#include "headless.h"
+#include "daemonmonitor.h"
+#include "mainfunctions.h"
+#include "statusbroker.h"
+#include "statustracker.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QSocketNotifier>
+#include <QTextStream>
+#include <csignal>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+    int signalFds[2] = {-1, -1};
+
+    void onTerminate(int) {
+        // only async-signal-safe calls here, the notifier does the rest in the event loop
+        const char byte = 1;
+        const ssize_t ignored = ::write(signalFds[0], &byte, 1);
+        (void) ignored;
+    }
+
+    QString modeName(WarpMode mode) {
+        const QString name = WarpModes::cliName(mode);
+        return name.isEmpty() ? WarpModes::label(mode) : name;
+    }
+
+    void logLine(const QString &line) {
+        static QTextStream out(stdout);
+        out << QDateTime::currentDateTime().toString(Qt::ISODate) << ' ' << line << '\n';
+        out.flush();
+    }
+
+    // SIGINT/SIGTERM end the event loop instead of the process, so destructors still run
+    void quitOnSignals() {
+        if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, signalFds) != 0)
+            return;
+        auto notifier = new QSocketNotifier(signalFds[1], QSocketNotifier::Read, qApp);
+        QObject::connect(notifier, &QSocketNotifier::activated, qApp, [notifier]() {
+            notifier->setEnabled(false);
+            char byte;
+            const ssize_t ignored = ::read(signalFds[1], &byte, 1);
+            (void) ignored;
+            QCoreApplication::quit();
+        });
+        std::signal(SIGINT, onTerminate);
+        std::signal(SIGTERM, onTerminate);
+    }
+} // namespace
+
+int Headless::status() {
+    MainFunctions mf;
+    const MainFunctions::StateProbe probe = mf.probeStateAsync().result();
+
+    QTextStream out(stdout);
+    out << "service: " << (probe.serviceActive ? "active" : "inactive") << '\n'
+        << "mode: " << modeName(probe.mode) << '\n'
+        << "status: " << (probe.connected ? "connected" : "disconnected") << '\n';
+    out.flush();
+
+    if (!probe.serviceActive)
+        return 2;
+    return probe.connected ? 0 : 1;
+}
+
+int Headless::daemon() {
+    quitOnSignals();
+
+    MainFunctions mf;
+    StatusTracker tracker(&mf);
+    DaemonMonitor daemonMonitor;
+    QObject::connect(&tracker, &StatusTracker::pausedChanged, &daemonMonitor, &DaemonMonitor::setPaused);
+    QObject::connect(&daemonMonitor, &DaemonMonitor::thresholdExceeded, &mf, &MainFunctions::infoOccurred);
+    daemonMonitor.start();
+
+    QObject::connect(&tracker, &StatusTracker::connectionChanged, &tracker, [&mf](bool connected) {
+        logLine(QString("%1 (mode %2)")
+                .arg(connected ? "connected" : "disconnected", modeName(mf.currentMode())));
+    });
+    QObject::connect(&tracker, &StatusTracker::staleChanged, &tracker, [](bool stale) {
+        if (stale)
+            logLine("resumed, revalidating");
+    });
+    QObject::connect(&tracker, &StatusTracker::tunnelStalled, &tracker, [](int stalledForMs, bool reconnecting) {
+        logLine(QString("tunnel stalled for %1 s%2")
+                .arg(stalledForMs / 1000)
+                .arg(reconnecting ? ", reconnecting" : ""));
+    });
+    QObject::connect(&mf, &MainFunctions::connectRetryScheduled, &tracker,
+                     [](int attempt, int maxAttempts, int delayMs, const QString &reason) {
+                         logLine(QString("retry %1/%2 in %3 ms: %4").arg(attempt).arg(maxAttempts).arg(delayMs)
+                                 .arg(reason));
+                     });
+    QObject::connect(&mf, &MainFunctions::errorOccurred, &tracker, [](const QString &title, const QString &message) {
+        logLine(QString("error: %1: %2").arg(title, QString(message).replace('\n', ' ')));
+    });
+    QObject::connect(&mf, &MainFunctions::infoOccurred, &tracker, [](const QString &title, const QString &message) {
+        logLine(QString("%1: %2").arg(title, QString(message).replace('\n', ' ')));
+    });
+
+    const int rc = QCoreApplication::exec();
+    logLine("stopped");
+    return rc;
+}
+
+int Headless::broker(const QString &group) {
+    quitOnSignals();
+
+    MainFunctions mf;
+    StatusBroker broker(&mf);
+    const QString path = StatusBroker::defaultSocketPath();
+    if (!broker.listen(path, group))
+        return 1;
+    logLine(QString("broker listening on %1%2").arg(path, group.isEmpty() ? QString() : " for group " + group));
+
+    QObject::connect(&broker, &StatusBroker::subscribersChanged, &broker, [](int count) {
+        logLine(QString("%1 subscriber(s)").arg(count));
+    });
+    QObject::connect(&mf, &MainFunctions::errorOccurred, &broker, [](const QString &title, const QString &message) {
+        logLine(QString("error: %1: %2").arg(title, QString(message).replace('\n', ' ')));
+    });
+
+    const int rc = QCoreApplication::exec();
+    logLine("stopped");
+    return rc;
+}
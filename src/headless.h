@@ -0,0 +1,20 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <QString>
+
+// Front ends that need only a QCoreApplication, no display or tray.
+namespace Headless {
+    // probe once and print it, exit code 0 connected, 1 disconnected, 2 warp-svc not running
+    int status();
+
+    // the tray's state tracking without the tray: history, snapshot, auto-connect, retries and
+    // stall reconnects, with state changes logged to stdout. Runs until SIGINT/SIGTERM.
+    int daemon();
+
+    // the host-wide status broker: probes once for every session and serves the state on the
+    // broker socket, only members of group (if given) may subscribe. Runs until SIGINT/SIGTERM.
+    int broker(const QString &group);
+}
+
+#endif // HEADLESS_H
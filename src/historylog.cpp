@@ -0,0 +1,157 @@
+#include "historylog.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <algorithm>
+
+HistoryLog::HistoryLog(const QString &path, qint64 maxBytes)
+    : path(path), maxBytes(maxBytes), file(path), live(false) {
+}
+
+QString HistoryLog::defaultPath() {
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/history.v1.bin";
+}
+
+void HistoryLog::append(State oldState, State newState, WarpMode mode, Cause cause,
+                        qint64 durationMs, qint64 latencyMs) {
+    rotateIfNeeded();
+    if (!file.isOpen()) {
+        QDir().mkpath(QFileInfo(path).absolutePath());
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Append))
+            return;
+    }
+
+    Record rec{};
+    rec.timestampMs = QDateTime::currentMSecsSinceEpoch();
+    rec.durationMs = static_cast<quint32>(qBound<qint64>(0, durationMs, 0xffffffffLL));
+    rec.latencyMs = static_cast<quint32>(qBound<qint64>(0, latencyMs, 0xffffffffLL));
+    rec.oldState = static_cast<quint8>(oldState);
+    rec.newState = static_cast<quint8>(newState);
+    rec.mode = static_cast<quint8>(mode);
+    rec.cause = static_cast<quint8>(cause);
+    // a single small write on an O_APPEND file, a crash can at worst lose this record
+    file.write(reinterpret_cast<const char *>(&rec), sizeof(rec));
+    file.flush();
+    live = newState != State::Stopped;
+}
+
+void HistoryLog::rotateIfNeeded() {
+    if (QFileInfo(path).size() < maxBytes)
+        return;
+    file.close();
+    const QString old = path + ".1";
+    QFile::remove(old);
+    QFile::rename(path, old);
+}
+
+HistoryLog::Stats HistoryLog::stats(qint64 windowMs) const {
+    const qint64 nowMs = QDateTime::currentMSecsSinceEpoch();
+    const qint64 fromMs = nowMs - windowMs;
+
+    Stats s;
+    s.windowMs = windowMs;
+    State state = State::Disconnected;
+    qint64 since = fromMs;
+    qint64 lastRecordMs = fromMs;
+    accumulate(path + ".1", fromMs, nowMs, s, state, since, lastRecordMs);
+    accumulate(path, fromMs, nowMs, s, state, since, lastRecordMs);
+    // only a running writer vouches for the time after its last record
+    const qint64 untilMs = live ? nowMs : lastRecordMs;
+    if (state == State::Connected && untilMs > since)
+        s.connectedMs += untilMs - qMax(since, fromMs);
+    return s;
+}
+
+void HistoryLog::accumulate(const QString &fileName, qint64 fromMs, qint64 nowMs, Stats &s,
+                            State &state, qint64 &since, qint64 &lastRecordMs) const {
+    QFile f(fileName);
+    if (!f.open(QIODevice::ReadOnly))
+        return;
+    const qint64 count = f.size() / static_cast<qint64>(sizeof(Record));
+    if (count == 0)
+        return;
+    uchar *mapped = f.map(0, count * static_cast<qint64>(sizeof(Record)));
+    if (!mapped)
+        return;
+    const auto *begin = reinterpret_cast<const Record *>(mapped);
+    const auto *end = begin + count;
+
+    // records are appended in time order, jump straight to the window
+    const Record *first = std::lower_bound(begin, end, fromMs, [](const Record &r, qint64 t) {
+        return r.timestampMs < t;
+    });
+    // state going into the window is the last real transition before it
+    for (const Record *r = first; r != begin;) {
+        --r;
+        if (r->newState != static_cast<quint8>(State::Failed)) {
+            state = static_cast<State>(r->newState);
+            since = fromMs;
+            break;
+        }
+    }
+
+    for (const Record *r = first; r != end && r->timestampMs <= nowMs; ++r) {
+        lastRecordMs = r->timestampMs;
+        const auto next = static_cast<State>(r->newState);
+        if (next == State::Failed) {
+            ++s.failures;
+            continue;
+        }
+        if (r->oldState == static_cast<quint8>(State::Stopped)) {
+            // startup: whatever happened since the last record (a crash leaves no Stopped) is unknown
+            state = next;
+            since = r->timestampMs;
+            continue;
+        }
+        if (state == State::Connected)
+            s.connectedMs += r->timestampMs - qMax(since, fromMs);
+        if (next == State::Connected && state != State::Connected) {
+            ++s.connects;
+            if (r->latencyMs > 0) {
+                ++s.timedConnects;
+                s.totalConnectLatencyMs += r->latencyMs;
+            }
+        } else if (next == State::Disconnected && state == State::Connected) {
+            ++s.disconnects;
+        }
+        state = next;
+        since = r->timestampMs;
+    }
+    f.unmap(mapped);
+}
+
+bool HistoryLog::lastTransition(Record &out) const {
+    return lastTransitionIn(path, out) || lastTransitionIn(path + ".1", out);
+}
+
+bool HistoryLog::lastTransitionIn(const QString &fileName, Record &out) {
+    QFile f(fileName);
+    if (!f.open(QIODevice::ReadOnly))
+        return false;
+    // the oldest of the startup records in a row that found the same state
+    Record start{};
+    bool haveStart = false;
+    // walk back from the end, there are rarely more than a few failures and restarts in a row
+    for (qint64 pos = (f.size() / static_cast<qint64>(sizeof(Record)) - 1) * static_cast<qint64>(sizeof(Record));
+         pos >= 0; pos -= sizeof(Record)) {
+        Record rec;
+        if (!f.seek(pos) || f.read(reinterpret_cast<char *>(&rec), sizeof(rec)) != sizeof(rec))
+            break;
+        if (rec.newState == static_cast<quint8>(State::Failed) || rec.newState == static_cast<quint8>(State::Stopped))
+            continue;
+        // changed while we were not running, the startup record is as close as we get
+        if (haveStart && rec.newState != start.newState)
+            break;
+        if (rec.oldState == static_cast<quint8>(State::Stopped)) {
+            start = rec;
+            haveStart = true;
+            continue;
+        }
+        out = rec;
+        return true;
+    }
+    if (haveStart)
+        out = start;
+    return haveStart;
+}
@@ -0,0 +1,96 @@
+#ifndef HISTORYLOG_H
+#define HISTORYLOG_H
+
+#include <QFile>
+#include <QString>
+#include "warpmode.h"
+
+// Append-only connection history made of fixed-size binary records. Readers mmap the
+// file and binary search by timestamp, so statistics over a year of events are cheap.
+// The file is rotated once to <name>.1 when it reaches the size cap.
+class HistoryLog {
+public:
+    enum class State : quint8 {
+        Disconnected = 0,
+        Connected = 1,
+        Failed = 2, // a failed attempt, does not change the current state
+        // The app quit. Nothing is known until the next record, which has this as its old state:
+        // the state found at startup, not a transition.
+        Stopped = 3
+    };
+
+    enum class Cause : quint8 {
+        Unknown = 0,
+        User = 1,      // toggled from the tray or popup
+        AutoConnect = 2,
+        Retry = 3,     // automatic reconnect after a failure
+        Stall = 4,     // tunnel stall watchdog
+        External = 5,  // noticed by status polling (warp-cli, another client, network)
+        Error = 6
+    };
+
+#pragma pack(push, 1)
+    struct Record {
+        qint64 timestampMs;  // wall clock, ms since epoch
+        quint32 durationMs;  // time spent in the old state
+        quint32 latencyMs;   // request to confirmed state, 0 if not requested by us
+        quint8 oldState;
+        quint8 newState;
+        quint8 mode;         // WarpMode value
+        quint8 cause;
+        quint32 reserved;
+    };
+#pragma pack(pop)
+    static_assert(sizeof(Record) == 24, "history records are a fixed 24 bytes on disk");
+
+    struct Stats {
+        qint64 windowMs = 0;
+        qint64 connectedMs = 0;
+        int connects = 0;
+        int disconnects = 0;
+        int failures = 0;
+        int timedConnects = 0;
+        qint64 totalConnectLatencyMs = 0;
+
+        double uptimeRatio() const { return windowMs > 0 ? double(connectedMs) / windowMs : 0.0; }
+
+        double failureRate() const {
+            const int attempts = connects + failures;
+            return attempts > 0 ? double(failures) / attempts : 0.0;
+        }
+
+        qint64 averageConnectMs() const { return timedConnects > 0 ? totalConnectLatencyMs / timedConnects : -1; }
+    };
+
+    explicit HistoryLog(const QString &path = defaultPath(), qint64 maxBytes = 4 * 1024 * 1024);
+
+    void append(State oldState, State newState, WarpMode mode, Cause cause,
+                qint64 durationMs, qint64 latencyMs = 0);
+
+    // Everything recorded in [now - windowMs, now], including the rotated file. The state of the
+    // newest record only runs on to now while this process keeps the log (appended since the last
+    // Stopped), a reader without a writer ends it at that record instead.
+    Stats stats(qint64 windowMs) const;
+
+    // The newest connect or disconnect; failed attempts and stops are skipped, and a startup record
+    // only counts when the state differs from the one before the stop. False if there is none.
+    bool lastTransition(Record &out) const;
+
+    static QString defaultPath();
+
+private:
+    void rotateIfNeeded();
+
+    void accumulate(const QString &file, qint64 fromMs, qint64 nowMs, Stats &stats,
+                    State &state, qint64 &stateSinceMs, qint64 &lastRecordMs) const;
+
+    static bool lastTransitionIn(const QString &file, Record &out);
+
+    QString path;
+    qint64 maxBytes;
+    QFile file;
+    // this process appended the newest record and has not stopped since
+    bool live;
+};
+
+#endif // HISTORYLOG_H
@@ -0,0 +1,90 @@
+#include "ifacecounters.h"
+#include <QFile>
+#include <cerrno>
+#include <cstdlib>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+    const char *const kCounterNames[] = {"rx_bytes", "tx_bytes", "rx_packets", "tx_packets"};
+
+    bool readCounter(int fd, quint64 &value) {
+        char buf[32];
+        ssize_t n;
+        do {
+            // sysfs regenerates the attribute on every read from offset 0
+            n = ::pread(fd, buf, sizeof(buf) - 1, 0);
+        } while (n < 0 && errno == EINTR);
+        if (n <= 0)
+            return false;
+        buf[n] = '\0';
+        char *end = nullptr;
+        value = std::strtoull(buf, &end, 10);
+        return end != buf;
+    }
+} // namespace
+
+InterfaceCounters::InterfaceCounters(const QString &iface)
+    : iface(iface), sysfsRoot(QStringLiteral("/sys/class/net")) {
+    for (int &fd : fds)
+        fd = -1;
+}
+
+InterfaceCounters::~InterfaceCounters() {
+    close();
+}
+
+void InterfaceCounters::setSysfsRoot(const QString &root) {
+    close();
+    sysfsRoot = root;
+}
+
+bool InterfaceCounters::open() {
+    close();
+    const QString base = QStringLiteral("%1/%2/statistics/").arg(sysfsRoot, iface);
+    for (int i = 0; i < CounterCount; ++i) {
+        const QByteArray path = QFile::encodeName(base + QLatin1String(kCounterNames[i]));
+        fds[i] = ::open(path.constData(), O_RDONLY | O_CLOEXEC);
+        if (fds[i] < 0) {
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void InterfaceCounters::close() {
+    for (int &fd : fds) {
+        if (fd >= 0)
+            ::close(fd);
+        fd = -1;
+    }
+}
+
+bool InterfaceCounters::isOpen() const {
+    return fds[0] >= 0;
+}
+
+bool InterfaceCounters::read(Sample &out) const {
+    if (!isOpen())
+        return false;
+    // ENODEV here means the interface went away, caller should close() and reopen later
+    if (!readCounter(fds[RxBytes], out.rxBytes)
+        || !readCounter(fds[TxBytes], out.txBytes)
+        || !readCounter(fds[RxPackets], out.rxPackets)
+        || !readCounter(fds[TxPackets], out.txPackets))
+        return false;
+    out.timestampMs = monotonicMs();
+    return true;
+}
+
+QString InterfaceCounters::interfaceName() const {
+    return iface;
+}
+
+qint64 InterfaceCounters::monotonicMs() {
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<qint64>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
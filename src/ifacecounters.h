@@ -0,0 +1,56 @@
+#ifndef IFACECOUNTERS_H
+#define IFACECOUNTERS_H
+
+#include <QString>
+#include <QtGlobal>
+
+// Reads /sys/class/net/<iface>/statistics counters through descriptors opened once,
+// so sampling is a handful of pread() calls with no allocation.
+class InterfaceCounters {
+public:
+    struct Sample {
+        quint64 rxBytes = 0;
+        quint64 txBytes = 0;
+        quint64 rxPackets = 0;
+        quint64 txPackets = 0;
+        qint64 timestampMs = 0; // CLOCK_MONOTONIC
+    };
+
+    explicit InterfaceCounters(const QString &iface = QStringLiteral("CloudflareWARP"));
+
+    ~InterfaceCounters();
+
+    InterfaceCounters(const InterfaceCounters &) = delete;
+
+    InterfaceCounters &operator=(const InterfaceCounters &) = delete;
+
+    // directory holding <iface>/statistics, /sys/class/net unless a test points it elsewhere
+    void setSysfsRoot(const QString &root);
+
+    bool open();
+
+    void close();
+
+    bool isOpen() const;
+
+    bool read(Sample &out) const;
+
+    QString interfaceName() const;
+
+    static qint64 monotonicMs();
+
+private:
+    enum Counter {
+        RxBytes,
+        TxBytes,
+        RxPackets,
+        TxPackets,
+        CounterCount
+    };
+
+    QString iface;
+    QString sysfsRoot;
+    int fds[CounterCount];
+};
+
+#endif // IFACECOUNTERS_H
@@ -0,0 +1,34 @@
+#ifndef LATENCYSTATS_H
+#define LATENCYSTATS_H
+
+#include <QtGlobal>
+#include <algorithm>
+
+// Order statistics over a batch of latency samples (any unit, usually microseconds).
+struct LatencyStats {
+    int count = 0;
+    quint32 min = 0;
+    quint32 median = 0;
+    quint32 p95 = 0;
+    quint32 p99 = 0;
+    quint32 max = 0;
+
+    // sorts values in place, callers pass a scratch copy
+    static LatencyStats compute(quint32 *values, int n) {
+        LatencyStats s;
+        if (n <= 0)
+            return s;
+        std::sort(values, values + n);
+        // nearest-rank percentile
+        auto rank = [&](int pct) { return values[qBound(0, (pct * n + 99) / 100 - 1, n - 1)]; };
+        s.count = n;
+        s.min = values[0];
+        s.median = rank(50);
+        s.p95 = rank(95);
+        s.p99 = rank(99);
+        s.max = values[n - 1];
+        return s;
+    }
+};
+
+#endif // LATENCYSTATS_H
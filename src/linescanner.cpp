@@ -0,0 +1,70 @@
+#include "linescanner.h"
+#include <cstring>
+
+LineScanner::LineScanner(int maxLineBytes) : maxLineBytes(maxLineBytes), remaining(0), skipping(false) {
+}
+
+int LineScanner::addField(const QByteArray &pattern) {
+    Field field;
+    field.pattern = pattern;
+    fields.append(field);
+    ++remaining;
+    return fields.size() - 1;
+}
+
+bool LineScanner::feed(const char *data, qint64 size) {
+    const char *end = data + size;
+    while (data < end && remaining > 0) {
+        const char *nl = static_cast<const char *>(std::memchr(data, '\n', end - data));
+        const char *lineEnd = nl ? nl : end;
+
+        if (!skipping) {
+            if (partial.isEmpty() && nl) {
+                // common case, the whole line is in this chunk, match it in place
+                matchLine(data, lineEnd - data);
+            } else if (partial.size() + (lineEnd - data) > maxLineBytes) {
+                partial.clear();
+                skipping = true;
+            } else {
+                partial.append(data, static_cast<int>(lineEnd - data));
+                if (nl) {
+                    matchLine(partial.constData(), partial.size());
+                    partial.clear();
+                }
+            }
+        }
+
+        if (!nl)
+            break;
+        skipping = false;
+        data = nl + 1;
+    }
+    return done();
+}
+
+void LineScanner::finish() {
+    if (!skipping && !partial.isEmpty())
+        matchLine(partial.constData(), partial.size());
+    partial.clear();
+    skipping = false;
+}
+
+bool LineScanner::done() const {
+    return remaining == 0;
+}
+
+QString LineScanner::line(int field) const {
+    return field >= 0 && field < fields.size() ? fields.at(field).line : QString();
+}
+
+void LineScanner::matchLine(const char *data, qint64 size) {
+    const QByteArray view = QByteArray::fromRawData(data, static_cast<int>(size));
+    for (Field &field : fields) {
+        if (field.matched || !view.contains(field.pattern))
+            continue;
+        // only matching lines are ever decoded
+        field.line = QString::fromUtf8(data, static_cast<int>(size)).trimmed();
+        field.matched = true;
+        --remaining;
+    }
+}
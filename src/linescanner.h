@@ -0,0 +1,46 @@
+#ifndef LINESCANNER_H
+#define LINESCANNER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+// Incremental matcher for command output fed in arbitrary chunks. Each field is a byte pattern,
+// the first line containing it is kept, everything else is dropped as it streams past. Only the
+// current partial line is buffered and that is capped, so output size doesn't matter.
+class LineScanner {
+public:
+    explicit LineScanner(int maxLineBytes = 4096);
+
+    // returns the field index for line()
+    int addField(const QByteArray &pattern);
+
+    // true once every field has matched, no need to feed more after that
+    bool feed(const char *data, qint64 size);
+
+    // end of output, checks a last line without a trailing newline
+    void finish();
+
+    bool done() const;
+
+    // the whole matching line trimmed, empty if not (yet) seen
+    QString line(int field) const;
+
+private:
+    struct Field {
+        QByteArray pattern;
+        QString line;
+        bool matched = false;
+    };
+
+    void matchLine(const char *data, qint64 size);
+
+    QVector<Field> fields;
+    QByteArray partial;
+    int maxLineBytes;
+    int remaining;
+    // the current line went over maxLineBytes, drop it up to the next newline
+    bool skipping;
+};
+
+#endif // LINESCANNER_H
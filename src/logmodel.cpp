@@ -0,0 +1,136 @@
+#include "logmodel.h"
+#include <algorithm>
+
+// very long lines (stack dumps, base64 blobs) are cut so one line cant hold megabytes
+static constexpr int kMaxLineLength = 4096;
+
+LogModel::LogModel(int capacity, QObject *parent)
+    : QAbstractListModel(parent), cap(qMax(1, capacity)), first(0), next(0) {
+    ring.resize(cap);
+}
+
+int LogModel::rowCount(const QModelIndex &parent) const {
+    if (parent.isValid())
+        return 0;
+    if (!filterText.isEmpty())
+        return static_cast<int>(visible.size());
+    return static_cast<int>(next - first);
+}
+
+QVariant LogModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || role != Qt::DisplayRole || index.row() >= rowCount())
+        return QVariant();
+    const quint64 seq = filterText.isEmpty() ? first + index.row() : visible[index.row()];
+    return lineAt(seq);
+}
+
+const QString &LogModel::lineAt(quint64 seq) const {
+    return ring[static_cast<int>(seq % cap)];
+}
+
+bool LogModel::matches(const QString &line) const {
+    return line.contains(filterText, Qt::CaseInsensitive);
+}
+
+void LogModel::appendLines(const QStringList &lines) {
+    if (lines.isEmpty())
+        return;
+    // a burst bigger than the buffer only keeps its tail
+    const int skip = qMax(0, lines.size() - cap);
+    const int k = lines.size() - skip;
+
+    const quint64 newNext = next + k;
+    const quint64 newFirst = newNext - first > static_cast<quint64>(cap) ? newNext - cap : first;
+
+    // drop evicted rows first so the view never sees a row whose text was overwritten
+    if (newFirst > first) {
+        if (filterText.isEmpty()) {
+            const int evicted = static_cast<int>(qMin<quint64>(newFirst, next) - first);
+            if (evicted > 0) {
+                beginRemoveRows(QModelIndex(), 0, evicted - 1);
+                first += evicted;
+                endRemoveRows();
+            }
+        } else {
+            const auto end = std::lower_bound(visible.begin(), visible.end(), newFirst);
+            const int evicted = static_cast<int>(end - visible.begin());
+            if (evicted > 0) {
+                beginRemoveRows(QModelIndex(), 0, evicted - 1);
+                visible.erase(visible.begin(), end);
+                endRemoveRows();
+            }
+        }
+        first = newFirst;
+    }
+
+    if (filterText.isEmpty()) {
+        const int row = static_cast<int>(next - first);
+        beginInsertRows(QModelIndex(), row, row + k - 1);
+        for (int i = skip; i < lines.size(); ++i)
+            ring[static_cast<int>(next++ % cap)] = lines.at(i).left(kMaxLineLength);
+        endInsertRows();
+        return;
+    }
+
+    // match while writing, then announce all new matches in one insert
+    const std::size_t before = visible.size();
+    std::deque<quint64> added;
+    for (int i = skip; i < lines.size(); ++i) {
+        QString &slot = ring[static_cast<int>(next % cap)];
+        slot = lines.at(i).left(kMaxLineLength);
+        if (matches(slot))
+            added.push_back(next);
+        ++next;
+    }
+    if (added.empty())
+        return;
+    const int row = static_cast<int>(before);
+    beginInsertRows(QModelIndex(), row, row + static_cast<int>(added.size()) - 1);
+    visible.insert(visible.end(), added.begin(), added.end());
+    endInsertRows();
+}
+
+void LogModel::setFilter(const QString &text) {
+    if (text == filterText)
+        return;
+    beginResetModel();
+    const QString previous = filterText;
+    filterText = text;
+    if (filterText.isEmpty()) {
+        visible.clear();
+        visible.shrink_to_fit();
+    } else if (!previous.isEmpty() && filterText.contains(previous, Qt::CaseInsensitive)) {
+        // narrowing the filter: only the current matches can still match
+        visible.erase(std::remove_if(visible.begin(), visible.end(),
+                                     [this](quint64 seq) { return !matches(lineAt(seq)); }),
+                      visible.end());
+    } else {
+        visible.clear();
+        for (quint64 seq = first; seq < next; ++seq) {
+            if (matches(lineAt(seq)))
+                visible.push_back(seq);
+        }
+    }
+    endResetModel();
+}
+
+QString LogModel::filter() const {
+    return filterText;
+}
+
+void LogModel::clear() {
+    beginResetModel();
+    for (QString &line : ring)
+        line = QString();
+    first = next = 0;
+    visible.clear();
+    endResetModel();
+}
+
+int LogModel::capacity() const {
+    return cap;
+}
+
+int LogModel::bufferedLines() const {
+    return static_cast<int>(next - first);
+}
@@ -0,0 +1,49 @@
+#ifndef LOGMODEL_H
+#define LOGMODEL_H
+
+#include <QAbstractListModel>
+#include <QString>
+#include <QVector>
+#include <deque>
+
+// Fixed-capacity line buffer behind a list model. Once full, the oldest lines are
+// dropped, so memory stays flat no matter how long the log is followed. With a
+// filter set, the model exposes only matching lines, and the filter is updated
+// incrementally as lines arrive.
+class LogModel : public QAbstractListModel {
+    Q_OBJECT
+
+public:
+    explicit LogModel(int capacity = 200000, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    void appendLines(const QStringList &lines);
+
+    void setFilter(const QString &text);
+
+    QString filter() const;
+
+    void clear();
+
+    int capacity() const;
+
+    int bufferedLines() const;
+
+private:
+    bool matches(const QString &line) const;
+
+    const QString &lineAt(quint64 seq) const;
+
+    QVector<QString> ring;
+    int cap;
+    quint64 first; // sequence number of the oldest buffered line
+    quint64 next;  // sequence number the next line will get
+
+    QString filterText;
+    std::deque<quint64> visible; // matching sequence numbers while filtered
+};
+
+#endif // LOGMODEL_H
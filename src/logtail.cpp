@@ -0,0 +1,157 @@
+#include "logtail.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QProcess>
+#include <sys/stat.h>
+
+static constexpr qint64 kReadChunk = 256 * 1024;
+static constexpr int kMaxPartial = 64 * 1024;
+
+LogTail::LogTail(QObject *parent)
+    : QObject(parent), journal(nullptr), file(nullptr), watcher(nullptr) {
+}
+
+LogTail::~LogTail() {
+    stop();
+}
+
+void LogTail::followJournal(const QString &unit, int backlogLines) {
+    stop();
+    description = QString("journalctl -u %1").arg(unit);
+    journal = new QProcess(this);
+    connect(journal, &QProcess::readyReadStandardOutput, this, &LogTail::readJournal);
+    connect(journal, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart)
+            emit sourceError("journalctl is not available.");
+    });
+    connect(journal, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this,
+            [this](int exitCode, QProcess::ExitStatus) {
+                if (exitCode != 0 && journal)
+                    emit sourceError(QString::fromLocal8Bit(journal->readAllStandardError()).trimmed());
+            });
+    journal->start("journalctl", {"-u", unit, "--follow", "--no-pager", "-o", "short-iso",
+                                  "-n", QString::number(backlogLines)});
+}
+
+void LogTail::followFile(const QString &path, qint64 backlogBytes) {
+    stop();
+    description = path;
+    filePath = path;
+    if (!reopenFile(backlogBytes)) {
+        emit sourceError(QString("Cannot open %1").arg(path));
+        return;
+    }
+    watcher = new QFileSystemWatcher(this);
+    watcher->addPath(path);
+    // the file watch dies with a rotation, the directory tells when the path is back
+    watcher->addPath(QFileInfo(path).absolutePath());
+    connect(watcher, &QFileSystemWatcher::fileChanged, this, &LogTail::readFile);
+    connect(watcher, &QFileSystemWatcher::directoryChanged, this, &LogTail::readFile);
+    readFile();
+}
+
+void LogTail::stop() {
+    if (journal) {
+        journal->disconnect(this);
+        journal->kill();
+        journal->waitForFinished(500);
+        delete journal;
+        journal = nullptr;
+    }
+    delete watcher;
+    watcher = nullptr;
+    delete file;
+    file = nullptr;
+    partial.clear();
+}
+
+QString LogTail::source() const {
+    return description;
+}
+
+bool LogTail::reopenFile(qint64 backlogBytes) {
+    delete file;
+    file = new QFile(filePath, this);
+    if (!file->open(QIODevice::ReadOnly)) {
+        delete file;
+        file = nullptr;
+        return false;
+    }
+    partial.clear();
+    // huge logs: start near the end instead of replaying all of it, -1 reads everything
+    if (backlogBytes >= 0 && file->size() > backlogBytes) {
+        file->seek(file->size() - backlogBytes);
+        file->readLine(kMaxPartial); // drop the cut-off first line
+    }
+    return true;
+}
+
+void LogTail::readFile() {
+    // rotation (file replaced) or truncation: start over on the new file
+    struct stat onDisk{};
+    struct stat opened{};
+    const bool exists = ::stat(QFile::encodeName(filePath).constData(), &onDisk) == 0;
+    const bool replaced = file && exists && ::fstat(file->handle(), &opened) == 0
+                          && opened.st_ino != onDisk.st_ino;
+    if (replaced) {
+        // lines the writer added before it moved on to the new file
+        drainFile();
+        // a watch that followed the old inode would never see the new file change
+        if (watcher)
+            watcher->removePath(filePath);
+    }
+    if (!file || replaced || (exists && onDisk.st_size < file->pos())) {
+        if (!exists || !reopenFile(-1))
+            return;
+    }
+    // inotify drops the watch when the file is replaced
+    if (watcher && !watcher->files().contains(filePath) && exists)
+        watcher->addPath(filePath);
+    drainFile();
+}
+
+void LogTail::drainFile() {
+    if (!file)
+        return;
+    for (;;) {
+        const QByteArray chunk = file->read(kReadChunk);
+        if (chunk.isEmpty())
+            break;
+        splitLines(chunk);
+    }
+}
+
+void LogTail::readJournal() {
+    if (!journal)
+        return;
+    for (;;) {
+        const QByteArray chunk = journal->read(kReadChunk);
+        if (chunk.isEmpty())
+            break;
+        splitLines(chunk);
+    }
+}
+
+void LogTail::splitLines(const QByteArray &data) {
+    QStringList lines;
+    int start = 0;
+    for (int nl = data.indexOf('\n'); nl >= 0; nl = data.indexOf('\n', start)) {
+        if (partial.isEmpty()) {
+            lines << QString::fromUtf8(data.constData() + start, nl - start);
+        } else {
+            partial.append(data.constData() + start, nl - start);
+            lines << QString::fromUtf8(partial);
+            partial.clear();
+        }
+        start = nl + 1;
+    }
+    partial.append(data.constData() + start, data.size() - start);
+    // a writer that never sends a newline must not grow this forever
+    if (partial.size() > kMaxPartial) {
+        lines << QString::fromUtf8(partial);
+        partial.clear();
+    }
+    if (!lines.isEmpty())
+        emit linesAppended(lines);
+}
@@ -0,0 +1,55 @@
+#ifndef LOGTAIL_H
+#define LOGTAIL_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QStringList>
+
+class QFile;
+class QFileSystemWatcher;
+class QProcess;
+
+// Streams a log incrementally: either "journalctl --follow" for a unit, or a plain file
+// followed through inotify (QFileSystemWatcher). Only the new bytes are read each time.
+class LogTail : public QObject {
+    Q_OBJECT
+
+public:
+    explicit LogTail(QObject *parent = nullptr);
+
+    ~LogTail();
+
+    void followJournal(const QString &unit, int backlogLines = 5000);
+
+    void followFile(const QString &path, qint64 backlogBytes = 4 * 1024 * 1024);
+
+    void stop();
+
+    QString source() const;
+
+signals:
+    void linesAppended(const QStringList &lines);
+
+    void sourceError(const QString &message);
+
+private:
+    void readJournal();
+
+    void readFile();
+
+    // everything appended to the open file since the last read
+    void drainFile();
+
+    bool reopenFile(qint64 backlogBytes);
+
+    void splitLines(const QByteArray &data);
+
+    QProcess *journal;
+    QFile *file;
+    QFileSystemWatcher *watcher;
+    QString filePath;
+    QByteArray partial;
+    QString description;
+};
+
+#endif // LOGTAIL_H
@@ -0,0 +1,123 @@
+#include "logviewer.h"
+#include "logmodel.h"
+#include "logtail.h"
+#include <QCheckBox>
+#include <QComboBox>
+#include <QFileDialog>
+#include <QFontDatabase>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QLineEdit>
+#include <QListView>
+#include <QScrollBar>
+#include <QTimer>
+#include <QVBoxLayout>
+
+static const QString kDaemonLogFile = QStringLiteral("/var/log/cloudflare-warp/cfwarp_service_log.txt");
+
+LogViewer::LogViewer(QWidget *parent)
+    : QDialog(parent), filterDebounce(new QTimer(this)), model(new LogModel(200000, this)),
+      tail(new LogTail(this)) {
+    setWindowTitle("warp-svc Log");
+    resize(760, 480);
+    setupUI();
+
+    filterDebounce->setSingleShot(true);
+    filterDebounce->setInterval(150);
+    connect(filterDebounce, &QTimer::timeout, this, &LogViewer::applyFilter);
+    connect(tail, &LogTail::linesAppended, this, &LogViewer::onLinesAppended);
+    connect(tail, &LogTail::sourceError, this, [this](const QString &message) {
+        sourceError = message;
+        updateStatus();
+    });
+
+    changeSource(0);
+}
+
+void LogViewer::setupUI() {
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+
+    comboSource = new QComboBox(this);
+    comboSource->addItems({"warp-svc journal", "Daemon log file", "Other file..."});
+    editFilter = new QLineEdit(this);
+    editFilter->setPlaceholderText("Filter");
+    editFilter->setClearButtonEnabled(true);
+    checkFollow = new QCheckBox("Follow", this);
+    checkFollow->setChecked(true);
+
+    QHBoxLayout *topRow = new QHBoxLayout();
+    topRow->addWidget(comboSource);
+    topRow->addWidget(editFilter, 1);
+    topRow->addWidget(checkFollow);
+    mainLayout->addLayout(topRow);
+
+    view = new QListView(this);
+    view->setModel(model);
+    // every row has the same height, so the view only lays out what is on screen
+    view->setUniformItemSizes(true);
+    view->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    view->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    view->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    mainLayout->addWidget(view, 1);
+
+    labelStatus = new QLabel(this);
+    mainLayout->addWidget(labelStatus);
+
+    connect(comboSource, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &LogViewer::changeSource);
+    connect(editFilter, &QLineEdit::textChanged, filterDebounce, QOverload<>::of(&QTimer::start));
+    // scrolling up pauses follow, back at the bottom resumes it
+    connect(view->verticalScrollBar(), &QScrollBar::valueChanged, this, [this](int value) {
+        checkFollow->setChecked(value == view->verticalScrollBar()->maximum());
+    });
+}
+
+void LogViewer::changeSource(int index) {
+    model->clear();
+    sourceError.clear();
+    switch (index) {
+        case 0:
+            tail->followJournal("warp-svc");
+            break;
+        case 1:
+            tail->followFile(kDaemonLogFile);
+            break;
+        default: {
+            const QString path = QFileDialog::getOpenFileName(this, "Open Log File");
+            if (path.isEmpty()) {
+                tail->stop();
+                labelStatus->setText("No file selected.");
+                return;
+            }
+            tail->followFile(path);
+            break;
+        }
+    }
+    updateStatus();
+}
+
+void LogViewer::applyFilter() {
+    model->setFilter(editFilter->text());
+    if (checkFollow->isChecked())
+        view->scrollToBottom();
+    updateStatus();
+}
+
+void LogViewer::onLinesAppended(const QStringList &lines) {
+    const bool follow = checkFollow->isChecked();
+    model->appendLines(lines);
+    if (follow)
+        view->scrollToBottom();
+    updateStatus();
+}
+
+void LogViewer::updateStatus() {
+    QString text = QString("%1 - %2 lines buffered (max %3)")
+            .arg(tail->source())
+            .arg(model->bufferedLines())
+            .arg(model->capacity());
+    if (!model->filter().isEmpty())
+        text += QString(", %1 matching").arg(model->rowCount());
+    if (!sourceError.isEmpty())
+        text = sourceError + " (" + text + ")";
+    labelStatus->setText(text);
+}
@@ -0,0 +1,44 @@
+#ifndef LOGVIEWER_H
+#define LOGVIEWER_H
+
+#include <QDialog>
+
+class QCheckBox;
+class QComboBox;
+class QLabel;
+class QLineEdit;
+class QListView;
+class QTimer;
+class LogModel;
+class LogTail;
+
+class LogViewer : public QDialog {
+    Q_OBJECT
+
+public:
+    explicit LogViewer(QWidget *parent = nullptr);
+
+private slots:
+    void changeSource(int index);
+
+    void applyFilter();
+
+    void onLinesAppended(const QStringList &lines);
+
+private:
+    void setupUI();
+
+    void updateStatus();
+
+    QComboBox *comboSource;
+    QLineEdit *editFilter;
+    QCheckBox *checkFollow;
+    QListView *view;
+    QLabel *labelStatus;
+    QTimer *filterDebounce;
+    LogModel *model;
+    LogTail *tail;
+    QString sourceError;
+};
+
+#endif // LOGVIEWER_H
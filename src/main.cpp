@@ -1,16 +1,114 @@
+#include "headless.h"
 #include "mainfunctions.h"
+#include "memoryusage.h"
+#include "settingsstore.h"
 #include "systray.h"
 #include "widget.h"
 #include <QApplication>
 #include <QCommandLineParser>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QLockFile>
 #include <QMessageBox>
-#include <QSettings>
 #include <QStandardPaths>
 #include <QThreadPool>
+#include <QTimer>
+#include <cstdio>
+#include <cstring>
+#ifdef WARPQT_PGO_TRAINING
+#include "pgotraining.h"
+#endif
+
+namespace {
+    // decided before any application object exists, the headless modes never create a QApplication
+    bool hasArgument(int argc, char *argv[], const char *name) {
+        for (int i = 1; i < argc; ++i) {
+            if (std::strcmp(argv[i], name) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    QString lockFilePath() {
+        const QString user = QString::fromLocal8Bit(qgetenv("USER"));
+        const QString lockName =
+                QString("warp-qt.%1.lock")
+                .arg(user.isEmpty() ? QStringLiteral("default") : user);
+        return QDir::temp().absoluteFilePath(lockName);
+    }
+
+    void addOptions(QCommandLineParser &parser) {
+        parser.setApplicationDescription("Qt6 GUI for Cloudflare Warp");
+        parser.addHelpOption();
+        // parser.addVersionOption();
+        parser.addOption({"show", "Start with the window visible."});
+        parser.addOption({"status", "Print the connection status and exit (no GUI)."});
+        parser.addOption({"daemon", "Track the connection without a tray icon (no GUI)."});
+        parser.addOption({"broker", "Probe for every session on this host and serve the state on a socket (no GUI)."});
+        parser.addOption({"broker-group", "Only let members of <group> subscribe to the broker.", "group"});
+
+        // for pgo/train.sh reports: print startup time and RSS, stay idle <ms>, print RSS, quit
+        QCommandLineOption measure("measure-startup", "Report startup time and idle RSS, then quit.", "ms");
+        measure.setFlags(QCommandLineOption::HiddenFromHelp);
+        parser.addOption(measure);
+#ifdef WARPQT_PGO_TRAINING
+        parser.addOption({"pgo-train", "Run the scripted profile training workload and quit."});
+#endif
+    }
+
+    void measureStartup(const QElapsedTimer &sinceMain, int idleMs) {
+        // first pass through the event loop: tray set up, warm start rendered
+        QTimer::singleShot(0, [sinceMain, idleMs]() {
+            std::printf("startup_ms=%lld startup_rss_kb=%lld\n", static_cast<long long>(sinceMain.elapsed()),
+                        static_cast<long long>(MemoryUsage::residentBytes() / 1024));
+            QTimer::singleShot(idleMs, []() {
+                std::printf("idle_rss_kb=%lld\n", static_cast<long long>(MemoryUsage::residentBytes() / 1024));
+                std::fflush(stdout);
+                QCoreApplication::quit();
+            });
+        });
+    }
+
+    void configureThreadPool() {
+        // thread pool
+        QThreadPool::globalInstance()->setMaxThreadCount(1);
+        QThreadPool::globalInstance()->setExpiryTimeout(3000);
+    }
+} // namespace
 
 int main(int argc, char *argv[]) {
+    QElapsedTimer sinceMain;
+    sinceMain.start();
+    QCoreApplication::setApplicationName("cloudflare-warp-qt");
+    QCoreApplication::setOrganizationName("warp-qt");
+    // a.setApplicationVersion("1.0");
+    //  I feel this application is too early for versioning, this is here so i can
+    //  put it later (i.e so i dont forget) while cmake still has a versioning
+    //  number im too lazy to care atp
+
+    if (hasArgument(argc, argv, "--status") || hasArgument(argc, argv, "--daemon")
+        || hasArgument(argc, argv, "--broker")) {
+        QCoreApplication app(argc, argv);
+        configureThreadPool();
+        QCommandLineParser parser;
+        addOptions(parser);
+        parser.process(app);
+
+        if (parser.isSet("status"))
+            return Headless::status();
+        // one per host, refused by the socket itself when another one is running
+        if (parser.isSet("broker"))
+            return Headless::broker(parser.value("broker-group"));
+
+        // shares the lock with the tray, two trackers would record every change twice
+        QLockFile lockFile(lockFilePath());
+        if (!lockFile.tryLock(1500)) {
+            std::fprintf(stderr, "cloudflare-warp-qt is already running\n");
+            return 1;
+        }
+        return Headless::daemon();
+    }
+
     // turn off unnecessary features
     QCoreApplication::setAttribute(Qt::AA_DontCreateNativeWidgetSiblings);
     QCoreApplication::setAttribute(Qt::AA_DisableShaderDiskCache);
@@ -18,24 +116,10 @@ int main(int argc, char *argv[]) {
         Qt::AA_UseSoftwareOpenGL); // Force software rendering
 
     QApplication a(argc, argv);
-
-    // thread pool
-    QThreadPool::globalInstance()->setMaxThreadCount(1);
-    QThreadPool::globalInstance()->setExpiryTimeout(3000);
-
-    a.setApplicationName("cloudflare-warp-qt");
-    a.setOrganizationName("warp-qt");
-    // a.setApplicationVersion("1.0");
-    //  I feel this application is too early for versioning, this is here so i can
-    //  put it later (i.e so i dont forget) while cmake still has a versioning
-    //  number im too lazy to care atp
+    configureThreadPool();
     a.setQuitOnLastWindowClosed(false);
 
-    const QString user = QString::fromLocal8Bit(qgetenv("USER"));
-    const QString lockName =
-            QString("warp-qt.%1.lock")
-            .arg(user.isEmpty() ? QStringLiteral("default") : user);
-    QLockFile lockFile(QDir::temp().absoluteFilePath(lockName));
+    QLockFile lockFile(lockFilePath());
 
     if (!lockFile.tryLock(1500)) {
         QMessageBox::warning(
@@ -45,25 +129,26 @@ int main(int argc, char *argv[]) {
     }
 
     QCommandLineParser parser;
-    parser.setApplicationDescription("Qt6 GUI for Cloudflare Warp");
-    parser.addHelpOption();
-    // parser.addVersionOption();
-
-    QCommandLineOption showOption("show", "Start with the window visible.");
-    parser.addOption(showOption);
+    addOptions(parser);
     parser.process(a);
 
     MainFunctions mainFuncs;
     SysTray tray(&mainFuncs);
     tray.setupTray();
 
-    QSettings settings;
-    bool showFromConfig = settings.value("showOnStart", false).toBool();
-    bool showFromCLI = parser.isSet(showOption);
+    bool showFromConfig = SettingsStore::instance().flag(SettingsStore::Key::ShowOnStart);
+    bool showFromCLI = parser.isSet("show");
 
     if (showFromConfig || showFromCLI) {
         tray.ensureWidget()->show();
     }
 
+    if (parser.isSet("measure-startup"))
+        measureStartup(sinceMain, parser.value("measure-startup").toInt());
+#ifdef WARPQT_PGO_TRAINING
+    if (parser.isSet("pgo-train"))
+        PgoTraining::run(tray);
+#endif
+
     return a.exec();
-}
\ No newline at end of file
+}
@@ -6,35 +6,255 @@
 #include <QPointer>
 #include <QFile>
 #include <QStandardPaths>
-#include <QMessageBox>
-#include <map>
+#include <QRandomGenerator>
+#include <QTimer>
+#include <QRegularExpression>
+#include <QElapsedTimer>
+#include <atomic>
+#include "commandtranscript.h"
+#include "linescanner.h"
+#include "settingsstore.h"
+
+// connect retry backoff: base * 2^attempt capped, with equal jitter
+static constexpr int kRetryBaseMs = 1000;
+static constexpr int kRetryCapMs = 60000;
+static constexpr int kRetryMaxAttempts = 8;
+
+// per stream, a tool that floods its pipes cant make us buffer more than this
+static constexpr int kMaxOutputBytes = 1 << 20;
+// how long output may pile up inside QProcess before we take it out
+static constexpr int kDrainSliceMs = 100;
+
+// shown when the service check fails and when connect retries give up on a stopped service
+static const char kServiceDownMessage[] = "The 'warp-svc' service is not running.\n\n"
+                                          "Please enable it by running:\n"
+                                          "pkexec systemctl start warp-svc";
 
 namespace {
+    std::atomic<int> truncatedCommands{0};
+
+    void appendCapped(QByteArray &buf, const QByteArray &chunk, bool &truncated) {
+        const int room = kMaxOutputBytes - buf.size();
+        if (chunk.size() > room) {
+            truncated = true;
+            buf.append(chunk.constData(), qMax(room, 0));
+            return;
+        }
+        buf.append(chunk);
+    }
+
+    // runs the command and fills in the raw outcome, decoding is left to resultFromEntry()
+    void runProcess(const QString &program, const QStringList &arguments, int timeoutMs,
+                    CommandTranscript::Entry &entry, bool &truncated) {
+        QProcess process;
+        process.start(program, arguments);
+
+        if (!process.waitForStarted(timeoutMs)) {
+            // missing or not executable is final, only a slow start is a timeout
+            entry.timedOut = process.error() == QProcess::Timedout;
+            entry.exitCode = entry.timedOut ? -1 : MainFunctions::kExitFailedToStart;
+            entry.err = process.errorString().toUtf8();
+            return;
+        }
+        QElapsedTimer clock;
+        clock.start();
+        // drain while it runs instead of letting QProcess buffer everything until exit
+        while (process.state() != QProcess::NotRunning) {
+            const qint64 left = timeoutMs - clock.elapsed();
+            if (left <= 0) {
+                entry.timedOut = true;
+                entry.exitCode = -1;
+                entry.err = "Command timed out";
+                process.kill();
+                process.waitForFinished(1000);
+                return;
+            }
+            process.waitForReadyRead(static_cast<int>(qMin<qint64>(left, kDrainSliceMs)));
+            appendCapped(entry.out, process.readAllStandardOutput(), truncated);
+            appendCapped(entry.err, process.readAllStandardError(), truncated);
+        }
+        appendCapped(entry.out, process.readAllStandardOutput(), truncated);
+        appendCapped(entry.err, process.readAllStandardError(), truncated);
+        entry.exitCode = process.exitCode();
+    }
+
+    MainFunctions::CommandResult resultFromEntry(const CommandTranscript::Entry &entry) {
+        MainFunctions::CommandResult res;
+        res.timedOut = entry.timedOut;
+        res.exitCode = entry.timedOut ? -1 : entry.exitCode;
+        res.out = QString::fromUtf8(entry.out).trimmed();
+        res.err = QString::fromUtf8(entry.err).trimmed();
+        return res;
+    }
+
+    // every blocking command goes through here, which makes it the place to record and replay;
+    // CommandBatch and DiagnosticsBundle run theirs on the event loop and do the same themselves
     MainFunctions::CommandResult runCommandResultInternal(const QString &program,
                                                           const QStringList &arguments,
                                                           int timeoutMs) {
+        CommandTranscript::Entry entry;
+        if (CommandTranscript::isReplaying()) {
+            if (!CommandTranscript::replay(program, arguments, entry)) {
+                entry.exitCode = MainFunctions::kExitFailedToStart;
+                entry.err = "Not in the replayed transcript";
+            }
+            return resultFromEntry(entry);
+        }
+
+        bool truncated = false;
+        QElapsedTimer clock;
+        clock.start();
+        runProcess(program, arguments, timeoutMs, entry, truncated);
+        MainFunctions::CommandResult res = resultFromEntry(entry);
+        res.truncated = truncated;
+        if (truncated) {
+            ++truncatedCommands;
+            qWarning() << program << arguments << "printed more than" << kMaxOutputBytes << "bytes, the rest was dropped";
+        }
+        if (CommandTranscript::isRecording()) {
+            entry.program = program;
+            entry.arguments = arguments;
+            entry.latencyMs = static_cast<quint32>(clock.elapsed());
+            CommandTranscript::record(std::move(entry));
+        }
+        return res;
+    }
+
+    // Feeds stdout to the scanner as it arrives and stops the child once every field was found,
+    // warp-cli settings goes on for a long time with big split tunnel lists. Returns false on
+    // timeout or if the output ended without all fields.
+    bool scanCommandInternal(const QString &program, const QStringList &arguments, int timeoutMs,
+                             LineScanner &scanner) {
+        CommandTranscript::Entry entry;
+        if (CommandTranscript::isReplaying()) {
+            if (CommandTranscript::replay(program, arguments, entry, true)) {
+                scanner.feed(entry.out.constData(), entry.out.size());
+                scanner.finish();
+            }
+            return scanner.done();
+        }
+
         QProcess process;
+        // not looked at here, dont let it pile up
+        process.setStandardErrorFile(QProcess::nullDevice());
         process.start(program, arguments);
+        if (!process.waitForStarted(timeoutMs))
+            return false;
 
-        MainFunctions::CommandResult res;
-        if (!process.waitForFinished(timeoutMs)) {
-            res.timedOut = true;
-            res.exitCode = -1;
-            res.err = QStringLiteral("Command timed out");
-            process.kill();
-            process.waitForFinished(1000);
-            return res;
+        const bool recording = CommandTranscript::isRecording();
+        bool truncated = false;
+        char buf[4096];
+        QElapsedTimer clock;
+        clock.start();
+        while (!scanner.done()) {
+            while (!scanner.done() && process.bytesAvailable() > 0) {
+                const qint64 n = process.read(buf, sizeof(buf));
+                if (n <= 0)
+                    break;
+                scanner.feed(buf, n);
+                // only what the scan consumed, the early stop is part of the behaviour
+                if (recording)
+                    appendCapped(entry.out, QByteArray::fromRawData(buf, static_cast<int>(n)), truncated);
+            }
+            if (scanner.done() || process.state() == QProcess::NotRunning)
+                break;
+            const qint64 left = timeoutMs - clock.elapsed();
+            if (left <= 0) {
+                entry.timedOut = true;
+                break;
+            }
+            process.waitForReadyRead(static_cast<int>(qMin<qint64>(left, kDrainSliceMs)));
+        }
+        if (!scanner.done() && process.state() == QProcess::NotRunning)
+            scanner.finish();
+
+        if (process.state() != QProcess::NotRunning) {
+            // got what we came for (or gave up), the rest of the output is of no use
+            process.terminate();
+            if (!process.waitForFinished(500)) {
+                process.kill();
+                process.waitForFinished(500);
+            }
+        } else {
+            entry.exitCode = process.exitCode();
         }
 
-        res.exitCode = process.exitCode();
-        res.out = QString::fromUtf8(process.readAllStandardOutput()).trimmed();
-        res.err = QString::fromUtf8(process.readAllStandardError()).trimmed();
-        return res;
+        if (recording) {
+            entry.program = program;
+            entry.arguments = arguments;
+            entry.latencyMs = static_cast<quint32>(clock.elapsed());
+            entry.scan = true;
+            CommandTranscript::record(std::move(entry));
+        }
+        return scanner.done();
+    }
+
+    int retryDelayMs(int attempt) {
+        qint64 delay = kRetryBaseMs;
+        for (int i = 0; i < attempt && delay < kRetryCapMs; ++i)
+            delay *= 2;
+        delay = qMin<qint64>(delay, kRetryCapMs);
+        // half fixed, half random so many clients dont retry in lockstep after a daemon restart
+        const int half = static_cast<int>(delay / 2);
+        return half + static_cast<int>(QRandomGenerator::global()->bounded(half + 1));
+    }
+
+    WarpMode modeFromSettings(const QString &settingsOut) {
+        static const QRegularExpression re(R"(Mode:\s*([A-Za-z0-9]+))");
+        const QRegularExpressionMatch match = re.match(settingsOut);
+        return match.hasMatch() ? WarpModes::fromDaemonName(match.captured(1)) : WarpMode::Unknown;
+    }
+
+    // "Mode: WarpProxy on port 40000", 0 if warp-cli didnt say
+    quint16 proxyPortFromSettings(const QString &settingsOut) {
+        static const QRegularExpression portRe(R"(Mode:\s*WarpProxy\s+on\s+port\s+(\d+))");
+        const QRegularExpressionMatch match = portRe.match(settingsOut);
+        return match.hasMatch() ? static_cast<quint16>(match.captured(1).toUInt()) : 0;
+    }
+
+    // the "Mode: ..." line of warp-cli settings, mode and proxy port both come from it
+    QString settingsModeLine(int timeoutMs) {
+        LineScanner scanner;
+        const int field = scanner.addField("Mode:");
+        scanCommandInternal("warp-cli", {"settings"}, timeoutMs, scanner);
+        return scanner.line(field);
+    }
+
+    bool connectedInMode(WarpMode mode, quint16 proxyPort, SockDiag &sockDiag) {
+        switch (WarpModes::info(mode).detection) {
+            case WarpModes::Detection::ResolvConf: {
+                // DNS-only modes don't create a CloudflareWARP interface
+                // Check resolv.conf for local DNS proxy instead
+                QFile file("/etc/resolv.conf");
+                if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+                    return false;
+                QString content = QString::fromUtf8(file.readAll());
+                file.close();
+                // WARP uses 127.0.0.2 or 127.0.2.2 as local DNS proxy
+                return content.contains("127.0.0.2") || content.contains("127.0.2.2");
+            }
+            case WarpModes::Detection::ProxyListener:
+                // Proxy mode creates a local SOCKS5/HTTP proxy (port 40000 unless changed with
+                // warp-cli proxy port), ask the kernel for a listener instead of parsing /proc/net/tcp
+                return sockDiag.isTcpListening(proxyPort) == 1;
+            case WarpModes::Detection::TunnelInterface:
+                break;
+        }
+
+        // Tunnel modes (warp, warp+doh, warp+dot, tunnel_only)
+        // check for the CloudflareWARP interface
+        const MainFunctions::CommandResult res = runCommandResultInternal("ip", {"addr", "show", "CloudflareWARP"}, 2000);
+        return !res.timedOut && res.exitCode == 0;
+
+        // other modes like device posture only dont do shit anyways and are for org usage
+        // i dont really think there is anything to check there?? idk
     }
 } // namespace
 
-MainFunctions::MainFunctions(QObject *parent) : QObject(parent) {
-    refreshCachedMode();
+MainFunctions::MainFunctions(QObject *parent) : QObject(parent), retryTimer(new QTimer(this)) {
+    retryTimer->setSingleShot(true);
+    connect(retryTimer, &QTimer::timeout, this, &MainFunctions::retryConnect);
+    // the mode is seeded from the last snapshot and confirmed by probeStateAsync()
 }
 
 QString MainFunctions::runCommand(const QString &program, const QStringList &arguments) {
@@ -51,6 +271,11 @@ MainFunctions::CommandResult MainFunctions::runCommandResult(const QString &prog
     return runCommandResultInternal(program, arguments, timeoutMs);
 }
 
+bool MainFunctions::scanCommand(const QString &program, const QStringList &arguments, int timeoutMs,
+                                LineScanner &scanner) {
+    return scanCommandInternal(program, arguments, timeoutMs, scanner);
+}
+
 QFuture<MainFunctions::CommandResult> MainFunctions::runCommandAsync(const QString &program,
                                                                      const QStringList &arguments,
                                                                      int timeoutMs) {
@@ -63,10 +288,8 @@ void MainFunctions::cliConnect() {
     if (isConnecting || isDisconnecting)
         return; // Prevent concurrent operations
     isConnecting = true;
-    if (!isServiceActive()) {
-        isConnecting = false;
-        return;
-    }
+    // no isServiceActive() here, it would show its own dialog: a stopped service fails the
+    // connect as ServiceDown and handleConnectResult reports that once
     QFuture<CommandResult> future = cliConnectAsync();
     QPointer < MainFunctions > self(this);
     auto watcher = new QFutureWatcher<CommandResult>(this);
@@ -76,11 +299,7 @@ void MainFunctions::cliConnect() {
         if (!self) return;
 
         self->isConnecting = false;
-        if (res.timedOut || res.exitCode != 0 || !res.out.contains("Success", Qt::CaseInsensitive)) {
-            const QString msg = res.err.isEmpty() ? QStringLiteral("Connection failed or timed out.") : res.err;
-            emit
-            self->errorOccurred(QStringLiteral("Warp Connect Error"), msg);
-        }
+        self->handleConnectResult(res);
     });
     watcher->setFuture(future);
 }
@@ -90,6 +309,7 @@ QFuture<MainFunctions::CommandResult> MainFunctions::cliConnectAsync() {
 }
 
 void MainFunctions::cliDisconnect() {
+    cancelConnectRetry();
     if (isConnecting || isDisconnecting)
         return;
     isDisconnecting = true;
@@ -120,14 +340,178 @@ QFuture<MainFunctions::CommandResult> MainFunctions::cliDisconnectAsync() {
     // why the fuck does warp-cli reason this as "settings changed", but not for the connect..?
 }
 
-void MainFunctions::cliRegister() {
-    QMessageBox::information(
-        nullptr,
-        QStringLiteral("Accept Terms of Service"),
-        QStringLiteral("Cloudflare WARP requires accepting its Terms of Service in a terminal once.\n\n"
-                       "A terminal window will now open. Please complete registration and close it when finished.")
-    );
+MainFunctions::FailureKind MainFunctions::classifyConnectResult(const CommandResult &res) {
+    if (res.timedOut)
+        return FailureKind::Timeout;
+    if (res.exitCode == kExitFailedToStart)
+        return FailureKind::NotInstalled;
+    if (res.exitCode == 0 && res.out.contains("Success", Qt::CaseInsensitive))
+        return FailureKind::None;
+
+    const QString text = (res.out + QLatin1Char('\n') + res.err).toLower();
+    if (text.contains("registration missing") || text.contains("missing registration")
+        || text.contains("not registered"))
+        return FailureKind::NotRegistered;
+    // warp-cli cant reach warp-svc over its socket (stopped, restarting or crashed)
+    if (text.contains("service is not running") || text.contains("error communicating with daemon")
+        || text.contains("unable to connect to the cloudflarewarp daemon")
+        || text.contains("connection refused") || text.contains("no such file or directory"))
+        return FailureKind::ServiceDown;
+    return FailureKind::DaemonError;
+}
+
+bool MainFunctions::isRetryable(FailureKind kind) {
+    switch (kind) {
+        case FailureKind::Timeout:
+        case FailureKind::ServiceDown:
+        case FailureKind::DaemonError:
+            return true;
+        case FailureKind::None:
+        case FailureKind::NotRegistered:
+        case FailureKind::NotInstalled:
+            break;
+    }
+    return false;
+}
+
+QString MainFunctions::failureKindName(FailureKind kind) {
+    switch (kind) {
+        case FailureKind::None: return QStringLiteral("ok");
+        case FailureKind::Timeout: return QStringLiteral("timed out");
+        case FailureKind::ServiceDown: return QStringLiteral("service down");
+        case FailureKind::NotRegistered: return QStringLiteral("not registered");
+        case FailureKind::DaemonError: return QStringLiteral("daemon error");
+        case FailureKind::NotInstalled: return QStringLiteral("not installed");
+    }
+    return QString();
+}
+
+int MainFunctions::truncatedCommandCount() {
+    return truncatedCommands.load();
+}
+
+void MainFunctions::handleConnectResult(const CommandResult &res) {
+    const FailureKind kind = classifyConnectResult(res);
+    if (kind == FailureKind::None) {
+        if (retryAttempt > 0)
+            stopRetry(true);
+        return;
+    }
+
+    emit connectFailed(kind);
+    if (!isRetryable(kind) || retryAttempt >= kRetryMaxAttempts) {
+        if (retryAttempt > 0) {
+            stats.exhausted++;
+            stopRetry(false);
+        }
+        QString msg = res.err.isEmpty() ? QStringLiteral("Connection failed or timed out.") : res.err;
+        if (kind == FailureKind::NotRegistered)
+            msg = QStringLiteral("This device is not registered.\n\n"
+                                 "Use Preferences -> Register New Device to register it.");
+        else if (kind == FailureKind::NotInstalled)
+            msg = QStringLiteral("warp-cli could not be started: %1").arg(res.err);
+        else if (kind == FailureKind::ServiceDown)
+            msg = QString::fromLatin1(kServiceDownMessage);
+        emit errorOccurred(QStringLiteral("Warp Connect Error"), msg);
+        return;
+    }
+
+    if (retryAttempt == 0)
+        recoveryClock.start();
+    const int delay = retryDelayMs(retryAttempt);
+    retryAttempt++;
+    if (!retryPaused)
+        retryTimer->start(delay);
+    qInfo() << "warp connect failed (" << failureKindName(kind) << "), retry" << retryAttempt
+            << "of" << kRetryMaxAttempts << "in" << delay << "ms";
+    emit connectRetryScheduled(retryAttempt, kRetryMaxAttempts, delay, failureKindName(kind));
+}
+
+void MainFunctions::retryConnect() {
+    if (retryPaused)
+        return;
+    if (isConnecting || isDisconnecting) {
+        // someone else is driving the connection, check back later
+        retryTimer->start(kRetryBaseMs);
+        return;
+    }
+    if (isWarpConnected()) {
+        stopRetry(true);
+        return;
+    }
+
+    isConnecting = true;
+    QPointer < MainFunctions > self(this);
+    auto watcher = new QFutureWatcher<CommandResult>(this);
+    connect(watcher, &QFutureWatcher<CommandResult>::finished, watcher, [self, watcher]() {
+        const CommandResult res = watcher->result();
+        watcher->deleteLater();
+        if (!self) return;
+
+        self->isConnecting = false;
+        // cancelled while the attempt was in flight
+        if (self->retryAttempt == 0) return;
+        self->handleConnectResult(res);
+    });
+    watcher->setFuture(cliConnectAsync());
+}
 
+void MainFunctions::stopRetry(bool recovered) {
+    retryTimer->stop();
+    if (recovered) {
+        const qint64 elapsed = recoveryClock.elapsed();
+        stats.recoveries++;
+        stats.lastRecoveryMs = elapsed;
+        stats.totalRecoveryMs += elapsed;
+        qInfo() << "warp connect recovered after" << retryAttempt << "retries in" << elapsed << "ms";
+    }
+    retryAttempt = 0;
+    emit connectRetryStopped(recovered);
+}
+
+void MainFunctions::cancelConnectRetry() {
+    if (retryAttempt > 0)
+        stopRetry(false);
+}
+
+bool MainFunctions::isRetryPending() const {
+    return retryAttempt > 0;
+}
+
+MainFunctions::RetryStats MainFunctions::retryStats() const {
+    return stats;
+}
+
+void MainFunctions::setRetryPaused(bool paused) {
+    retryPaused = paused;
+    if (paused) {
+        retryTimer->stop();
+        return;
+    }
+    // the network may still be coming back, give it the base delay instead of the remainder
+    if (retryAttempt > 0 && !retryTimer->isActive())
+        retryTimer->start(kRetryBaseMs);
+}
+
+void MainFunctions::reconnect() {
+    if (isConnecting || isDisconnecting)
+        return;
+    cancelConnectRetry();
+    isDisconnecting = true;
+    QPointer < MainFunctions > self(this);
+    auto watcher = new QFutureWatcher<CommandResult>(this);
+    connect(watcher, &QFutureWatcher<CommandResult>::finished, watcher, [self, watcher]() {
+        watcher->deleteLater();
+        if (!self) return;
+
+        self->isDisconnecting = false;
+        // connect goes through the retry policy in case the daemon is still renegotiating
+        self->cliConnect();
+    });
+    watcher->setFuture(cliDisconnectAsync());
+}
+
+bool MainFunctions::cliRegister() {
     const QString command = "warp-cli --accept-tos registration new";
     const QStringList terminals = {
         "x-terminal-emulator",
@@ -150,14 +534,9 @@ void MainFunctions::cliRegister() {
             args = {"-e", "bash", "-c", bashCommand};
 
         QProcess::startDetached(term, args);
-        return;
+        return true;
     }
-
-    QMessageBox::critical(
-        nullptr,
-        QStringLiteral("Terminal Error"),
-        QStringLiteral("No supported terminal emulator found.")
-    );
+    return false;
 }
 
 QString MainFunctions::cliStatus() {
@@ -181,85 +560,70 @@ bool MainFunctions::isServiceActive() {
         return true;
     }
 
-    emit errorOccurred("Service Error",
-                       "The 'warp-svc' service is not running.\n\n"
-                       "Please enable it by running:\n"
-                       "pkexec systemctl start warp-svc");
+    emit errorOccurred("Service Error", kServiceDownMessage);
     return false;
 }
 
-std::map<QString, QString> SettingsModeOutputNormalized = {
-    {"Warp", "warp"},
-    {"DnsOverHttps", "doh"},
-    {"WarpWithDnsOverHttps", "warp+doh"},
-    {"DnsOverTls", "dot"},
-    {"WarpWithDnsOverTls", "warp+dot"},
-    {"WarpProxy", "proxy"}, // not sure how well this works
-    {"TunnelOnly", "tunnel_only"},
-    {"PostureOnly", "Device Information Only?"},
-    // cloudflare docs fucking suck and idk how else this will function for some modes..
-};
-
-QString MainFunctions::GetCurrentMode() {
-    CommandResult output = runCommandResult("warp-cli", {"settings"});
-
-    QRegularExpression re(R"(Mode:\s*([A-Za-z0-9]+))");
-    QRegularExpressionMatch match = re.match(output.out);
-    if (match.hasMatch()) {
-        QString outmatch = match.captured(1);
-
-        auto it = SettingsModeOutputNormalized.find(outmatch);
-        return it != SettingsModeOutputNormalized.end() ? it->second : QString();
-    }
-    return QString();
+WarpMode MainFunctions::GetCurrentMode() {
+    return modeFromSettings(settingsModeLine(3000));
 }
 
 void MainFunctions::refreshCachedMode() {
-    cachedMode = GetCurrentMode();
+    const QString modeLine = settingsModeLine(3000);
+    cachedMode = modeFromSettings(modeLine);
+    if (cachedMode != WarpMode::Proxy)
+        return;
+
+    // fall back to the port we last configured
+    const quint16 port = proxyPortFromSettings(modeLine);
+    cachedProxyPort = port ? port
+                           : static_cast<quint16>(SettingsStore::instance().number(SettingsStore::Key::ProxyPort));
 }
 
-bool MainFunctions::isWarpConnected() {
-    // DNS-only modes don't create a CloudflareWARP interface
-    // Check resolv.conf for local DNS proxy instead
-    if (cachedMode == "doh" || cachedMode == "dot") {
-        QFile file("/etc/resolv.conf");
-        if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
-            return false;
-        QString content = QString::fromUtf8(file.readAll());
-        file.close();
-        // WARP uses 127.0.0.2 or 127.0.2.2 as local DNS proxy
-        return content.contains("127.0.0.2") || content.contains("127.0.2.2");
-    }
+void MainFunctions::seedMode(WarpMode mode, quint16 proxyPort) {
+    cachedMode = mode;
+    if (proxyPort)
+        cachedProxyPort = proxyPort;
+}
 
-    /*
+QFuture<MainFunctions::StateProbe> MainFunctions::probeStateAsync() {
+    const quint16 fallbackPort =
+            static_cast<quint16>(SettingsStore::instance().number(SettingsStore::Key::ProxyPort));
+    return QtConcurrent::run([fallbackPort]() {
+        StateProbe probe;
+        probe.proxyPort = fallbackPort;
+        probe.serviceActive =
+                runCommandResultInternal("systemctl", {"is-active", "--quiet", "warp-svc"}, 3000).exitCode == 0;
+        // warp-cli only hangs until its timeout without the daemon
+        if (!probe.serviceActive)
+            return probe;
+
+        const QString modeLine = settingsModeLine(3000);
+        probe.mode = modeFromSettings(modeLine);
+        if (const quint16 port = proxyPortFromSettings(modeLine))
+            probe.proxyPort = port;
+        // own netlink socket, the member one belongs to the GUI thread
+        SockDiag diag;
+        probe.connected = connectedInMode(probe.mode, probe.proxyPort, diag);
+        return probe;
+    });
+}
 
-    // Broken & unreliable method, and nobody uses this shit anyways, might fix at some point
+void MainFunctions::applyStateProbe(const StateProbe &probe) {
+    // keep the seeded mode when the daemon was down and couldn't tell us
+    if (probe.mode != WarpMode::Unknown)
+        cachedMode = probe.mode;
+    cachedProxyPort = probe.proxyPort;
+}
 
-    // Proxy mode creates a local SOCKS5 proxy on port 40000
-    // Check /proc/net/tcp for listening port (40000 = 0x9C40)
-    // cloudflare docs dont state much so i do belive the 40000 port is the only option?
-    if (cachedMode == "proxy")
-    {
-        QFile file("/proc/net/tcp");
-        if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
-            return false;
-        QString content = QString::fromUtf8(file.readAll());
-        file.close();
-        // Look for 127.0.0.1:40000 listening (0100007F:9C40 in hex, state 0A = LISTEN)
-        return content.contains("0100007F:9C40") || content.contains("00000000:9C40");
-    }*/
-
-    // Tunnel modes (warp, warp+doh, warp+dot, tunnel_only)
-    // check for the CloudflareWARP interface
-    QProcess process;
-    process.start("ip", {"addr", "show", "CloudflareWARP"});
-    if (!process.waitForFinished(2000)) {
-        process.kill();
-        process.waitForFinished(500);
-        return false;
-    }
-    return (process.exitCode() == 0);
+WarpMode MainFunctions::currentMode() const {
+    return cachedMode;
+}
+
+quint16 MainFunctions::proxyPort() const {
+    return cachedProxyPort;
+}
 
-    // other modes like device posture only dont do shit anyways and are for org usage
-    // i dont really think there is anything to check there?? idk
+bool MainFunctions::isWarpConnected() {
+    return connectedInMode(cachedMode, cachedProxyPort, sockDiag);
 }
\ No newline at end of file
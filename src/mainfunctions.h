@@ -4,6 +4,12 @@
 #include <QString>
 #include <QFuture>
 #include <QObject>
+#include <QElapsedTimer>
+#include "sockdiag.h"
+#include "warpmode.h"
+
+class QTimer;
+class LineScanner;
 
 class MainFunctions : public QObject {
     Q_OBJECT
@@ -11,19 +17,64 @@ class MainFunctions : public QObject {
 public:
     explicit MainFunctions(QObject *parent = nullptr);
 
+    // exit code reported for a program that could not be started at all, as a shell would
+    static constexpr int kExitFailedToStart = 127;
+
     struct CommandResult {
         int exitCode = -1;
         QString out;
         QString err;
         bool timedOut = false;
+        // output went over the cap, the rest was dropped
+        bool truncated = false;
+    };
+
+    // why a connect attempt failed, decides whether it is worth retrying
+    enum class FailureKind {
+        None,
+        Timeout,
+        ServiceDown,
+        NotRegistered,
+        DaemonError,
+        // warp-cli missing or not executable, retrying won't change that
+        NotInstalled
+    };
+
+    // everything needed to render the tray, gathered off the GUI thread
+    struct StateProbe {
+        bool serviceActive = false;
+        WarpMode mode = WarpMode::Unknown;
+        quint16 proxyPort = 40000;
+        bool connected = false;
+    };
+
+    struct RetryStats {
+        int recoveries = 0;
+        int exhausted = 0;
+        qint64 lastRecoveryMs = -1;
+        qint64 totalRecoveryMs = 0;
     };
 
+    static FailureKind classifyConnectResult(const CommandResult &res);
+
+    static bool isRetryable(FailureKind kind);
+
+    static QString failureKindName(FailureKind kind);
+
+    // commands whose output went over the cap since startup
+    static int truncatedCommandCount();
+
     QString runCommand(const QString &program, const QStringList &arguments);
 
     CommandResult runCommandResult(const QString &program,
                                    const QStringList &arguments,
                                    int timeoutMs = 3000);
 
+    // streams stdout through the scanner and stops the command once every field matched,
+    // false on timeout or if a field never showed up
+    bool scanCommand(const QString &program, const QStringList &arguments, int timeoutMs,
+                     LineScanner &scanner);
+
     QFuture<CommandResult> runCommandAsync(const QString &program,
                                            const QStringList &arguments,
                                            int timeoutMs = 3000);
@@ -36,7 +87,10 @@ public:
 
     QFuture<CommandResult> cliDisconnectAsync();
 
-    void cliRegister();
+    void reconnect();
+
+    // opens a terminal running the interactive registration, false if none was found
+    bool cliRegister();
 
     QString cliStatus();
 
@@ -44,22 +98,63 @@ public:
 
     bool isServiceActive();
 
-    QString GetCurrentMode();
+    WarpMode GetCurrentMode();
 
     void refreshCachedMode();
 
+    WarpMode currentMode() const;
+
+    // use a persisted mode until the first probe, so the constructor doesn't block on warp-cli
+    void seedMode(WarpMode mode, quint16 proxyPort);
+
+    QFuture<StateProbe> probeStateAsync();
+
+    void applyStateProbe(const StateProbe &probe);
+
+    quint16 proxyPort() const;
+
     bool isWarpConnected();
 
+    void handleConnectResult(const CommandResult &res);
+
+    void cancelConnectRetry();
+
+    bool isRetryPending() const;
+
+    RetryStats retryStats() const;
+
+    // holds a pending retry while the session sleeps or is locked, resumes it after
+    void setRetryPaused(bool paused);
+
     signals:
 
     void errorOccurred(const QString &title, const QString &message);
 
     void infoOccurred(const QString &title, const QString &message);
 
+    void connectRetryScheduled(int attempt, int maxAttempts, int delayMs, const QString &reason);
+
+    void connectRetryStopped(bool recovered);
+
+    void connectFailed(MainFunctions::FailureKind kind);
+
 private:
     bool isConnecting = false;
     bool isDisconnecting = false;
-    QString cachedMode;
+    WarpMode cachedMode = WarpMode::Unknown;
+    quint16 cachedProxyPort = 40000;
+    SockDiag sockDiag;
+
+    // connect retry state
+    QTimer *retryTimer;
+    int retryAttempt = 0;
+    bool retryPaused = false;
+    QElapsedTimer recoveryClock;
+    RetryStats stats;
+
+    void retryConnect();
+
+    void stopRetry(bool recovered);
 };
 
 #endif // MAINFUNCTIONS_H
\ No newline at end of file
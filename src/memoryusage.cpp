@@ -0,0 +1,54 @@
+#include "memoryusage.h"
+#include <QDateTime>
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace {
+    MemoryUsage::Release last;
+}
+
+qint64 MemoryUsage::residentBytes() {
+    // kept open, the diagnostics readout polls it; pread because the file offset moves on read
+    static const int fd = ::open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    char buf[128];
+    const ssize_t n = ::pread(fd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0)
+        return -1;
+    buf[n] = '\0';
+
+    // "size resident shared text lib data dt", all in pages
+    const char *p = buf;
+    while (*p && *p != ' ')
+        ++p;
+    if (!*p)
+        return -1;
+    qint64 pages = 0;
+    for (++p; *p >= '0' && *p <= '9'; ++p)
+        pages = pages * 10 + (*p - '0');
+    return pages * ::sysconf(_SC_PAGESIZE);
+}
+
+bool MemoryUsage::trimHeap() {
+#if defined(__GLIBC__)
+    return ::malloc_trim(0) != 0;
+#else
+    return false;
+#endif
+}
+
+MemoryUsage::Release MemoryUsage::recordRelease(qint64 rssBeforeBytes) {
+    trimHeap();
+    last.rssBeforeBytes = rssBeforeBytes;
+    last.rssAfterBytes = residentBytes();
+    last.timestampMs = QDateTime::currentMSecsSinceEpoch();
+    return last;
+}
+
+MemoryUsage::Release MemoryUsage::lastRelease() {
+    return last;
+}
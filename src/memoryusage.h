@@ -0,0 +1,27 @@
+#ifndef MEMORYUSAGE_H
+#define MEMORYUSAGE_H
+
+#include <QtGlobal>
+
+// Resident set size from /proc/self/statm and returning freed heap to the kernel, for the
+// low-memory tray mode and the diagnostics readout.
+namespace MemoryUsage {
+    struct Release {
+        qint64 rssBeforeBytes = -1;
+        qint64 rssAfterBytes = -1;
+        qint64 timestampMs = 0; // wall clock, 0 if nothing was released yet
+    };
+
+    // -1 if /proc is unavailable
+    qint64 residentBytes();
+
+    // malloc_trim() on glibc, returns whether the allocator gave anything back
+    bool trimHeap();
+
+    // trims and records the RSS on both sides, the caller frees its objects first
+    Release recordRelease(qint64 rssBeforeBytes);
+
+    Release lastRelease();
+}
+
+#endif // MEMORYUSAGE_H
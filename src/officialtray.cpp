@@ -0,0 +1,271 @@
+#include "officialtray.h"
+#include "mainfunctions.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QSocketNotifier>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+    const char kComm[] = "warp-taskbar";
+
+    // proc_event::what values, newer headers moved the enum out of the struct
+    constexpr quint32 kEventExec = 0x00000002;
+    constexpr quint32 kEventExit = 0x80000000;
+
+    // /proc/<pid>/comm without the trailing newline, empty if the process is gone
+    QByteArray commOf(qint64 pid) {
+        char path[32];
+        std::snprintf(path, sizeof(path), "/proc/%lld/comm", static_cast<long long>(pid));
+        const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return QByteArray();
+        char buf[32];
+        const ssize_t n = ::read(fd, buf, sizeof(buf));
+        ::close(fd);
+        if (n <= 0)
+            return QByteArray();
+        return QByteArray(buf, static_cast<int>(n)).trimmed();
+    }
+
+    bool isOfficialTray(qint64 pid) {
+        return commOf(pid) == kComm;
+    }
+
+    // -1 on kernels before 5.3 or headers without the syscall
+    int pidfdOpen(qint64 pid) {
+#ifdef SYS_pidfd_open
+        return static_cast<int>(::syscall(SYS_pidfd_open, static_cast<pid_t>(pid), 0));
+#else
+        Q_UNUSED(pid)
+        errno = ENOSYS;
+        return -1;
+#endif
+    }
+
+    bool terminate(qint64 pid) {
+        // pin the process first, then make sure the pid was not reused before signalling it
+        const int pidfd = pidfdOpen(pid);
+        if (!isOfficialTray(pid)) {
+            if (pidfd >= 0)
+                ::close(pidfd);
+            return false;
+        }
+#ifdef SYS_pidfd_send_signal
+        if (pidfd >= 0) {
+            const bool ok = ::syscall(SYS_pidfd_send_signal, pidfd, SIGTERM, nullptr, 0) == 0;
+            ::close(pidfd);
+            return ok;
+        }
+#endif
+        if (pidfd >= 0)
+            ::close(pidfd);
+        return ::kill(static_cast<pid_t>(pid), SIGTERM) == 0;
+    }
+} // namespace
+
+QVector<qint64> OfficialTray::findRunning() {
+    QVector<qint64> found;
+    const QStringList entries = QDir("/proc").entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString &entry : entries) {
+        bool numeric = false;
+        const qint64 pid = entry.toLongLong(&numeric);
+        if (numeric && isOfficialTray(pid))
+            found.append(pid);
+    }
+    return found;
+}
+
+OfficialTray::SuppressResult OfficialTray::suppress(MainFunctions *mf, const QVector<qint64> &pids) {
+    SuppressResult result;
+    const MainFunctions::CommandResult disabled =
+            mf->runCommandResult("systemctl", {"--user", "disable", "warp-taskbar"}, 10000);
+    // 1 is what systemctl says when there is no such unit, nothing to disable then
+    result.unitHandled = !disabled.timedOut && (disabled.exitCode == 0 || disabled.exitCode == 1);
+    mf->runCommandResult("systemctl", {"--user", "stop", "warp-taskbar"}, 5000);
+
+    // user autostart override always write Hidden=true
+    const QString autostartDir = QStandardPaths::writableLocation(QStandardPaths::ConfigLocation) + "/autostart";
+    QDir().mkpath(autostartDir);
+    QFile file(autostartDir + "/com.cloudflare.WarpTaskbar.desktop");
+    if (file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        QTextStream out(&file);
+        out << "[Desktop Entry]\n"
+               "Type=Application\n"
+               "Name=Cloudflare WARP Zero Trust client / Tray Override\n"
+               "Hidden=true\n";
+        file.close();
+        result.overrideWritten = true;
+    }
+
+    // started from autostart rather than the unit, stopping the unit didnt reach it
+    for (qint64 pid : pids) {
+        if (terminate(pid))
+            ++result.terminated;
+    }
+    return result;
+}
+
+OfficialTrayMonitor::OfficialTrayMonitor(QObject *parent)
+    : QObject(parent), connectorFd(-1), connectorNotifier(nullptr) {
+}
+
+OfficialTrayMonitor::~OfficialTrayMonitor() {
+    for (auto it = watched.cbegin(); it != watched.cend(); ++it) {
+        if (!it.value())
+            continue;
+        const int pidfd = static_cast<int>(it.value()->socket());
+        delete it.value();
+        ::close(pidfd);
+    }
+    delete connectorNotifier;
+    if (connectorFd >= 0)
+        ::close(connectorFd);
+}
+
+void OfficialTrayMonitor::start() {
+    if (connectorFd >= 0)
+        return;
+    if (!openConnector())
+        qDebug() << "official tray monitor: proc connector unavailable (" << std::strerror(errno)
+                 << "), checking only at startup";
+    // subscribe first, so nothing exec'd during the scan is missed
+    for (qint64 pid : OfficialTray::findRunning())
+        watch(pid);
+}
+
+bool OfficialTrayMonitor::isRunning() const {
+    return !watched.isEmpty();
+}
+
+QVector<qint64> OfficialTrayMonitor::pids() const {
+    QVector<qint64> out;
+    for (auto it = watched.cbegin(); it != watched.cend(); ++it)
+        out.append(it.key());
+    return out;
+}
+
+bool OfficialTrayMonitor::isListening() const {
+    return connectorFd >= 0;
+}
+
+bool OfficialTrayMonitor::openConnector() {
+    const int fd = ::socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+    if (fd < 0)
+        return false;
+
+    sockaddr_nl addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = CN_IDX_PROC;
+    if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+        const int saved = errno;
+        ::close(fd);
+        errno = saved;
+        return false;
+    }
+
+    alignas(nlmsghdr) char buf[NLMSG_SPACE(sizeof(cn_msg) + sizeof(proc_cn_mcast_op))];
+    std::memset(buf, 0, sizeof(buf));
+    auto nlh = reinterpret_cast<nlmsghdr *>(buf);
+    nlh->nlmsg_len = NLMSG_LENGTH(sizeof(cn_msg) + sizeof(proc_cn_mcast_op));
+    nlh->nlmsg_type = NLMSG_DONE;
+    auto msg = static_cast<cn_msg *>(NLMSG_DATA(nlh));
+    msg->id.idx = CN_IDX_PROC;
+    msg->id.val = CN_VAL_PROC;
+    msg->len = sizeof(proc_cn_mcast_op);
+    const proc_cn_mcast_op op = PROC_CN_MCAST_LISTEN;
+    std::memcpy(msg->data, &op, sizeof(op));
+    if (::send(fd, buf, nlh->nlmsg_len, 0) < 0) {
+        const int saved = errno;
+        ::close(fd);
+        errno = saved;
+        return false;
+    }
+
+    connectorFd = fd;
+    connectorNotifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(connectorNotifier, &QSocketNotifier::activated, this, &OfficialTrayMonitor::onConnectorReadable);
+    return true;
+}
+
+void OfficialTrayMonitor::onConnectorReadable() {
+    alignas(nlmsghdr) char buf[8192];
+    for (;;) {
+        const ssize_t n = ::recv(connectorFd, buf, sizeof(buf), 0);
+        if (n < 0 && (errno == EINTR || errno == ENOBUFS))
+            continue; // ENOBUFS: we fell behind and lost events, a missed exec only costs a late notice
+        if (n <= 0) {
+            if (n < 0 && errno != EAGAIN) {
+                qWarning() << "official tray monitor: proc connector failed:" << std::strerror(errno);
+                connectorNotifier->setEnabled(false);
+            }
+            return;
+        }
+
+        int len = static_cast<int>(n);
+        for (auto nlh = reinterpret_cast<nlmsghdr *>(buf); NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len)) {
+            if (nlh->nlmsg_type == NLMSG_ERROR || nlh->nlmsg_type == NLMSG_NOOP)
+                continue;
+            auto msg = static_cast<const cn_msg *>(NLMSG_DATA(nlh));
+            if (msg->id.idx != CN_IDX_PROC || msg->id.val != CN_VAL_PROC)
+                continue;
+            auto ev = reinterpret_cast<const proc_event *>(msg->data);
+            const quint32 what = static_cast<quint32>(ev->what);
+            if (what == kEventExec) {
+                const qint64 pid = ev->event_data.exec.process_tgid;
+                // threads exec'ing report the thread group leader's pid too, only look once
+                if (ev->event_data.exec.process_pid == ev->event_data.exec.process_tgid
+                    && !watched.contains(pid) && isOfficialTray(pid))
+                    watch(pid);
+            } else if (what == kEventExit) {
+                // only needed when there is no pidfd to tell us
+                const qint64 pid = ev->event_data.exit.process_tgid;
+                if (ev->event_data.exit.process_pid == pid && watched.contains(pid) && !watched.value(pid))
+                    onExited(pid);
+            }
+        }
+    }
+}
+
+void OfficialTrayMonitor::watch(qint64 pid) {
+    if (watched.contains(pid))
+        return;
+    QSocketNotifier *notifier = nullptr;
+    const int pidfd = pidfdOpen(pid);
+    if (pidfd >= 0) {
+        // a pidfd turns readable once the process has exited
+        notifier = new QSocketNotifier(pidfd, QSocketNotifier::Read, this);
+        connect(notifier, &QSocketNotifier::activated, this, [this, pid]() { onExited(pid); });
+    }
+    const bool first = watched.isEmpty();
+    watched.insert(pid, notifier);
+    qDebug() << "official tray monitor: warp-taskbar running as pid" << pid;
+    if (first)
+        emit conflictDetected(pid);
+}
+
+void OfficialTrayMonitor::onExited(qint64 pid) {
+    QSocketNotifier *notifier = watched.take(pid);
+    if (notifier) {
+        const int pidfd = static_cast<int>(notifier->socket());
+        // called from the notifier's own signal
+        notifier->setEnabled(false);
+        notifier->deleteLater();
+        ::close(pidfd);
+    }
+    if (watched.isEmpty())
+        emit conflictCleared();
+}
@@ -0,0 +1,69 @@
+#ifndef OFFICIALTRAY_H
+#define OFFICIALTRAY_H
+
+#include <QHash>
+#include <QObject>
+#include <QVector>
+
+class MainFunctions;
+class QSocketNotifier;
+
+// Cloudflare's own warp-taskbar, which WARP package updates like to turn back on.
+namespace OfficialTray {
+    struct SuppressResult {
+        bool unitHandled = false;     // systemctl --user disable went through (or the unit doesn't exist)
+        bool overrideWritten = false; // autostart entry with Hidden=true
+        int terminated = 0;
+    };
+
+    // pids whose comm is warp-taskbar, a one-shot walk over /proc
+    QVector<qint64> findRunning();
+
+    // Disables and stops the user unit, overrides the XDG autostart entry and terminates the
+    // given processes. Blocks on systemctl, run it off the GUI thread.
+    SuppressResult suppress(MainFunctions *mf, const QVector<qint64> &pids);
+}
+
+// Notices a running warp-taskbar without polling: one /proc scan on start, exec events from the
+// proc connector after that, and a pidfd per instance to see it go away. The proc connector
+// needs CAP_NET_ADMIN, without it only the scan on start is left.
+class OfficialTrayMonitor : public QObject {
+    Q_OBJECT
+
+public:
+    explicit OfficialTrayMonitor(QObject *parent = nullptr);
+
+    ~OfficialTrayMonitor() override;
+
+    void start();
+
+    bool isRunning() const;
+
+    QVector<qint64> pids() const;
+
+    // whether exec events are coming in, false means only the start scan ran
+    bool isListening() const;
+
+signals:
+    // the first instance showed up
+    void conflictDetected(qint64 pid);
+
+    // the last instance went away
+    void conflictCleared();
+
+private:
+    bool openConnector();
+
+    void onConnectorReadable();
+
+    void watch(qint64 pid);
+
+    void onExited(qint64 pid);
+
+    int connectorFd;
+    QSocketNotifier *connectorNotifier;
+    // pid -> notifier on its pidfd (nullptr without pidfd support)
+    QHash<qint64, QSocketNotifier *> watched;
+};
+
+#endif // OFFICIALTRAY_H
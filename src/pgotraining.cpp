@@ -0,0 +1,36 @@
+#include "pgotraining.h"
+#include "systray.h"
+#include <QApplication>
+#include <QPointer>
+#include <QTimer>
+
+namespace {
+    void closeModalLater(int ms) {
+        QTimer::singleShot(ms, []() {
+            if (QWidget *modal = QApplication::activeModalWidget())
+                modal->close();
+        });
+    }
+} // namespace
+
+void PgoTraining::run(SysTray &tray) {
+    // each step waits long enough for the toggle poll (2 s first check) to settle
+    QTimer::singleShot(500, &tray, [&tray]() {
+        tray.ensureWidget()->showPositioned();
+    });
+    QTimer::singleShot(1500, &tray, [&tray]() {
+        QMetaObject::invokeMethod(tray.ensureWidget(), "on_btn_start_clicked");
+    });
+    QTimer::singleShot(5500, &tray, [&tray]() {
+        QMetaObject::invokeMethod(tray.ensureWidget(), "on_btn_start_clicked");
+    });
+    QTimer::singleShot(9500, &tray, [&tray]() {
+        // exec() blocks until the timer below closes the dialog
+        closeModalLater(1500);
+        tray.ensureWidget()->openSettings();
+    });
+    QTimer::singleShot(12000, &tray, [&tray]() {
+        tray.ensureWidget()->hide();
+        QApplication::quit();
+    });
+}
@@ -0,0 +1,13 @@
+#ifndef PGOTRAINING_H
+#define PGOTRAINING_H
+
+class SysTray;
+
+// Deterministic workload for profile-guided builds (WARPQT_PGO=GENERATE): show the popup,
+// toggle twice, open and close the settings, then quit. Meant to run against the stub
+// warp-cli/ip/systemctl in pgo/stubs so the profile doesn't depend on the machine.
+namespace PgoTraining {
+    void run(SysTray &tray);
+}
+
+#endif // PGOTRAINING_H
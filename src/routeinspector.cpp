@@ -0,0 +1,125 @@
+#include "routeinspector.h"
+#include <QFontDatabase>
+#include <QFutureWatcher>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QPlainTextEdit>
+#include <QPushButton>
+#include <QTableWidget>
+#include <QVBoxLayout>
+#include <cstring>
+
+namespace {
+    enum Column {
+        ColDestination,
+        ColAddress,
+        ColInterface,
+        ColTunnel,
+        ColSource,
+        ColGateway,
+        ColumnCount
+    };
+}
+
+RouteInspector::RouteInspector(QWidget *parent)
+    : QDialog(parent), watcher(new QFutureWatcher<QVector<RouteLookup::Check>>(this)) {
+    setWindowTitle("Route Inspector");
+    resize(760, 520);
+    setupUI();
+
+    connect(btnCheck, &QPushButton::clicked, this, &RouteInspector::check);
+    connect(watcher, &QFutureWatcher<QVector<RouteLookup::Check>>::finished, this, &RouteInspector::showResults);
+}
+
+void RouteInspector::setupUI() {
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+
+    editDestinations = new QPlainTextEdit(this);
+    editDestinations->setPlaceholderText("Host names, IP addresses or CIDRs, one per line");
+    editDestinations->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    editDestinations->setMaximumHeight(140);
+    mainLayout->addWidget(editDestinations);
+
+    btnCheck = new QPushButton("Check Routes", this);
+    btnCheck->setToolTip("Ask the kernel which interface each destination leaves through, the same lookup\n"
+        "as \"ip route get\". Names are resolved first, with every address checked.");
+    labelStatus = new QLabel(this);
+    labelStatus->setWordWrap(true);
+
+    QHBoxLayout *checkRow = new QHBoxLayout();
+    checkRow->addWidget(btnCheck);
+    checkRow->addWidget(labelStatus, 1);
+    mainLayout->addLayout(checkRow);
+
+    table = new QTableWidget(0, ColumnCount, this);
+    table->setHorizontalHeaderLabels({"Destination", "Address", "Interface", "WARP", "Source", "Gateway / Error"});
+    table->horizontalHeader()->setStretchLastSection(true);
+    table->verticalHeader()->hide();
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    mainLayout->addWidget(table, 1);
+}
+
+void RouteInspector::check() {
+    if (watcher->isRunning())
+        return;
+    const QStringList destinations = editDestinations->toPlainText().split(QLatin1Char('\n'));
+    btnCheck->setEnabled(false);
+    labelStatus->setText("Resolving and looking up routes...");
+    watcher->setFuture(RouteLookup::checkAsync(destinations));
+}
+
+void RouteInspector::showResults() {
+    btnCheck->setEnabled(true);
+    const QVector<RouteLookup::Check> checks = watcher->result();
+
+    table->setSortingEnabled(false);
+    table->setRowCount(0);
+    int addresses = 0;
+    int tunneled = 0;
+    int failed = 0;
+    auto addRow = [this](const QStringList &cells, bool highlight) {
+        const int row = table->rowCount();
+        table->insertRow(row);
+        for (int col = 0; col < cells.size(); ++col) {
+            auto *item = new QTableWidgetItem(cells.at(col));
+            if (highlight && col == ColTunnel)
+                item->setForeground(palette().color(QPalette::Link));
+            table->setItem(row, col, item);
+        }
+    };
+    for (const RouteLookup::Check &check : checks) {
+        if (check.routes.isEmpty()) {
+            ++failed;
+            addRow({check.destination, QString(), QString(), QString(), QString(),
+                    check.error.isEmpty() ? QStringLiteral("no addresses") : check.error}, false);
+            continue;
+        }
+        for (const RouteLookup::Result &r : check.routes) {
+            ++addresses;
+            if (r.error != 0) {
+                ++failed;
+                addRow({check.destination, r.address, QString(), QString(), QString(),
+                        QString::fromLocal8Bit(std::strerror(r.error))}, false);
+                continue;
+            }
+            const bool viaTunnel = RouteLookup::isTunnel(r);
+            if (viaTunnel)
+                ++tunneled;
+            addRow({check.destination, r.address, r.interface, viaTunnel ? "yes" : "no", r.source,
+                    r.gateway.isEmpty() ? QStringLiteral("on-link") : r.gateway}, viaTunnel);
+        }
+    }
+    table->setSortingEnabled(true);
+    table->resizeColumnsToContents();
+
+    if (checks.isEmpty()) {
+        labelStatus->setText("Nothing to check.");
+        return;
+    }
+    QString status = QString("%1 of %2 addresses go through the tunnel.").arg(tunneled).arg(addresses);
+    if (failed > 0)
+        status += QString(" %1 could not be checked.").arg(failed);
+    labelStatus->setText(status);
+}
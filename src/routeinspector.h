@@ -0,0 +1,37 @@
+#ifndef ROUTEINSPECTOR_H
+#define ROUTEINSPECTOR_H
+
+#include "routelookup.h"
+#include <QDialog>
+
+class QLabel;
+class QPlainTextEdit;
+class QPushButton;
+class QTableWidget;
+template<typename T>
+class QFutureWatcher;
+
+// "Does this go through the tunnel?" for a list of destinations, answered by the kernel's
+// routing decision rather than by reading the split tunnel configuration.
+class RouteInspector : public QDialog {
+    Q_OBJECT
+
+public:
+    explicit RouteInspector(QWidget *parent = nullptr);
+
+private slots:
+    void check();
+
+    void showResults();
+
+private:
+    void setupUI();
+
+    QPlainTextEdit *editDestinations;
+    QPushButton *btnCheck;
+    QTableWidget *table;
+    QLabel *labelStatus;
+    QFutureWatcher<QVector<RouteLookup::Check>> *watcher;
+};
+
+#endif // ROUTEINSPECTOR_H
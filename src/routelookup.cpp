@@ -0,0 +1,269 @@
+#include "routelookup.h"
+#include <QHash>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+// requests per send; the kernel queues every answer before we read any, each charged about a
+// page, and overrunning the default receive buffer (~200 KiB) loses them with ENOBUFS
+static constexpr int kBatchSize = 64;
+// a name with more addresses than this is a CDN, a few of them tell the story
+static constexpr int kMaxAddressesPerName = 8;
+
+namespace {
+    const char kTunnelInterface[] = "CloudflareWARP";
+
+    struct RouteRequest {
+        nlmsghdr nlh;
+        rtmsg rtm;
+        // RTA_DST with room for an IPv6 address
+        alignas(NLMSG_ALIGNTO) char attr[RTA_SPACE(16)];
+    };
+
+    QString addressText(int family, const void *data) {
+        char text[INET6_ADDRSTRLEN] = {};
+        if (!::inet_ntop(family, data, text, sizeof(text)))
+            return QString();
+        return QString::fromLatin1(text);
+    }
+
+    // "10.0.0.0/8" -> "10.0.0.0", other entries as they are
+    QString stripPrefix(const QString &entry) {
+        const int slash = entry.indexOf(QLatin1Char('/'));
+        return slash < 0 ? entry : entry.left(slash);
+    }
+
+    QStringList resolve(const QString &name, QString &error) {
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_DGRAM; // one entry per address instead of one per socket type
+        addrinfo *res = nullptr;
+        const int rc = ::getaddrinfo(name.toUtf8().constData(), nullptr, &hints, &res);
+        if (rc != 0) {
+            error = QString::fromLocal8Bit(::gai_strerror(rc));
+            return QStringList();
+        }
+        QStringList addresses;
+        for (addrinfo *ai = res; ai && addresses.size() < kMaxAddressesPerName; ai = ai->ai_next) {
+            QString text;
+            if (ai->ai_family == AF_INET)
+                text = addressText(AF_INET, &reinterpret_cast<sockaddr_in *>(ai->ai_addr)->sin_addr);
+            else if (ai->ai_family == AF_INET6)
+                text = addressText(AF_INET6, &reinterpret_cast<sockaddr_in6 *>(ai->ai_addr)->sin6_addr);
+            if (!text.isEmpty() && !addresses.contains(text))
+                addresses << text;
+        }
+        ::freeaddrinfo(res);
+        return addresses;
+    }
+
+    bool isNumeric(const QString &entry) {
+        unsigned char buf[16];
+        const QByteArray latin = entry.toLatin1();
+        return ::inet_pton(AF_INET, latin.constData(), buf) == 1 || ::inet_pton(AF_INET6, latin.constData(), buf) == 1;
+    }
+} // namespace
+
+RouteLookup::RouteLookup() : fd(-1), seq(0) {
+}
+
+RouteLookup::~RouteLookup() {
+    closeSocket();
+}
+
+bool RouteLookup::ensureSocket() {
+    if (fd >= 0)
+        return true;
+    fd = ::socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd < 0)
+        return false;
+    // the kernel answers at once, this only guards against surprises
+    timeval tv{1, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    return true;
+}
+
+void RouteLookup::closeSocket() {
+    if (fd >= 0)
+        ::close(fd);
+    fd = -1;
+}
+
+bool RouteLookup::isTunnel(const Result &result) {
+    return result.error == 0 && result.interface == QLatin1String(kTunnelInterface);
+}
+
+QVector<RouteLookup::Result> RouteLookup::lookup(const QStringList &addresses) {
+    QVector<Result> results(addresses.size());
+    for (int i = 0; i < addresses.size(); ++i) {
+        results[i].address = addresses.at(i);
+        results[i].error = EINVAL;
+    }
+    if (!ensureSocket()) {
+        for (Result &r : results)
+            r.error = errno ? errno : EAFNOSUPPORT;
+        return results;
+    }
+
+    for (int batchStart = 0; batchStart < addresses.size(); batchStart += kBatchSize) {
+        const int batchEnd = qMin(batchStart + kBatchSize, static_cast<int>(addresses.size()));
+        const quint32 firstSeq = seq + 1;
+
+        // every request in one datagram, the kernel walks them in order and answers each
+        QByteArray batch;
+        batch.reserve((batchEnd - batchStart) * static_cast<int>(NLMSG_ALIGN(sizeof(RouteRequest))));
+        int pending = 0;
+        QVector<bool> answered(batchEnd - batchStart, false);
+        for (int i = batchStart; i < batchEnd; ++i) {
+            ++seq;
+            RouteRequest req;
+            std::memset(&req, 0, sizeof(req));
+            const QByteArray latin = addresses.at(i).toLatin1();
+            int family = AF_INET;
+            int addrLen = 4;
+            if (::inet_pton(AF_INET, latin.constData(), RTA_DATA(reinterpret_cast<rtattr *>(req.attr))) != 1) {
+                family = AF_INET6;
+                addrLen = 16;
+                if (::inet_pton(AF_INET6, latin.constData(), RTA_DATA(reinterpret_cast<rtattr *>(req.attr))) != 1)
+                    continue; // stays EINVAL
+            }
+            auto *dst = reinterpret_cast<rtattr *>(req.attr);
+            dst->rta_type = RTA_DST;
+            dst->rta_len = static_cast<unsigned short>(RTA_LENGTH(addrLen));
+            req.nlh.nlmsg_len = static_cast<__u32>(NLMSG_LENGTH(sizeof(rtmsg)) + RTA_SPACE(addrLen));
+            req.nlh.nlmsg_type = RTM_GETROUTE;
+            req.nlh.nlmsg_flags = NLM_F_REQUEST;
+            req.nlh.nlmsg_seq = seq;
+            req.rtm.rtm_family = static_cast<unsigned char>(family);
+            req.rtm.rtm_dst_len = static_cast<unsigned char>(addrLen * 8);
+            // report the table the lookup ended in, not the one the route was cached from
+            req.rtm.rtm_flags = RTM_F_LOOKUP_TABLE;
+            batch.append(reinterpret_cast<const char *>(&req), static_cast<int>(NLMSG_ALIGN(req.nlh.nlmsg_len)));
+            ++pending;
+        }
+        if (pending == 0)
+            continue;
+
+        sockaddr_nl kernel{};
+        kernel.nl_family = AF_NETLINK;
+        if (::sendto(fd, batch.constData(), static_cast<size_t>(batch.size()), 0,
+                     reinterpret_cast<sockaddr *>(&kernel), sizeof(kernel)) < 0) {
+            const int err = errno;
+            closeSocket();
+            for (int i = batchStart; i < batchEnd; ++i)
+                results[i].error = err;
+            return results;
+        }
+
+        alignas(nlmsghdr) char buf[32768];
+        while (pending > 0) {
+            const ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                // drop the socket so late answers cant be taken for the next batch's
+                const int err = errno;
+                closeSocket();
+                for (int i = batchStart; i < batchEnd; ++i) {
+                    if (!answered.at(i - batchStart))
+                        results[i].error = err;
+                }
+                return results;
+            }
+            int len = static_cast<int>(n);
+            for (auto *h = reinterpret_cast<nlmsghdr *>(buf); NLMSG_OK(h, len); h = NLMSG_NEXT(h, len)) {
+                if (h->nlmsg_seq < firstSeq || h->nlmsg_seq > seq)
+                    continue;
+                const int offset = static_cast<int>(h->nlmsg_seq - firstSeq);
+                if (answered.at(offset) || (h->nlmsg_type != NLMSG_ERROR && h->nlmsg_type != RTM_NEWROUTE))
+                    continue;
+                answered[offset] = true;
+                --pending;
+                Result &r = results[batchStart + offset];
+                if (h->nlmsg_type == NLMSG_ERROR) {
+                    r.error = -static_cast<const nlmsgerr *>(NLMSG_DATA(h))->error;
+                    continue;
+                }
+                r.error = 0;
+                const auto *rtm = static_cast<const rtmsg *>(NLMSG_DATA(h));
+                r.table = rtm->rtm_table;
+                int attrLen = static_cast<int>(RTM_PAYLOAD(h));
+                for (auto *a = RTM_RTA(rtm); RTA_OK(a, attrLen); a = RTA_NEXT(a, attrLen)) {
+                    switch (a->rta_type) {
+                        case RTA_OIF: {
+                            char name[IF_NAMESIZE] = {};
+                            if (::if_indextoname(*static_cast<const unsigned *>(RTA_DATA(a)), name))
+                                r.interface = QString::fromLatin1(name);
+                            break;
+                        }
+                        case RTA_PREFSRC:
+                            r.source = addressText(rtm->rtm_family, RTA_DATA(a));
+                            break;
+                        case RTA_GATEWAY:
+                            r.gateway = addressText(rtm->rtm_family, RTA_DATA(a));
+                            break;
+                        case RTA_TABLE:
+                            r.table = *static_cast<const quint32 *>(RTA_DATA(a));
+                            break;
+                        default:
+                            break;
+                    }
+                }
+            }
+        }
+    }
+    return results;
+}
+
+QFuture<QVector<RouteLookup::Check>> RouteLookup::checkAsync(const QStringList &destinations) {
+    static QThreadPool pool;
+    pool.setMaxThreadCount(1);
+    pool.setExpiryTimeout(3000);
+    return QtConcurrent::run(&pool, [destinations]() {
+        QVector<Check> checks;
+        QStringList addresses;
+        // index into addresses of each check's first route, and how many
+        QVector<QPair<int, int>> spans;
+        // addresses and the resolver error, a name repeated in the list is looked up once
+        QHash<QString, QPair<QStringList, QString>> resolved;
+        for (const QString &raw : destinations) {
+            const QString entry = raw.trimmed();
+            if (entry.isEmpty() || entry.startsWith(QLatin1Char('#')))
+                continue;
+            Check check;
+            check.destination = entry;
+            QStringList found;
+            const QString host = stripPrefix(entry);
+            if (isNumeric(host)) {
+                found << host;
+            } else if (resolved.contains(host)) {
+                const QPair<QStringList, QString> &cached = resolved[host];
+                found = cached.first;
+                check.error = cached.second;
+            } else {
+                found = resolve(host, check.error);
+                resolved.insert(host, qMakePair(found, check.error));
+            }
+            spans.append(qMakePair(static_cast<int>(addresses.size()), static_cast<int>(found.size())));
+            addresses << found;
+            checks.append(check);
+        }
+
+        RouteLookup lookup;
+        const QVector<Result> routes = lookup.lookup(addresses);
+        for (int i = 0; i < checks.size(); ++i) {
+            for (int j = 0; j < spans.at(i).second; ++j)
+                checks[i].routes.append(routes.at(spans.at(i).first + j));
+        }
+        return checks;
+    });
+}
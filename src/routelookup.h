@@ -0,0 +1,56 @@
+#ifndef ROUTELOOKUP_H
+#define ROUTELOOKUP_H
+
+#include <QFuture>
+#include <QStringList>
+#include <QVector>
+
+// Asks the kernel (NETLINK_ROUTE / RTM_GETROUTE) which route a destination would take, the
+// same answer "ip route get" gives, policy rules and split tunnel exclusions included. Many
+// addresses go out as one batch of requests on one socket instead of a process per address.
+class RouteLookup {
+public:
+    struct Result {
+        QString address; // numeric, as queried
+        QString interface;
+        QString source;
+        QString gateway; // empty for on-link destinations
+        quint32 table = 0;
+        int error = 0; // errno the kernel answered with (ENETUNREACH, ...), 0 if there is a route
+    };
+
+    // one destination as entered, with every address it resolved to
+    struct Check {
+        QString destination;
+        QVector<Result> routes;
+        QString error; // did not resolve or parse
+    };
+
+    RouteLookup();
+
+    ~RouteLookup();
+
+    RouteLookup(const RouteLookup &) = delete;
+
+    RouteLookup &operator=(const RouteLookup &) = delete;
+
+    // numeric IPv4/IPv6 addresses, results in the same order; blocks until the kernel answered
+    QVector<Result> lookup(const QStringList &addresses);
+
+    // Host names, addresses or CIDRs (the network address is checked), one per entry. Names are
+    // resolved and all addresses looked up in one batch, on a thread of its own so a long list
+    // doesn't hold up the status probes in the global pool.
+    static QFuture<QVector<Check>> checkAsync(const QStringList &destinations);
+
+    static bool isTunnel(const Result &result);
+
+private:
+    bool ensureSocket();
+
+    void closeSocket();
+
+    int fd;
+    quint32 seq;
+};
+
+#endif // ROUTELOOKUP_H
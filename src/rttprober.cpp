@@ -0,0 +1,301 @@
+#include "rttprober.h"
+#include <QFile>
+#include <QRandomGenerator>
+#include <QSocketNotifier>
+#include <QTimer>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+static constexpr int kProbeTimeoutMs = 2000;
+static constexpr int kProbeSpacingMs = 150;
+
+namespace {
+    qint64 monotonicNs() {
+        timespec ts{};
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<qint64>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    int pathIndex(RttProber::Path path) {
+        return path == RttProber::Path::Tunnel ? 0 : 1;
+    }
+} // namespace
+
+RttProber::RttProber(const QString &tunnelIface, QObject *parent)
+    : QObject(parent), tunnelIface(tunnelIface), targetLen(0), protocol(Protocol::Udp), fd(-1),
+      notifier(nullptr), timeout(new QTimer(this)), spacing(new QTimer(this)), probeTimeoutMs(kProbeTimeoutMs),
+      sentNs(0), queryId(0), currentPath(Path::Tunnel), total(0), done(0) {
+    std::memset(&target, 0, sizeof(target));
+    timeout->setSingleShot(true);
+    spacing->setSingleShot(true);
+    connect(timeout, &QTimer::timeout, this, [this]() { finishProbe(0); });
+    connect(spacing, &QTimer::timeout, this, &RttProber::nextProbe);
+}
+
+RttProber::~RttProber() {
+    closeSocket();
+}
+
+bool RttProber::setTarget(const QString &targetSpec, Protocol proto) {
+    QString host = targetSpec.trimmed();
+    quint16 port = proto == Protocol::Udp ? 53 : 443;
+
+    // [v6]:port, v4:port or a bare address
+    if (host.startsWith('[')) {
+        const int end = host.indexOf(']');
+        if (end < 0)
+            return false;
+        if (host.size() > end + 2 && host.at(end + 1) == ':')
+            port = static_cast<quint16>(host.mid(end + 2).toUInt());
+        host = host.mid(1, end - 1);
+    } else if (host.count(':') == 1) {
+        port = static_cast<quint16>(host.section(':', 1).toUInt());
+        host = host.section(':', 0, 0);
+    }
+    if (port == 0)
+        return false;
+
+    sockaddr_storage parsed;
+    socklen_t parsedLen = 0;
+    std::memset(&parsed, 0, sizeof(parsed));
+    const QByteArray addr = host.toLatin1();
+    auto *v4 = reinterpret_cast<sockaddr_in *>(&parsed);
+    auto *v6 = reinterpret_cast<sockaddr_in6 *>(&parsed);
+    if (inet_pton(AF_INET, addr.constData(), &v4->sin_addr) == 1) {
+        v4->sin_family = AF_INET;
+        v4->sin_port = htons(port);
+        parsedLen = sizeof(sockaddr_in);
+    } else if (inet_pton(AF_INET6, addr.constData(), &v6->sin6_addr) == 1) {
+        v6->sin6_family = AF_INET6;
+        v6->sin6_port = htons(port);
+        parsedLen = sizeof(sockaddr_in6);
+    } else {
+        targetLen = 0;
+        return false;
+    }
+
+    // samples of another target or protocol would skew min/median/p95
+    if (parsedLen != targetLen || proto != protocol || std::memcmp(&parsed, &target, parsedLen) != 0) {
+        histories[0].clear();
+        histories[1].clear();
+    }
+    target = parsed;
+    targetLen = parsedLen;
+    protocol = proto;
+    return true;
+}
+
+void RttProber::start(int probesPerPath) {
+    if (isRunning() || targetLen == 0 || probesPerPath <= 0)
+        return;
+    errors[0].clear();
+    errors[1].clear();
+    directIface = defaultRouteInterface(target.ss_family, tunnelIface);
+    if (directIface.isEmpty())
+        errors[pathIndex(Path::Direct)] = QStringLiteral("no default route outside the tunnel");
+    total = probesPerPath * 2;
+    done = 0;
+    nextProbe();
+}
+
+void RttProber::cancel() {
+    timeout->stop();
+    spacing->stop();
+    closeSocket();
+    if (total > 0) {
+        total = 0;
+        emit finished();
+    }
+}
+
+bool RttProber::isRunning() const {
+    return total > 0;
+}
+
+void RttProber::setProbeTimeoutMs(int ms) {
+    probeTimeoutMs = ms;
+}
+
+const RttProber::History &RttProber::history(Path path) const {
+    return histories[pathIndex(path)];
+}
+
+LatencyStats RttProber::stats(Path path) const {
+    const History &h = history(path);
+    quint32 scratch[History::capacity()];
+    int n = 0;
+    for (std::size_t i = 0; i < h.size(); ++i) {
+        if (h.at(i) != 0)
+            scratch[n++] = h.at(i);
+    }
+    return LatencyStats::compute(scratch, n);
+}
+
+int RttProber::lost(Path path) const {
+    const History &h = history(path);
+    int n = 0;
+    for (std::size_t i = 0; i < h.size(); ++i) {
+        if (h.at(i) == 0)
+            ++n;
+    }
+    return n;
+}
+
+QString RttProber::lastError(Path path) const {
+    return errors[pathIndex(path)];
+}
+
+QString RttProber::defaultRouteInterface(int family, const QString &exclude) {
+    // main table only, WARP steers traffic with its own policy table so the
+    // physical default route is still listed here
+    if (family == AF_INET6) {
+        QFile file("/proc/net/ipv6_route");
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+            return QString();
+        while (!file.atEnd()) {
+            const QList<QByteArray> f = file.readLine().simplified().split(' ');
+            if (f.size() < 10 || f.at(1) != "00" || f.at(0).count('0') != 32)
+                continue;
+            const QString dev = QString::fromLatin1(f.at(9));
+            if (dev != QLatin1String("lo") && dev != exclude)
+                return dev;
+        }
+        return QString();
+    }
+
+    QFile file("/proc/net/route");
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return QString();
+    file.readLine(); // header
+    while (!file.atEnd()) {
+        const QList<QByteArray> f = file.readLine().simplified().split(' ');
+        if (f.size() < 8 || f.at(1) != "00000000" || f.at(7) != "00000000")
+            continue;
+        const QString dev = QString::fromLatin1(f.at(0));
+        if (dev != exclude)
+            return dev;
+    }
+    return QString();
+}
+
+void RttProber::nextProbe() {
+    if (done >= total) {
+        total = 0;
+        emit finished();
+        return;
+    }
+    // alternate paths so both see the same network conditions
+    currentPath = done % 2 == 0 ? Path::Tunnel : Path::Direct;
+    const int idx = pathIndex(currentPath);
+    const QString device = currentPath == Path::Tunnel ? tunnelIface : directIface;
+    if (device.isEmpty()) {
+        ++done;
+        nextProbe();
+        return;
+    }
+
+    const int type = (protocol == Protocol::Udp ? SOCK_DGRAM : SOCK_STREAM) | SOCK_NONBLOCK | SOCK_CLOEXEC;
+    fd = ::socket(target.ss_family, type, 0);
+    if (fd < 0) {
+        errors[idx] = QString::fromLocal8Bit(strerror(errno));
+        finishProbe(0);
+        return;
+    }
+    const QByteArray dev = device.toLocal8Bit();
+    if (::setsockopt(fd, SOL_SOCKET, SO_BINDTODEVICE, dev.constData(), dev.size()) < 0) {
+        errors[idx] = QString("cannot bind to %1: %2").arg(device, QString::fromLocal8Bit(strerror(errno)));
+        closeSocket();
+        // not a lost packet, the path is unavailable
+        ++done;
+        emit progress(done, total);
+        spacing->start(0);
+        return;
+    }
+
+    sentNs = monotonicNs();
+    if (protocol == Protocol::Udp) {
+        // DNS query for ". IN A", 17 bytes; an echo server returns it unchanged which also matches
+        queryId = static_cast<quint16>(QRandomGenerator::global()->generate());
+        const unsigned char query[] = {
+            static_cast<unsigned char>(queryId >> 8), static_cast<unsigned char>(queryId & 0xff),
+            0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+            0x00, 0x00, 0x01, 0x00, 0x01
+        };
+        if (::sendto(fd, query, sizeof(query), 0, reinterpret_cast<sockaddr *>(&target), targetLen) < 0) {
+            errors[idx] = QString::fromLocal8Bit(strerror(errno));
+            finishProbe(0);
+            return;
+        }
+        notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+        connect(notifier, &QSocketNotifier::activated, this, &RttProber::onReadable);
+    } else {
+        const int rc = ::connect(fd, reinterpret_cast<sockaddr *>(&target), targetLen);
+        if (rc < 0 && errno != EINPROGRESS) {
+            errors[idx] = QString::fromLocal8Bit(strerror(errno));
+            finishProbe(0);
+            return;
+        }
+        notifier = new QSocketNotifier(fd, QSocketNotifier::Write, this);
+        connect(notifier, &QSocketNotifier::activated, this, &RttProber::onWritable);
+    }
+    timeout->start(probeTimeoutMs);
+}
+
+void RttProber::onReadable() {
+    unsigned char buf[512];
+    for (;;) {
+        const ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return; // keep waiting for ours
+            // ICMP unreachable surfaces here as ECONNREFUSED
+            errors[pathIndex(currentPath)] = QString::fromLocal8Bit(strerror(errno));
+            finishProbe(0);
+            return;
+        }
+        if (n >= 2 && ((buf[0] << 8) | buf[1]) == queryId)
+            break;
+    }
+    finishProbe(static_cast<quint32>(qMax<qint64>(1, (monotonicNs() - sentNs) / 1000)));
+}
+
+void RttProber::onWritable() {
+    int err = 0;
+    socklen_t len = sizeof(err);
+    ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len);
+    // a RST still took one round trip to arrive
+    if (err == 0 || err == ECONNREFUSED) {
+        finishProbe(static_cast<quint32>(qMax<qint64>(1, (monotonicNs() - sentNs) / 1000)));
+        return;
+    }
+    errors[pathIndex(currentPath)] = QString::fromLocal8Bit(strerror(err));
+    finishProbe(0);
+}
+
+void RttProber::finishProbe(quint32 rttUs) {
+    timeout->stop();
+    closeSocket();
+    if (total == 0)
+        return;
+    histories[pathIndex(currentPath)].push(rttUs);
+    ++done;
+    emit progress(done, total);
+    spacing->start(kProbeSpacingMs);
+}
+
+void RttProber::closeSocket() {
+    if (notifier) {
+        notifier->setEnabled(false);
+        notifier->deleteLater();
+        notifier = nullptr;
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
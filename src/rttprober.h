@@ -0,0 +1,96 @@
+#ifndef RTTPROBER_H
+#define RTTPROBER_H
+
+#include <QObject>
+#include <QString>
+#include <sys/socket.h>
+#include "latencystats.h"
+#include "samplering.h"
+
+class QSocketNotifier;
+class QTimer;
+
+// On-demand RTT probes to one target, once pinned to the tunnel interface with
+// SO_BINDTODEVICE and once pinned to the default route outside it. Everything runs on
+// the event loop with non-blocking sockets and socket notifiers, one probe in flight.
+class RttProber : public QObject {
+    Q_OBJECT
+
+public:
+    enum class Protocol {
+        Udp, // tiny DNS query, also works against a plain UDP echo server
+        Tcp  // handshake time of a non-blocking connect()
+    };
+
+    enum class Path {
+        Tunnel,
+        Direct
+    };
+
+    using History = SampleRing<quint32, 32>; // microseconds, 0 = lost
+
+    explicit RttProber(const QString &tunnelIface = QStringLiteral("CloudflareWARP"),
+                       QObject *parent = nullptr);
+
+    ~RttProber();
+
+    // numeric address with optional port: "1.1.1.1:53", "[2606:4700::1111]:443"
+    bool setTarget(const QString &target, Protocol protocol);
+
+    void start(int probesPerPath = 5);
+
+    void cancel();
+
+    bool isRunning() const;
+
+    // how long one probe waits for its answer before it counts as lost
+    void setProbeTimeoutMs(int ms);
+
+    const History &history(Path path) const;
+
+    LatencyStats stats(Path path) const;
+
+    int lost(Path path) const;
+
+    QString lastError(Path path) const;
+
+    static QString defaultRouteInterface(int family, const QString &exclude);
+
+signals:
+    void progress(int done, int total);
+
+    void finished();
+
+private:
+    void nextProbe();
+
+    void onReadable();
+
+    void onWritable();
+
+    void finishProbe(quint32 rttUs);
+
+    void closeSocket();
+
+    QString tunnelIface;
+    QString directIface;
+    sockaddr_storage target;
+    socklen_t targetLen;
+    Protocol protocol;
+
+    int fd;
+    QSocketNotifier *notifier;
+    QTimer *timeout;
+    QTimer *spacing;
+    int probeTimeoutMs;
+    qint64 sentNs;
+    quint16 queryId;
+    Path currentPath;
+    int total;
+    int done;
+
+    History histories[2];
+    QString errors[2];
+};
+
+#endif // RTTPROBER_H
@@ -0,0 +1,46 @@
+#ifndef SAMPLERING_H
+#define SAMPLERING_H
+
+#include <array>
+#include <cstddef>
+
+// Fixed-capacity ring buffer, storage is part of the object so pushing never allocates.
+// Index 0 is the oldest sample still held.
+template<typename T, std::size_t Capacity>
+class SampleRing {
+    static_assert(Capacity > 0, "SampleRing needs room for at least one sample");
+
+public:
+    void push(const T &value) {
+        data[head] = value;
+        head = (head + 1) % Capacity;
+        if (count < Capacity)
+            ++count;
+    }
+
+    const T &at(std::size_t i) const {
+        return data[(head + Capacity - count + i) % Capacity];
+    }
+
+    const T &last() const {
+        return data[(head + Capacity - 1) % Capacity];
+    }
+
+    std::size_t size() const { return count; }
+
+    bool isEmpty() const { return count == 0; }
+
+    static constexpr std::size_t capacity() { return Capacity; }
+
+    void clear() {
+        head = 0;
+        count = 0;
+    }
+
+private:
+    std::array<T, Capacity> data{};
+    std::size_t head = 0;
+    std::size_t count = 0;
+};
+
+#endif // SAMPLERING_H
@@ -0,0 +1,113 @@
+#include "sessionmonitor.h"
+#include <QCoreApplication>
+#include <QDBusMessage>
+#include <QDBusObjectPath>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QDebug>
+#include <QTimer>
+
+static const QString kLogindService = QStringLiteral("org.freedesktop.login1");
+static const QString kLogindPath = QStringLiteral("/org/freedesktop/login1");
+static const QString kManagerInterface = QStringLiteral("org.freedesktop.login1.Manager");
+static const QString kSessionInterface = QStringLiteral("org.freedesktop.login1.Session");
+
+// resume and unlock arrive within a few hundred ms of each other after opening the lid
+static constexpr int kResumeDebounceMs = 300;
+
+SessionMonitor::SessionMonitor(const QDBusConnection &bus, QObject *parent)
+    : QObject(parent), bus(bus), resumeTimer(new QTimer(this)), sleeping(false), locked(false), paused(false) {
+    resumeTimer->setSingleShot(true);
+    resumeTimer->setInterval(kResumeDebounceMs);
+    connect(resumeTimer, &QTimer::timeout, this, [this]() {
+        if (paused && !sleeping && !locked) {
+            paused = false;
+            emit pausedChanged(false);
+        }
+    });
+
+    if (!this->bus.isConnected()) {
+        qDebug() << "SessionMonitor: no D-Bus connection, suspend/lock won't pause probing";
+        return;
+    }
+    this->bus.connect(kLogindService, kLogindPath, kManagerInterface, QStringLiteral("PrepareForSleep"),
+                      this, SLOT(onPrepareForSleep(bool)));
+    resolveSession();
+}
+
+bool SessionMonitor::isSleeping() const {
+    return sleeping;
+}
+
+bool SessionMonitor::isLocked() const {
+    return locked;
+}
+
+bool SessionMonitor::isPaused() const {
+    return paused;
+}
+
+void SessionMonitor::resolveSession() {
+    // XDG_SESSION_ID is set for processes inside a login session, GetSessionByPID covers
+    // the rest (e.g. started from a session scoped autostart without the variable)
+    const QByteArray sessionId = qgetenv("XDG_SESSION_ID");
+    QDBusMessage call;
+    if (!sessionId.isEmpty()) {
+        call = QDBusMessage::createMethodCall(kLogindService, kLogindPath, kManagerInterface,
+                                              QStringLiteral("GetSession"));
+        call << QString::fromLocal8Bit(sessionId);
+    } else {
+        call = QDBusMessage::createMethodCall(kLogindService, kLogindPath, kManagerInterface,
+                                              QStringLiteral("GetSessionByPID"));
+        call << static_cast<quint32>(QCoreApplication::applicationPid());
+    }
+
+    auto watcher = new QDBusPendingCallWatcher(bus.asyncCall(call), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [this](QDBusPendingCallWatcher *w) {
+        w->deleteLater();
+        QDBusPendingReply<QDBusObjectPath> reply = *w;
+        if (reply.isError()) {
+            qDebug() << "SessionMonitor: no logind session, lock state is not followed:"
+                     << reply.error().message();
+            return;
+        }
+        subscribeSession(reply.value().path());
+    });
+}
+
+void SessionMonitor::subscribeSession(const QString &path) {
+    // Lock/Unlock only ask the screen locker to act and logind sends no Unlock when the user
+    // unlocks through the locker; LockedHint is what the locker reports back. A locker that
+    // never sets it leaves probing running while locked, which is the safe side.
+    bus.connect(kLogindService, path, QStringLiteral("org.freedesktop.DBus.Properties"),
+                QStringLiteral("PropertiesChanged"), this,
+                SLOT(onSessionPropertiesChanged(QString,QVariantMap,QStringList)));
+}
+
+void SessionMonitor::onPrepareForSleep(bool start) {
+    update(start, locked);
+}
+
+void SessionMonitor::onSessionPropertiesChanged(const QString &interface, const QVariantMap &changed,
+                                                const QStringList &) {
+    if (interface != kSessionInterface)
+        return;
+    auto it = changed.constFind(QStringLiteral("LockedHint"));
+    if (it != changed.constEnd())
+        update(sleeping, it->toBool());
+}
+
+void SessionMonitor::update(bool sleepingNow, bool lockedNow) {
+    sleeping = sleepingNow;
+    locked = lockedNow;
+    if (sleeping || locked) {
+        // pausing is immediate, we may only have a moment before the suspend
+        resumeTimer->stop();
+        if (!paused) {
+            paused = true;
+            emit pausedChanged(true);
+        }
+    } else if (paused) {
+        resumeTimer->start();
+    }
+}
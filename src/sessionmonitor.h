@@ -0,0 +1,51 @@
+#ifndef SESSIONMONITOR_H
+#define SESSIONMONITOR_H
+
+#include <QDBusConnection>
+#include <QObject>
+#include <QVariantMap>
+
+class QTimer;
+
+// Follows logind for suspend (Manager.PrepareForSleep) and screen lock (the session's
+// LockedHint) so status probing can stop while nobody can use it. Leaving sleep and
+// unlocking usually happen back to back, the resume is debounced into one signal.
+class SessionMonitor : public QObject {
+    Q_OBJECT
+
+public:
+    // the bus is injectable so a fake logind on a private bus can drive it
+    explicit SessionMonitor(const QDBusConnection &bus = QDBusConnection::systemBus(),
+                            QObject *parent = nullptr);
+
+    bool isSleeping() const;
+
+    bool isLocked() const;
+
+    bool isPaused() const;
+
+signals:
+    // true when entering sleep or lock, false once awake and unlocked again
+    void pausedChanged(bool paused);
+
+private slots:
+    void onPrepareForSleep(bool start);
+
+    void onSessionPropertiesChanged(const QString &interface, const QVariantMap &changed,
+                                    const QStringList &invalidated);
+
+private:
+    void resolveSession();
+
+    void subscribeSession(const QString &path);
+
+    void update(bool sleepingNow, bool lockedNow);
+
+    QDBusConnection bus;
+    QTimer *resumeTimer;
+    bool sleeping;
+    bool locked;
+    bool paused;
+};
+
+#endif // SESSIONMONITOR_H
@@ -1,4 +1,5 @@
 #include "settingsdiag.h"
+#include "officialtray.h"
 #include <QCheckBox>
 #include <QComboBox>
 #include <QDir>
@@ -6,6 +7,7 @@
 #include <QFormLayout>
 #include <QGroupBox>
 #include <QLabel>
+#include <QLineEdit>
 #include <QMessageBox>
 #include <QProcess>
 #include <QPushButton>
@@ -16,12 +18,26 @@
 #include <QRegularExpression>
 #include <QCoreApplication>
 #include <QFutureWatcher>
+#include <QtConcurrent>
+#include <QSpinBox>
+#include <QDateTime>
+#include "dnsbenchmark.h"
+#include "commandbatch.h"
+#include "daemonmonitor.h"
+#include "diagnosticsbundle.h"
+#include "logviewer.h"
+#include "memoryusage.h"
+#include "routeinspector.h"
+#include <QFileDialog>
+#include <QProgressBar>
 
 static const QRegularExpression kModeRegex(QStringLiteral("^Mode:\\s*([^\n]+)"),
                                            QRegularExpression::MultilineOption);
 
 SettingsDiag::SettingsDiag(MainFunctions *mf, QWidget *parent)
-    : QDialog(parent), mf(mf) {
+    : QDialog(parent), daemonMonitor(nullptr), dnsBenchmark(new DnsBenchmark(this)),
+      splitBatch(new CommandBatch(this)), diagBundle(nullptr), mf(mf),
+      settings(SettingsStore::instance()) {
     setWindowTitle("Settings");
     resize(320, 400);
     setupUI();
@@ -38,11 +54,27 @@ void SettingsDiag::setupUI() {
     checkAutoConnect = new QCheckBox("Auto-Connect WARP on Start", this);
     checkShowOnStart = new QCheckBox("Show Window on App Start", this);
     checkMinimizeOnUnfocus = new QCheckBox("Minimize the popup on Unfocus", this);
+    checkStallReconnect = new QCheckBox("Reconnect when the Tunnel Stalls", this);
+    checkStallReconnect->setToolTip("Reconnect automatically when traffic is sent through the tunnel "
+        "but nothing comes back. When off, only a warning is shown.");
 
     generalLayout->addWidget(checkAutoStart);
     generalLayout->addWidget(checkAutoConnect);
     generalLayout->addWidget(checkShowOnStart);
     generalLayout->addWidget(checkMinimizeOnUnfocus);
+    generalLayout->addWidget(checkStallReconnect);
+
+    checkLowMemory = new QCheckBox("Low-Memory Mode", this);
+    checkLowMemory->setToolTip("Destroy the popup after it has been hidden for a while and return freed "
+        "memory to the system. Reopening it takes a little longer.");
+    spinLowMemoryIdle = new QSpinBox(this);
+    spinLowMemoryIdle->setRange(5, 3600);
+    spinLowMemoryIdle->setSuffix(" s idle");
+    QHBoxLayout *lowMemoryRow = new QHBoxLayout();
+    lowMemoryRow->addWidget(checkLowMemory);
+    lowMemoryRow->addWidget(spinLowMemoryIdle);
+    generalLayout->addLayout(lowMemoryRow);
+    connect(checkLowMemory, &QCheckBox::toggled, spinLowMemoryIdle, &QSpinBox::setEnabled);
     mainLayout->addWidget(groupGeneral);
 
     QGroupBox *groupSystem = new QGroupBox("Troubleshooting", this);
@@ -55,27 +87,130 @@ void SettingsDiag::setupUI() {
     btnDisableOfficialTray->setToolTip(
         "Disables user unit 'warp-taskbar' and kills process if running, may require root.");
 
+    checkSuppressOfficialTray = new QCheckBox("Keep Official Tray Disabled", this);
+    checkSuppressOfficialTray->setToolTip(
+        "Disable the official tray again whenever it shows up, e.g. after a WARP update re-enabled it. "
+        "Otherwise you are only notified.");
+
+    btnViewLog = new QPushButton("View warp-svc Log", this);
+    btnViewLog->setToolTip("Follow the daemon log (journal or log file) with filtering.");
+    btnRouteInspector = new QPushButton("Route Inspector...", this);
+    btnRouteInspector->setToolTip("Check which destinations are routed through the tunnel and which bypass it.");
+
     systemLayout->addWidget(btnEnableDaemon);
     systemLayout->addWidget(btnDisableOfficialTray);
+    systemLayout->addWidget(checkSuppressOfficialTray);
+    btnCollectDiag = new QPushButton("Collect Diagnostics...", this);
+    btnCollectDiag->setToolTip("Save warp-cli output, service state, addresses, routes, DNS, the daemon log\n"
+        "and this app's state into one .tar.gz to attach to a support request.");
+    btnCancelDiag = new QPushButton("Cancel", this);
+    btnCancelDiag->hide();
+    progressDiag = new QProgressBar(this);
+    progressDiag->hide();
+    labelDiagStatus = new QLabel(this);
+    labelDiagStatus->setWordWrap(true);
+    labelDiagStatus->setTextInteractionFlags(Qt::TextSelectableByMouse);
+
+    QHBoxLayout *diagRow = new QHBoxLayout();
+    diagRow->addWidget(btnCollectDiag);
+    diagRow->addWidget(btnCancelDiag);
+
+    systemLayout->addWidget(btnViewLog);
+    systemLayout->addWidget(btnRouteInspector);
+    systemLayout->addLayout(diagRow);
+    systemLayout->addWidget(progressDiag);
+    systemLayout->addWidget(labelDiagStatus);
     mainLayout->addWidget(groupSystem);
 
     QGroupBox *groupWarp = new QGroupBox("Warp Configuration", this);
     QFormLayout *warpLayout = new QFormLayout(groupWarp);
 
     comboMode = new QComboBox(this);
-    comboMode->addItems({"warp", "doh", "warp+doh", "dot", "warp+dot", "tunnel_only"});
-    // "proxy" mode is unsupported, so it is not in this list.
-    // and nobody uses it anyways...
+    for (const WarpModes::Info &m : WarpModes::kTable) {
+        if (m.cliName)
+            comboMode->addItem(QString("%1 (%2)").arg(QLatin1String(m.label), QLatin1String(m.cliName)),
+                               static_cast<int>(m.mode));
+    }
+
+    spinProxyPort = new QSpinBox(this);
+    spinProxyPort->setRange(1, 65535);
+    spinProxyPort->setToolTip("Local port of the WARP SOCKS5/HTTP proxy (warp-cli proxy port).");
 
     btnRegister = new QPushButton("Register New Device", this);
 
     warpLayout->addRow("Operation Mode:", comboMode);
+    warpLayout->addRow("Proxy Port:", spinProxyPort);
     warpLayout->addRow(btnRegister);
     mainLayout->addWidget(groupWarp);
 
+    QGroupBox *groupDiag = new QGroupBox("Diagnostics", this);
+    QFormLayout *diagLayout = new QFormLayout(groupDiag);
+
+    editRttTarget = new QLineEdit(this);
+    editRttTarget->setPlaceholderText("1.1.1.1:53");
+    editRttTarget->setToolTip("Numeric address[:port] probed by 'Measure Latency' in the popup.");
+    comboRttProtocol = new QComboBox(this);
+    comboRttProtocol->addItems({"udp", "tcp"});
+
+    diagLayout->addRow("Latency Probe Target:", editRttTarget);
+    diagLayout->addRow("Latency Probe Protocol:", comboRttProtocol);
+
+    editDnsServer = new QLineEdit(this);
+    editDnsServer->setPlaceholderText("auto (WARP local DNS proxy)");
+    editDnsServer->setToolTip("Leave empty to use the proxy WARP put into /etc/resolv.conf.\n"
+        "A numeric address[:port] can point the benchmark at any other resolver.");
+    spinDnsQueries = new QSpinBox(this);
+    spinDnsQueries->setRange(1, 1000);
+    spinDnsQueries->setSuffix(" queries");
+    btnDnsBenchmark = new QPushButton("Run DNS Benchmark", this);
+    labelDnsResults = new QLabel(this);
+    labelDnsResults->setWordWrap(true);
+    labelDnsResults->setTextInteractionFlags(Qt::TextSelectableByMouse);
+
+    QHBoxLayout *dnsRow = new QHBoxLayout();
+    dnsRow->addWidget(spinDnsQueries);
+    dnsRow->addWidget(btnDnsBenchmark);
+    diagLayout->addRow("DNS Server:", editDnsServer);
+    diagLayout->addRow("DNS Benchmark:", dnsRow);
+    diagLayout->addRow(labelDnsResults);
+
+    labelMemory = new QLabel(this);
+    labelMemory->setWordWrap(true);
+    labelMemory->setTextInteractionFlags(Qt::TextSelectableByMouse);
+    diagLayout->addRow("Memory:", labelMemory);
+
+    labelDaemon = new QLabel(this);
+    labelDaemon->setWordWrap(true);
+    labelDaemon->setTextInteractionFlags(Qt::TextSelectableByMouse);
+    labelDaemon->setToolTip("CPU is per core like top, the trend shows the last two minutes.");
+    labelDaemon->hide();
+    diagLayout->addRow("warp-svc:", labelDaemon);
+    mainLayout->addWidget(groupDiag);
+
+    QGroupBox *groupSplit = new QGroupBox("Split Tunnel", this);
+    QVBoxLayout *splitLayout = new QVBoxLayout(groupSplit);
+
+    btnImportSplit = new QPushButton("Import Exclusion List...", this);
+    btnImportSplit->setToolTip("Sync the WARP exclusion list with a file of CIDRs, addresses and host names.\n"
+        "Overlapping and adjacent ranges are merged and only the differences are applied.");
+    btnCancelSplit = new QPushButton("Cancel", this);
+    btnCancelSplit->hide();
+    progressSplit = new QProgressBar(this);
+    progressSplit->hide();
+    labelSplitStatus = new QLabel(this);
+    labelSplitStatus->setWordWrap(true);
+
+    QHBoxLayout *splitRow = new QHBoxLayout();
+    splitRow->addWidget(btnImportSplit);
+    splitRow->addWidget(btnCancelSplit);
+    splitLayout->addLayout(splitRow);
+    splitLayout->addWidget(progressSplit);
+    splitLayout->addWidget(labelSplitStatus);
+    mainLayout->addWidget(groupSplit);
+
     QHBoxLayout *btnLayout = new QHBoxLayout();
-    QPushButton *btnSave = new QPushButton("Save", this);
-    QPushButton *btnCancel = new QPushButton("Cancel", this);
+    btnSave = new QPushButton("Save", this);
+    btnCancel = new QPushButton("Cancel", this);
     btnLayout->addStretch();
     btnLayout->addWidget(btnSave);
     btnLayout->addWidget(btnCancel);
@@ -86,38 +221,269 @@ void SettingsDiag::setupUI() {
     connect(btnRegister, &QPushButton::clicked, this, &SettingsDiag::registerNewClient);
     connect(btnEnableDaemon, &QPushButton::clicked, this, &SettingsDiag::enableDaemon);
     connect(btnDisableOfficialTray, &QPushButton::clicked, this, &SettingsDiag::disableOfficialTray);
+    connect(comboMode, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this]() {
+        spinProxyPort->setEnabled(selectedMode() == WarpMode::Proxy);
+    });
+    connect(btnViewLog, &QPushButton::clicked, this, &SettingsDiag::openLogViewer);
+    connect(btnRouteInspector, &QPushButton::clicked, this, &SettingsDiag::openRouteInspector);
+    connect(btnDnsBenchmark, &QPushButton::clicked, this, &SettingsDiag::runDnsBenchmark);
+    connect(btnImportSplit, &QPushButton::clicked, this, &SettingsDiag::importSplitTunnel);
+    connect(btnCollectDiag, &QPushButton::clicked, this, &SettingsDiag::collectDiagnostics);
+    connect(btnCancelSplit, &QPushButton::clicked, splitBatch, &CommandBatch::cancel);
+    connect(splitBatch, &CommandBatch::progress, this, [this](int done, int total) {
+        progressSplit->setMaximum(total);
+        progressSplit->setValue(done);
+    });
+    connect(splitBatch, &CommandBatch::finished, this, [this](bool cancelled) {
+        progressSplit->hide();
+        btnCancelSplit->hide();
+        btnImportSplit->setEnabled(true);
+        btnSave->setEnabled(true);
+        btnCancel->setEnabled(true);
+        QString status = cancelled
+                             ? QString("Cancelled after %1 of %2 changes.").arg(progressSplit->value()).arg(progressSplit->maximum())
+                             : QString("Applied %1 changes.").arg(progressSplit->maximum());
+        if (splitBatch->failedCount() > 0) {
+            status += QString(" %1 failed.").arg(splitBatch->failedCount());
+            labelSplitStatus->setToolTip(splitBatch->failures().join("\n"));
+        }
+        labelSplitStatus->setText(status);
+    });
+    connect(dnsBenchmark, &DnsBenchmark::progress, this, [this](int answered, int total, bool warmRound) {
+        btnDnsBenchmark->setText(QString("%1 %2/%3").arg(warmRound ? "Warm" : "Cold").arg(answered).arg(total));
+    });
+    connect(dnsBenchmark, &DnsBenchmark::finished, this, [this](bool ok) {
+        btnDnsBenchmark->setText("Run DNS Benchmark");
+        if (!ok) {
+            labelDnsResults->setText(QString("Benchmark against %1 failed: %2")
+                .arg(dnsBenchmark->server(), dnsBenchmark->lastError()));
+            return;
+        }
+        const DnsBenchmark::Result r = dnsBenchmark->result();
+        auto fmt = [](const LatencyStats &st, int lost) {
+            if (st.count == 0)
+                return QStringLiteral("no answers");
+            QString s = QString("p50 %1 / p95 %2 / p99 %3 ms")
+                    .arg(st.median / 1000.0, 0, 'f', 1)
+                    .arg(st.p95 / 1000.0, 0, 'f', 1)
+                    .arg(st.p99 / 1000.0, 0, 'f', 1);
+            if (lost > 0)
+                s += QString(", %1 lost").arg(lost);
+            return s;
+        };
+        // keyed by mode so runs in different modes can be compared side by side
+        const QString cli = mf ? WarpModes::cliName(mf->currentMode()) : QString();
+        const QString mode = cli.isEmpty() ? QStringLiteral("unknown") : cli;
+        const QString summary = QString("miss: %1; hit: %2 (%3 queries via %4, %5)")
+                .arg(fmt(r.cold, r.coldLost), fmt(r.warm, r.warmLost))
+                .arg(r.sent)
+                .arg(dnsBenchmark->server(), QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm"));
+        settings.setRaw("dnsBenchmark/" + mode, summary);
+        showDnsBenchmarkResults();
+    });
 }
 
 void SettingsDiag::loadSettings() {
-    checkAutoConnect->setChecked(settings.value("autoConnect", false).toBool());
-    checkAutoStart->setChecked(settings.value("autoStart", false).toBool());
-    checkShowOnStart->setChecked(settings.value("showOnStart", false).toBool());
-    checkMinimizeOnUnfocus->setChecked(settings.value("minimizeOnUnfocus", false).toBool());
-
-    QString mode = mf ? mf->GetCurrentMode() : QString();
-    int idx = comboMode->findText(mode, Qt::MatchExactly);
+    checkAutoConnect->setChecked(settings.flag(SettingsStore::Key::AutoConnect));
+    checkAutoStart->setChecked(settings.flag(SettingsStore::Key::AutoStart));
+    checkShowOnStart->setChecked(settings.flag(SettingsStore::Key::ShowOnStart));
+    checkMinimizeOnUnfocus->setChecked(settings.flag(SettingsStore::Key::MinimizeOnUnfocus));
+    checkStallReconnect->setChecked(settings.flag(SettingsStore::Key::StallReconnect));
+    checkLowMemory->setChecked(settings.flag(SettingsStore::Key::LowMemoryMode));
+    spinLowMemoryIdle->setValue(settings.number(SettingsStore::Key::LowMemoryIdleSec));
+    spinLowMemoryIdle->setEnabled(checkLowMemory->isChecked());
+    showMemoryUsage();
+    checkSuppressOfficialTray->setChecked(settings.flag(SettingsStore::Key::AutoSuppressOfficialTray));
+    editRttTarget->setText(settings.text(SettingsStore::Key::RttTarget));
+    editDnsServer->setText(settings.text(SettingsStore::Key::DnsBenchServer));
+    spinDnsQueries->setValue(settings.number(SettingsStore::Key::DnsBenchQueries));
+    showDnsBenchmarkResults();
+    comboRttProtocol->setCurrentText(settings.text(SettingsStore::Key::RttProtocol));
+
+    const WarpMode mode = mf ? mf->GetCurrentMode() : WarpMode::Unknown;
+    int idx = comboMode->findData(static_cast<int>(mode));
     if (idx >= 0) {
         comboMode->setCurrentIndex(idx);
     }
+    spinProxyPort->setValue(mf ? mf->proxyPort() : settings.number(SettingsStore::Key::ProxyPort));
+    spinProxyPort->setEnabled(selectedMode() == WarpMode::Proxy);
 }
 
 void SettingsDiag::saveSettings() {
-    settings.setValue("autoConnect", checkAutoConnect->isChecked());
-    settings.setValue("autoStart", checkAutoStart->isChecked());
-    settings.setValue("showOnStart", checkShowOnStart->isChecked());
-    settings.setValue("minimizeOnUnfocus", checkMinimizeOnUnfocus->isChecked());
+    settings.set(SettingsStore::Key::AutoConnect, checkAutoConnect->isChecked());
+    settings.set(SettingsStore::Key::AutoStart, checkAutoStart->isChecked());
+    settings.set(SettingsStore::Key::ShowOnStart, checkShowOnStart->isChecked());
+    settings.set(SettingsStore::Key::MinimizeOnUnfocus, checkMinimizeOnUnfocus->isChecked());
+    settings.set(SettingsStore::Key::StallReconnect, checkStallReconnect->isChecked());
+    settings.set(SettingsStore::Key::LowMemoryMode, checkLowMemory->isChecked());
+    settings.set(SettingsStore::Key::LowMemoryIdleSec, spinLowMemoryIdle->value());
+    settings.set(SettingsStore::Key::AutoSuppressOfficialTray, checkSuppressOfficialTray->isChecked());
+    settings.set(SettingsStore::Key::RttTarget, editRttTarget->text().trimmed().isEmpty()
+                                       ? QStringLiteral("1.1.1.1:53")
+                                       : editRttTarget->text().trimmed());
+    settings.set(SettingsStore::Key::RttProtocol, comboRttProtocol->currentText());
+    settings.set(SettingsStore::Key::DnsBenchServer, editDnsServer->text().trimmed());
+    settings.set(SettingsStore::Key::DnsBenchQueries, spinDnsQueries->value());
     setAutoStart(checkAutoStart->isChecked());
-    QString currentMode = mf ? mf->GetCurrentMode() : QString();
-    QString selectedMode = comboMode->currentText();
-    if (!selectedMode.isEmpty() && currentMode.compare(selectedMode, Qt::CaseInsensitive) != 0) {
+    const WarpMode currentMode = mf ? mf->GetCurrentMode() : WarpMode::Unknown;
+    const WarpMode newMode = selectedMode();
+    const quint16 port = static_cast<quint16>(spinProxyPort->value());
+    bool proxyPortChanged = false;
+    if (newMode == WarpMode::Proxy && mf && mf->proxyPort() != port) {
+        mf->runCommand("warp-cli", {"proxy", "port", QString::number(port)});
+        settings.set(SettingsStore::Key::ProxyPort, spinProxyPort->value());
+        proxyPortChanged = true;
+    }
+    if (newMode != WarpMode::Unknown && newMode != currentMode) {
         if (mf) {
-            mf->runCommand("warp-cli", {"mode", selectedMode});
+            mf->runCommand("warp-cli", {"mode", WarpModes::cliName(newMode)});
             mf->refreshCachedMode();
         }
+    } else if (proxyPortChanged) {
+        mf->refreshCachedMode();
     }
     accept();
 }
 
+void SettingsDiag::openLogViewer() {
+    // not parented to the dialog so it can stay open after settings are closed
+    auto viewer = new LogViewer(nullptr);
+    viewer->setAttribute(Qt::WA_DeleteOnClose);
+    viewer->show();
+}
+
+void SettingsDiag::openRouteInspector() {
+    auto inspector = new RouteInspector(nullptr);
+    inspector->setAttribute(Qt::WA_DeleteOnClose);
+    inspector->show();
+}
+
+void SettingsDiag::runDnsBenchmark() {
+    if (dnsBenchmark->isRunning()) {
+        dnsBenchmark->cancel();
+        return;
+    }
+    QString server = editDnsServer->text().trimmed();
+    if (server.isEmpty())
+        server = DnsBenchmark::detectLocalProxy();
+    if (server.isEmpty())
+        server = QStringLiteral("127.0.2.2");
+    if (!dnsBenchmark->setServer(server)) {
+        labelDnsResults->setText(QString("'%1' is not a numeric IPv4 address[:port].").arg(server));
+        return;
+    }
+    btnDnsBenchmark->setText("Starting...");
+    dnsBenchmark->start(spinDnsQueries->value());
+}
+
+void SettingsDiag::showDnsBenchmarkResults() {
+    QStringList lines;
+    for (const QString &mode : settings.childKeys("dnsBenchmark"))
+        lines << QString("<b>%1</b>: %2").arg(mode.toHtmlEscaped(),
+                                             settings.raw("dnsBenchmark/" + mode).toString().toHtmlEscaped());
+    labelDnsResults->setText(lines.isEmpty()
+                                 ? QStringLiteral("No results yet. Run the benchmark once per mode to compare.")
+                                 : lines.join("<br>"));
+}
+
+void SettingsDiag::importSplitTunnel() {
+    if (!mf || splitBatch->isRunning())
+        return;
+    const QString path = QFileDialog::getOpenFileName(this, "Import Exclusion List", QString(),
+                                                      "Lists (*.txt *.list *.conf);;All files (*)");
+    if (path.isEmpty())
+        return;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        QMessageBox::warning(this, "Import Failed", QString("Cannot read %1:\n%2").arg(path, file.errorString()));
+        return;
+    }
+    QStringList lines;
+    QTextStream in(&file);
+    while (!in.atEnd())
+        lines << in.readLine();
+
+    btnImportSplit->setEnabled(false);
+    labelSplitStatus->setToolTip(QString());
+    labelSplitStatus->setText("Reading the current exclusion list...");
+
+    auto ipWatcher = new QFutureWatcher<MainFunctions::CommandResult>(this);
+    connect(ipWatcher, &QFutureWatcherBase::finished, this, [this, ipWatcher, lines]() {
+        const auto ipRes = ipWatcher->future().result();
+        ipWatcher->deleteLater();
+
+        auto hostWatcher = new QFutureWatcher<MainFunctions::CommandResult>(this);
+        connect(hostWatcher, &QFutureWatcherBase::finished, this, [this, hostWatcher, lines, ipRes]() {
+            const auto hostRes = hostWatcher->future().result();
+            hostWatcher->deleteLater();
+            if (ipRes.timedOut || ipRes.exitCode != 0) {
+                btnImportSplit->setEnabled(true);
+                labelSplitStatus->setText(QString("Could not read the current list: %1")
+                    .arg(ipRes.err.isEmpty() ? QStringLiteral("warp-cli failed") : ipRes.err));
+                return;
+            }
+            // a cut off list would turn into removals of everything past the cut
+            if (ipRes.truncated || hostRes.truncated) {
+                btnImportSplit->setEnabled(true);
+                labelSplitStatus->setText("The current list is too long to be read completely, nothing was changed.");
+                return;
+            }
+            applySplitTunnelPlan(SplitTunnel::plan(lines, ipRes.out, hostRes.exitCode == 0 ? hostRes.out : QString()));
+        });
+        hostWatcher->setFuture(mf->runCommandAsync("warp-cli", {"tunnel", "host", "list"}, 10000));
+    });
+    ipWatcher->setFuture(mf->runCommandAsync("warp-cli", {"tunnel", "ip", "list"}, 10000));
+}
+
+void SettingsDiag::applySplitTunnelPlan(const SplitTunnel::Plan &plan) {
+    const QString summary = QString("%1 entries imported, %2 IP ranges after merging, %3 lines ignored.")
+            .arg(plan.importedEntries)
+            .arg(plan.aggregatedIps)
+            .arg(plan.ignoredLines);
+    if (plan.isEmpty()) {
+        btnImportSplit->setEnabled(true);
+        labelSplitStatus->setText(summary + "\nAlready in sync, nothing to change.");
+        return;
+    }
+
+    auto reply = QMessageBox::question(
+        this,
+        "Apply Exclusion List",
+        QString("%1\n\nAdd %2 ranges and %3 hosts, remove %4 ranges and %5 hosts.\n"
+                "Entries not in the file are removed, including WARP's default exclusions. Continue?")
+        .arg(summary)
+        .arg(plan.addIps.size())
+        .arg(plan.addHosts.size())
+        .arg(plan.removeIps.size())
+        .arg(plan.removeHosts.size()),
+        QMessageBox::Yes | QMessageBox::No);
+    if (reply != QMessageBox::Yes) {
+        btnImportSplit->setEnabled(true);
+        labelSplitStatus->setText(summary);
+        return;
+    }
+
+    const QVector<CommandBatch::Command> cmds = SplitTunnel::commands(plan);
+    progressSplit->setRange(0, cmds.size());
+    progressSplit->setValue(0);
+    progressSplit->show();
+    btnCancelSplit->show();
+    labelSplitStatus->setText(summary);
+    btnSave->setEnabled(false);
+    btnCancel->setEnabled(false);
+    splitBatch->start(cmds);
+}
+
+void SettingsDiag::reject() {
+    // Escape and the window's close button end up here too
+    if (splitBatch->isRunning()) {
+        labelSplitStatus->setText("Still applying split tunnel changes, cancel the import or wait for it to finish.");
+        return;
+    }
+    QDialog::reject();
+}
+
 void SettingsDiag::registerNewClient() {
     auto reply = QMessageBox::question(
         this,
@@ -125,9 +491,21 @@ void SettingsDiag::registerNewClient() {
         "This will re-register the client and might reset your license key. Continue?",
         QMessageBox::Yes | QMessageBox::No);
 
-    if (reply == QMessageBox::Yes) {
-        if (mf)
-            mf->cliRegister();
+    if (reply != QMessageBox::Yes || !mf)
+        return;
+
+    QMessageBox::information(
+        this,
+        QStringLiteral("Accept Terms of Service"),
+        QStringLiteral("Cloudflare WARP requires accepting its Terms of Service in a terminal once.\n\n"
+                       "A terminal window will now open. Please complete registration and close it when finished.")
+    );
+    if (!mf->cliRegister()) {
+        QMessageBox::critical(
+            this,
+            QStringLiteral("Terminal Error"),
+            QStringLiteral("No supported terminal emulator found.")
+        );
     }
 }
 
@@ -196,65 +574,141 @@ void SettingsDiag::setAutoStart(bool enable) {
 }
 
 void SettingsDiag::disableOfficialTray() {
-    auto watcher1 = new QFutureWatcher<MainFunctions::CommandResult>(this);
-    if (!mf) {
-        watcher1->deleteLater();
+    if (!mf)
         return;
-    }
-    watcher1->setFuture(
-        mf->runCommandAsync("systemctl", {"--user", "disable", "warp-taskbar"}, 10000));
+    auto watcher = new QFutureWatcher<OfficialTray::SuppressResult>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher]() {
+        const OfficialTray::SuppressResult r = watcher->result();
+        watcher->deleteLater();
 
-    connect(watcher1, &QFutureWatcherBase::finished, this, [this, watcher1]() {
-        auto res1 = watcher1->future().result();
-        watcher1->deleteLater();
+        if (r.unitHandled && r.overrideWritten) {
+            QMessageBox::information(
+                this,
+                "Success",
+                "Warp tray disabled and autostart overridden for this user."
+            );
+        } else {
+            QMessageBox::warning(
+                this,
+                "Partial/Failed",
+                "User service was handled, but autostart override failed."
+            );
+        }
+    });
+    MainFunctions *mainFunctions = mf;
+    watcher->setFuture(QtConcurrent::run([mainFunctions]() {
+        return OfficialTray::suppress(mainFunctions, OfficialTray::findRunning());
+    }));
+}
 
-        if (!mf) return;
-        auto watcher2 = new QFutureWatcher<MainFunctions::CommandResult>(this);
-        watcher2->setFuture(
-            mf->runCommandAsync("systemctl", {"--user", "stop", "warp-taskbar"}, 5000)
-        );
+void SettingsDiag::collectDiagnostics() {
+    if (diagBundle)
+        return;
+    const QString target = QFileDialog::getSaveFileName(this, "Save Diagnostics",
+                                                        QDir::home().filePath(DiagnosticsBundle::defaultFileName()),
+                                                        "Archives (*.tar.gz)");
+    if (target.isEmpty())
+        return;
 
-        connect(watcher2, &QFutureWatcherBase::finished, this, [this, res1, watcher2]() {
-            watcher2->deleteLater();
+    diagBundle = new DiagnosticsBundle(this);
+    diagBundle->addStandardSources();
+    diagBundle->addText("app/state.txt", appReport());
+    connect(btnCancelDiag, &QPushButton::clicked, diagBundle, &DiagnosticsBundle::cancel);
+    connect(diagBundle, &DiagnosticsBundle::progress, this, [this](int done, int total) {
+        progressDiag->setMaximum(total);
+        progressDiag->setValue(done);
+    });
+    connect(diagBundle, &DiagnosticsBundle::finished, this, [this](bool ok, bool cancelled) {
+        progressDiag->hide();
+        btnCancelDiag->hide();
+        btnCollectDiag->setEnabled(true);
+        QString status;
+        if (cancelled)
+            status = QStringLiteral("Cancelled, nothing was saved.");
+        else if (!ok)
+            status = QString("Failed: %1").arg(diagBundle->lastError());
+        else
+            status = QString("Saved to %1").arg(diagBundle->archivePath());
+        const QStringList problems = diagBundle->failures();
+        if (ok && !problems.isEmpty())
+            status += QString(" (%1 with problems)").arg(problems.size());
+        labelDiagStatus->setToolTip(problems.join("\n"));
+        labelDiagStatus->setText(status);
+        diagBundle->deleteLater();
+        diagBundle = nullptr;
+    });
 
-            // user autostart override always write Hidden=true
-            const QString autostartDir =
-                    QStandardPaths::writableLocation(QStandardPaths::ConfigLocation)
-                    + "/autostart";
+    if (!diagBundle->start(target)) {
+        labelDiagStatus->setText(QString("Cannot write %1: %2").arg(target, diagBundle->lastError()));
+        delete diagBundle;
+        diagBundle = nullptr;
+        return;
+    }
+    btnCollectDiag->setEnabled(false);
+    btnCancelDiag->show();
+    progressDiag->show();
+    labelDiagStatus->setToolTip(QString());
+    labelDiagStatus->setText("Collecting...");
+}
 
-            QDir().mkpath(autostartDir);
+QByteArray SettingsDiag::appReport() const {
+    QString text;
+    QTextStream out(&text);
+    out << "generated: " << QDateTime::currentDateTime().toString(Qt::ISODate) << '\n'
+        << "qt: " << qVersion() << '\n'
+        << "rss_kb: " << MemoryUsage::residentBytes() / 1024 << '\n';
+    if (mf) {
+        const MainFunctions::RetryStats stats = mf->retryStats();
+        out << "mode: " << WarpModes::label(mf->currentMode()) << '\n'
+            << "proxy_port: " << mf->proxyPort() << '\n'
+            << "retry_recoveries: " << stats.recoveries << '\n'
+            << "retry_exhausted: " << stats.exhausted << '\n'
+            << "retry_total_recovery_ms: " << stats.totalRecoveryMs << '\n';
+    }
+    out << "truncated_commands: " << MainFunctions::truncatedCommandCount() << '\n';
+    if (daemonMonitor)
+        out << "\nwarp-svc:\n" << daemonMonitor->summary() << '\n';
+
+    // the settings in effect, the file itself may be out of date by a debounce
+    out << "\nsettings:\n";
+    for (int i = 0; i < static_cast<int>(SettingsStore::Key::KeyCount); ++i) {
+        const auto key = static_cast<SettingsStore::Key>(i);
+        out << SettingsStore::keyName(key) << '=' << settings.value(key).toString() << '\n';
+    }
+    out.flush();
+    return text.toUtf8();
+}
 
-            const QString desktopPath =
-                    autostartDir + "/com.cloudflare.WarpTaskbar.desktop";
+void SettingsDiag::setDaemonMonitor(DaemonMonitor *monitor) {
+    if (daemonMonitor || !monitor)
+        return;
+    daemonMonitor = monitor;
+    connect(daemonMonitor, &DaemonMonitor::sampleAdded, this, &SettingsDiag::showDaemonUsage);
+    connect(daemonMonitor, &DaemonMonitor::daemonChanged, this, &SettingsDiag::showDaemonUsage);
+    labelDaemon->show();
+    showDaemonUsage();
+}
 
-            QFile file(desktopPath);
-            bool ok = file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text);
+void SettingsDiag::showDaemonUsage() {
+    labelDaemon->setText(daemonMonitor->summary());
+}
 
-            if (ok) {
-                QTextStream out(&file);
-                out <<
-                        "[Desktop Entry]\n"
-                        "Type=Application\n"
-                        "Name=Cloudflare WARP Zero Trust client / Tray Override\n"
-                        "Hidden=true\n";
-                file.close();
-            }
+void SettingsDiag::showMemoryUsage() {
+    auto mib = [](qint64 bytes) {
+        return bytes < 0 ? QStringLiteral("?") : QString::number(bytes / (1024.0 * 1024.0), 'f', 1);
+    };
+    QString text = QString("%1 MiB resident").arg(mib(MemoryUsage::residentBytes()));
+    const MemoryUsage::Release r = MemoryUsage::lastRelease();
+    if (r.timestampMs > 0) {
+        text += QString("\nLast popup release at %1: %2 → %3 MiB")
+                .arg(QDateTime::fromMSecsSinceEpoch(r.timestampMs).toString("hh:mm:ss"),
+                     mib(r.rssBeforeBytes), mib(r.rssAfterBytes));
+    }
+    labelMemory->setText(text);
+}
 
-            if (!res1.timedOut &&
-                (res1.exitCode == 0 || res1.exitCode == 1) &&
-                ok) {
-                QMessageBox::information(
-                    this,
-                    "Success",
-                    "Warp tray disabled and autostart overridden for this user."
-                );
-            } else {
-                QMessageBox::warning(
-                    this,
-                    "Partial/Failed",
-                    "User service was handled, but autostart override failed."
-                );
-            }
-        });
-    });
+WarpMode SettingsDiag::selectedMode() const {
+    return comboMode->currentIndex() < 0
+               ? WarpMode::Unknown
+               : WarpModes::fromCode(static_cast<quint8>(comboMode->currentData().toInt()));
 }
@@ -2,13 +2,22 @@
 #define SETTINGSDIAG_H
 
 #include <QDialog>
-#include <QSettings>
 #include "mainfunctions.h"
+#include "settingsstore.h"
+#include "splittunnel.h"
 
 class QVBoxLayout;
 class QCheckBox;
 class QComboBox;
 class QPushButton;
+class QLineEdit;
+class QSpinBox;
+class QLabel;
+class DnsBenchmark;
+class CommandBatch;
+class QProgressBar;
+class DaemonMonitor;
+class DiagnosticsBundle;
 
 class SettingsDiag : public QDialog {
     Q_OBJECT
@@ -16,6 +25,12 @@ class SettingsDiag : public QDialog {
 public:
     explicit SettingsDiag(MainFunctions *mf, QWidget *parent = nullptr);
 
+    // live warp-svc CPU, memory and I/O in the diagnostics group
+    void setDaemonMonitor(DaemonMonitor *monitor);
+
+    // refused while a split tunnel import is applied, the daemon would be left half-edited
+    void reject() override;
+
 private
     slots:
 
@@ -29,6 +44,16 @@ private
 
     void disableOfficialTray();
 
+    void runDnsBenchmark();
+
+    void openLogViewer();
+
+    void openRouteInspector();
+
+    void importSplitTunnel();
+
+    void collectDiagnostics();
+
 private:
     void setupUI();
 
@@ -36,16 +61,58 @@ private:
 
     void setAutoStart(bool enable);
 
+    void showDnsBenchmarkResults();
+
+    void showMemoryUsage();
+
+    void showDaemonUsage();
+
+    // the app's own view of things for the diagnostics archive
+    QByteArray appReport() const;
+
+    WarpMode selectedMode() const;
+
+    void applySplitTunnelPlan(const SplitTunnel::Plan &plan);
+
     QCheckBox *checkAutoStart;
     QCheckBox *checkAutoConnect;
     QCheckBox *checkShowOnStart;
     QCheckBox *checkMinimizeOnUnfocus;
+    QCheckBox *checkStallReconnect;
+    QCheckBox *checkLowMemory;
+    QSpinBox *spinLowMemoryIdle;
+    QLabel *labelMemory;
+    QLabel *labelDaemon;
+    DaemonMonitor *daemonMonitor;
     QComboBox *comboMode;
+    QSpinBox *spinProxyPort;
+    QLineEdit *editRttTarget;
+    QComboBox *comboRttProtocol;
+    QLineEdit *editDnsServer;
+    QSpinBox *spinDnsQueries;
+    QPushButton *btnDnsBenchmark;
+    QLabel *labelDnsResults;
+    DnsBenchmark *dnsBenchmark;
+    QPushButton *btnImportSplit;
+    QPushButton *btnCancelSplit;
+    QProgressBar *progressSplit;
+    QLabel *labelSplitStatus;
+    CommandBatch *splitBatch;
+    QPushButton *btnSave;
+    QPushButton *btnCancel;
     QPushButton *btnRegister;
     QPushButton *btnEnableDaemon;
     QPushButton *btnDisableOfficialTray;
+    QCheckBox *checkSuppressOfficialTray;
+    QPushButton *btnViewLog;
+    QPushButton *btnRouteInspector;
+    QPushButton *btnCollectDiag;
+    QPushButton *btnCancelDiag;
+    QProgressBar *progressDiag;
+    QLabel *labelDiagStatus;
+    DiagnosticsBundle *diagBundle;
     MainFunctions *mf;
-    QSettings settings;
+    SettingsStore &settings;
 };
 
 #endif // SETTINGSDIAG_H
\ No newline at end of file
@@ -0,0 +1,265 @@
+#include "settingsstore.h"
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QSettings>
+#include <QTimer>
+
+// a dialog saves a dozen keys in a row, write them as one
+static constexpr int kSaveDelayMs = 500;
+// editors touch the file more than once per save
+static constexpr int kReloadDelayMs = 200;
+
+namespace {
+    // the default of a key, kept literal so the table below can be checked at compile time
+    struct Fallback {
+        enum class Kind {
+            Bool,
+            Int,
+            Text
+        };
+
+        constexpr Fallback(bool b) : kind(Kind::Bool), number(b), text(nullptr) {
+        }
+
+        constexpr Fallback(int n) : kind(Kind::Int), number(n), text(nullptr) {
+        }
+
+        // nullptr for a null QString
+        constexpr Fallback(const char *s) : kind(Kind::Text), number(0), text(s) {
+        }
+
+        QVariant toVariant() const {
+            switch (kind) {
+                case Kind::Bool:
+                    return number != 0;
+                case Kind::Int:
+                    return number;
+                case Kind::Text:
+                    break;
+            }
+            return text ? QString::fromLatin1(text) : QString();
+        }
+
+        Kind kind;
+        int number;
+        const char *text;
+    };
+
+    struct KeyInfo {
+        SettingsStore::Key key;
+        const char *name;
+        Fallback fallback;
+    };
+
+    // indexed by Key
+    constexpr KeyInfo kKeys[] = {
+        {SettingsStore::Key::AutoConnect, "autoConnect", false},
+        {SettingsStore::Key::AutoStart, "autoStart", false},
+        {SettingsStore::Key::ShowOnStart, "showOnStart", false},
+        {SettingsStore::Key::MinimizeOnUnfocus, "minimizeOnUnfocus", true},
+        {SettingsStore::Key::StallReconnect, "stallReconnect", true},
+        {SettingsStore::Key::LowMemoryMode, "lowMemoryMode", false},
+        {SettingsStore::Key::LowMemoryIdleSec, "lowMemoryIdleSec", 60},
+        {SettingsStore::Key::AutoSuppressOfficialTray, "autoSuppressOfficialTray", false},
+        {SettingsStore::Key::RttTarget, "rttTarget", "1.1.1.1:53"},
+        {SettingsStore::Key::RttProtocol, "rttProtocol", "udp"},
+        {SettingsStore::Key::DnsBenchServer, "dnsBenchServer", nullptr},
+        {SettingsStore::Key::DnsBenchQueries, "dnsBenchQueries", 100},
+        {SettingsStore::Key::ProxyPort, "proxyPort", 40000},
+        {SettingsStore::Key::DaemonCpuWarnPercent, "daemonCpuWarnPercent", 90},
+        {SettingsStore::Key::DaemonRssWarnMb, "daemonRssWarnMb", 512},
+    };
+
+    constexpr int kKeyCount = static_cast<int>(SettingsStore::Key::KeyCount);
+
+    constexpr bool keysInEnumOrder() {
+        for (int i = 0; i < kKeyCount; ++i) {
+            if (static_cast<int>(kKeys[i].key) != i)
+                return false;
+        }
+        return true;
+    }
+
+    static_assert(static_cast<int>(sizeof(kKeys) / sizeof(kKeys[0])) == kKeyCount, "every Key needs a row in kKeys");
+    static_assert(keysInEnumOrder(), "kKeys rows must be indexed by their Key value");
+
+    const KeyInfo &keyInfo(SettingsStore::Key key) {
+        return kKeys[static_cast<int>(key)];
+    }
+
+    const KeyInfo *findKey(const QString &name) {
+        for (const KeyInfo &info : kKeys) {
+            if (name == QLatin1String(info.name))
+                return &info;
+        }
+        return nullptr;
+    }
+
+    // the file hands back strings, memory may hold the typed value, "true" == true here
+    bool sameValue(const QVariant &a, const QVariant &b) {
+        return a.isValid() == b.isValid() && a.toString() == b.toString();
+    }
+} // namespace
+
+SettingsStore &SettingsStore::instance() {
+    // parented to the application so pending writes are flushed while it is still around
+    static SettingsStore *store = new SettingsStore(QCoreApplication::instance());
+    return *store;
+}
+
+SettingsStore::SettingsStore(QObject *parent)
+    : QObject(parent), saveTimer(new QTimer(this)), reloadTimer(new QTimer(this)),
+      watcher(new QFileSystemWatcher(this)) {
+    saveTimer->setSingleShot(true);
+    saveTimer->setInterval(kSaveDelayMs);
+    connect(saveTimer, &QTimer::timeout, this, &SettingsStore::flush);
+    reloadTimer->setSingleShot(true);
+    reloadTimer->setInterval(kReloadDelayMs);
+    connect(reloadTimer, &QTimer::timeout, this, &SettingsStore::reloadFromDisk);
+
+    connect(watcher, &QFileSystemWatcher::fileChanged, this, [this]() {
+        // saved by rename, the watch went with the old inode
+        watchFile();
+        reloadTimer->start();
+    });
+    connect(watcher, &QFileSystemWatcher::directoryChanged, this, [this]() {
+        watchFile();
+        reloadTimer->start();
+    });
+    if (QCoreApplication::instance())
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, &SettingsStore::flush);
+
+    load();
+    watchFile();
+}
+
+SettingsStore::~SettingsStore() {
+    flush();
+}
+
+QVariant SettingsStore::value(Key key) const {
+    const KeyInfo &info = keyInfo(key);
+    return values.value(QLatin1String(info.name), info.fallback.toVariant());
+}
+
+bool SettingsStore::flag(Key key) const {
+    return value(key).toBool();
+}
+
+int SettingsStore::number(Key key) const {
+    return value(key).toInt();
+}
+
+QString SettingsStore::text(Key key) const {
+    return value(key).toString();
+}
+
+void SettingsStore::set(Key key, const QVariant &value) {
+    const QString name = QLatin1String(keyInfo(key).name);
+    if (values.contains(name) && sameValue(values.value(name), value))
+        return;
+    store(name, value);
+    emit changed(key, value);
+}
+
+QVariant SettingsStore::raw(const QString &name, const QVariant &fallback) const {
+    return values.value(name, fallback);
+}
+
+void SettingsStore::setRaw(const QString &name, const QVariant &value) {
+    if (values.contains(name) && sameValue(values.value(name), value))
+        return;
+    store(name, value);
+    emit rawChanged(name, value);
+}
+
+QStringList SettingsStore::childKeys(const QString &group) const {
+    const QString prefix = group + QLatin1Char('/');
+    QStringList keys;
+    for (auto it = values.cbegin(); it != values.cend(); ++it) {
+        if (it.key().startsWith(prefix) && it.key().indexOf(QLatin1Char('/'), prefix.size()) < 0)
+            keys.append(it.key().mid(prefix.size()));
+    }
+    keys.sort();
+    return keys;
+}
+
+QString SettingsStore::keyName(Key key) {
+    return QLatin1String(keyInfo(key).name);
+}
+
+void SettingsStore::flush() {
+    saveTimer->stop();
+    if (dirty.isEmpty())
+        return;
+    QSettings settings;
+    for (const QString &name : dirty)
+        settings.setValue(name, values.value(name));
+    dirty.clear();
+    settings.sync();
+    // the file may not have existed when we started watching
+    watchFile();
+}
+
+void SettingsStore::load() {
+    QSettings settings;
+    path = settings.fileName();
+    for (const QString &name : settings.allKeys())
+        values.insert(name, settings.value(name));
+}
+
+void SettingsStore::reloadFromDisk() {
+    QSettings settings;
+    // QSettings caches the file per process, make it look again
+    settings.sync();
+    const QStringList names = settings.allKeys();
+    for (const QString &name : names) {
+        if (dirty.contains(name))
+            continue;
+        const QVariant onDisk = settings.value(name);
+        if (values.contains(name) && sameValue(values.value(name), onDisk))
+            continue;
+        values.insert(name, onDisk);
+        if (const KeyInfo *info = findKey(name))
+            emit changed(info->key, onDisk);
+        else
+            emit rawChanged(name, onDisk);
+    }
+
+    // removed from the file, back to the default
+    QSet<QString> present;
+    for (const QString &name : names)
+        present.insert(name);
+    for (auto it = values.begin(); it != values.end();) {
+        if (present.contains(it.key()) || dirty.contains(it.key())) {
+            ++it;
+            continue;
+        }
+        const QString name = it.key();
+        it = values.erase(it);
+        if (const KeyInfo *info = findKey(name))
+            emit changed(info->key, info->fallback.toVariant());
+        else
+            emit rawChanged(name, QVariant());
+    }
+}
+
+void SettingsStore::watchFile() {
+    if (path.isEmpty())
+        return;
+    if (QFileInfo::exists(path)) {
+        if (!watcher->files().contains(path))
+            watcher->addPath(path);
+    }
+    // creation and replace-by-rename only show up on the directory
+    const QString dir = QFileInfo(path).absolutePath();
+    if (QFileInfo::exists(dir) && !watcher->directories().contains(dir))
+        watcher->addPath(dir);
+}
+
+void SettingsStore::store(const QString &name, const QVariant &value) {
+    values.insert(name, value);
+    dirty.insert(name);
+    saveTimer->start();
+}
@@ -0,0 +1,108 @@
+#ifndef SETTINGSSTORE_H
+#define SETTINGSSTORE_H
+
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QVariant>
+
+class QFileSystemWatcher;
+class QTimer;
+
+// The app's settings, read from the config file once and kept in memory. Writes land in memory
+// right away and reach the file in one debounced batch, edits made to the file from outside
+// (config management, a text editor) are picked up live. GUI thread only.
+class SettingsStore : public QObject {
+    Q_OBJECT
+
+public:
+    enum class Key {
+        AutoConnect,
+        AutoStart,
+        ShowOnStart,
+        MinimizeOnUnfocus,
+        StallReconnect,
+        LowMemoryMode,
+        LowMemoryIdleSec,
+        AutoSuppressOfficialTray,
+        RttTarget,
+        RttProtocol,
+        DnsBenchServer,
+        DnsBenchQueries,
+        ProxyPort,
+        DaemonCpuWarnPercent,
+        DaemonRssWarnMb,
+        // not a key, the number of them
+        KeyCount
+    };
+
+    static SettingsStore &instance();
+
+    ~SettingsStore() override;
+
+    QVariant value(Key key) const;
+
+    bool flag(Key key) const;
+
+    int number(Key key) const;
+
+    QString text(Key key) const;
+
+    void set(Key key, const QVariant &value);
+
+    // free-form keys like "dnsBenchmark/warp" that have no Key of their own
+    QVariant raw(const QString &name, const QVariant &fallback = QVariant()) const;
+
+    void setRaw(const QString &name, const QVariant &value);
+
+    // direct children of a group, e.g. the modes under "dnsBenchmark"
+    QStringList childKeys(const QString &group) const;
+
+    static QString keyName(Key key);
+
+    // calls f(value) whenever key changes, for as long as context lives
+    template<typename Func>
+    QMetaObject::Connection onChanged(Key key, const QObject *context, Func f) {
+        return connect(this, &SettingsStore::changed, context, [key, f](Key changedKey, const QVariant &value) {
+            if (changedKey == key)
+                f(value);
+        });
+    }
+
+public
+    slots:
+
+    
+
+    // writes pending changes now instead of when the debounce runs out
+    void flush();
+
+    signals:
+
+    
+
+    void changed(SettingsStore::Key key, const QVariant &value);
+
+    void rawChanged(const QString &name, const QVariant &value);
+
+private:
+    explicit SettingsStore(QObject *parent = nullptr);
+
+    void load();
+
+    void reloadFromDisk();
+
+    void watchFile();
+
+    void store(const QString &name, const QVariant &value);
+
+    QString path;
+    QHash<QString, QVariant> values;
+    // written in memory but not on disk yet, a reload must not undo them
+    QSet<QString> dirty;
+    QTimer *saveTimer;
+    QTimer *reloadTimer;
+    QFileSystemWatcher *watcher;
+};
+
+#endif // SETTINGSSTORE_H
@@ -0,0 +1,107 @@
+#include "sockdiag.h"
+#include <cerrno>
+#include <cstring>
+#include <linux/inet_diag.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/sock_diag.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace {
+    constexpr int kTcpListen = 10; // TCP_LISTEN from the kernel's tcp_states.h
+
+    struct DiagRequest {
+        nlmsghdr nlh;
+        inet_diag_req_v2 req;
+        rtattr bytecode;
+        // "sport >= port && sport <= port", see inet_diag_bc_run()
+        inet_diag_bc_op ops[4];
+    };
+} // namespace
+
+SockDiag::SockDiag() : fd(-1), seq(0) {
+}
+
+SockDiag::~SockDiag() {
+    if (fd >= 0)
+        ::close(fd);
+}
+
+bool SockDiag::ensureSocket() {
+    if (fd >= 0)
+        return true;
+    fd = ::socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+    if (fd < 0)
+        return false;
+    // the kernel answers a dump right away, this only guards against surprises
+    timeval tv{1, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    return true;
+}
+
+int SockDiag::isTcpListening(quint16 port) {
+    if (!ensureSocket())
+        return -1;
+    const int v4 = queryFamily(AF_INET, port);
+    if (v4 > 0)
+        return 1;
+    const int v6 = queryFamily(AF_INET6, port);
+    if (v6 > 0)
+        return 1;
+    return (v4 < 0 && v6 < 0) ? -1 : 0;
+}
+
+int SockDiag::queryFamily(int family, quint16 port) {
+    DiagRequest msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.nlh.nlmsg_len = sizeof(msg);
+    msg.nlh.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+    msg.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    msg.nlh.nlmsg_seq = ++seq;
+    msg.req.sdiag_family = static_cast<__u8>(family);
+    msg.req.sdiag_protocol = IPPROTO_TCP;
+    msg.req.idiag_states = 1u << kTcpListen;
+    msg.bytecode.rta_type = INET_DIAG_REQ_BYTECODE;
+    msg.bytecode.rta_len = RTA_LENGTH(sizeof(msg.ops));
+    // a failed compare jumps 4 bytes past the end, which rejects the socket
+    msg.ops[0] = {INET_DIAG_BC_S_GE, 8, 20};
+    msg.ops[1] = {0, 0, port};
+    msg.ops[2] = {INET_DIAG_BC_S_LE, 8, 12};
+    msg.ops[3] = {0, 0, port};
+
+    sockaddr_nl kernel{};
+    kernel.nl_family = AF_NETLINK;
+    if (::sendto(fd, &msg, sizeof(msg), 0, reinterpret_cast<sockaddr *>(&kernel), sizeof(kernel)) < 0) {
+        ::close(fd);
+        fd = -1;
+        return -1;
+    }
+
+    int matches = 0;
+    alignas(nlmsghdr) char buf[8192];
+    for (;;) {
+        const ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            // drop the socket so a half-read dump cant confuse the next query
+            ::close(fd);
+            fd = -1;
+            return -1;
+        }
+        int len = static_cast<int>(n);
+        for (auto *h = reinterpret_cast<nlmsghdr *>(buf); NLMSG_OK(h, len); h = NLMSG_NEXT(h, len)) {
+            if (h->nlmsg_seq != msg.nlh.nlmsg_seq)
+                continue;
+            if (h->nlmsg_type == NLMSG_DONE)
+                return matches;
+            if (h->nlmsg_type == NLMSG_ERROR)
+                return -1; // e.g. no IPv6 support
+            if (h->nlmsg_type == SOCK_DIAG_BY_FAMILY)
+                ++matches;
+        }
+    }
+}
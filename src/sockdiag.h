@@ -0,0 +1,31 @@
+#ifndef SOCKDIAG_H
+#define SOCKDIAG_H
+
+#include <QtGlobal>
+
+// Asks the kernel (NETLINK_SOCK_DIAG / inet_diag) whether a TCP socket is listening on a
+// port. The port and state filter run in the kernel, so the reply holds only matching
+// sockets and the cost does not depend on how many sockets the host has.
+class SockDiag {
+public:
+    SockDiag();
+
+    ~SockDiag();
+
+    SockDiag(const SockDiag &) = delete;
+
+    SockDiag &operator=(const SockDiag &) = delete;
+
+    // 1 listening (IPv4 or IPv6), 0 not listening, -1 netlink unavailable
+    int isTcpListening(quint16 port);
+
+private:
+    int queryFamily(int family, quint16 port);
+
+    bool ensureSocket();
+
+    int fd;
+    quint32 seq;
+};
+
+#endif // SOCKDIAG_H
@@ -0,0 +1,90 @@
+#include "splittunnel.h"
+#include "cidrset.h"
+#include <QRegularExpression>
+#include <QSet>
+
+namespace {
+    const QRegularExpression &hostRegex() {
+        static const QRegularExpression re(
+            QStringLiteral("^(\\*\\.)?([a-z0-9]([a-z0-9-]{0,61}[a-z0-9])?\\.)+[a-z]{2,63}\\.?$"));
+        return re;
+    }
+
+    // the list commands print a heading and maybe comments next to entries,
+    // so pick out every token that looks like an entry
+    void parseDaemonList(const QString &output, QSet<QString> &ips, QSet<QString> &hosts) {
+        const QStringList lines = output.split(QLatin1Char('\n'));
+        for (const QString &line : lines) {
+            for (const QString &token : line.split(QRegularExpression(QStringLiteral("\\s+")))) {
+                const QString canonical = CidrSet::canonical(token);
+                if (!canonical.isEmpty()) {
+                    ips.insert(canonical);
+                    continue;
+                }
+                const QString host = token.toLower();
+                if (hostRegex().match(host).hasMatch())
+                    hosts.insert(host);
+            }
+        }
+    }
+
+    QStringList sorted(QSet<QString> set) {
+        QStringList list(set.begin(), set.end());
+        list.sort();
+        return list;
+    }
+} // namespace
+
+SplitTunnel::Plan SplitTunnel::plan(const QStringList &importLines, const QString &ipListOutput,
+                                    const QString &hostListOutput) {
+    Plan result;
+    CidrSet wantedIps;
+    QSet<QString> wantedHosts;
+
+    for (const QString &raw : importLines) {
+        const QString entry = raw.section(QLatin1Char('#'), 0, 0).trimmed();
+        if (entry.isEmpty())
+            continue;
+        if (wantedIps.add(entry)) {
+            ++result.importedEntries;
+            continue;
+        }
+        const QString host = entry.toLower();
+        if (hostRegex().match(host).hasMatch()) {
+            wantedHosts.insert(host);
+            ++result.importedEntries;
+        } else {
+            ++result.ignoredLines;
+        }
+    }
+
+    const QStringList aggregated = wantedIps.aggregated();
+    result.aggregatedIps = aggregated.size();
+
+    QSet<QString> currentIps;
+    QSet<QString> currentHosts;
+    QSet<QString> ignoredHosts;
+    parseDaemonList(ipListOutput, currentIps, ignoredHosts);
+    parseDaemonList(hostListOutput, ignoredHosts, currentHosts);
+
+    QSet<QString> wanted(aggregated.begin(), aggregated.end());
+    result.addIps = sorted(QSet<QString>(wanted).subtract(currentIps));
+    result.removeIps = sorted(QSet<QString>(currentIps).subtract(wanted));
+    result.addHosts = sorted(QSet<QString>(wantedHosts).subtract(currentHosts));
+    result.removeHosts = sorted(QSet<QString>(currentHosts).subtract(wantedHosts));
+    return result;
+}
+
+QVector<CommandBatch::Command> SplitTunnel::commands(const Plan &plan) {
+    QVector<CommandBatch::Command> cmds;
+    cmds.reserve(plan.addIps.size() + plan.removeIps.size() + plan.addHosts.size() + plan.removeHosts.size());
+    for (const QString &ip : plan.removeIps)
+        cmds.append({QStringLiteral("warp-cli"), {"tunnel", "ip", "remove", ip}});
+    for (const QString &host : plan.removeHosts)
+        cmds.append({QStringLiteral("warp-cli"), {"tunnel", "host", "remove", host}});
+    for (const QString &ip : plan.addIps)
+        cmds.append({QStringLiteral("warp-cli"), {"tunnel", "ip", "add", ip}});
+    for (const QString &host : plan.addHosts)
+        cmds.append({QStringLiteral("warp-cli"), {"tunnel", "host", "add", host}});
+    return cmds;
+}
@@ -0,0 +1,31 @@
+#ifndef SPLITTUNNEL_H
+#define SPLITTUNNEL_H
+
+#include <QStringList>
+#include "commandbatch.h"
+
+// Turns an imported exclusion list into the minimal set of warp-cli tunnel edits.
+namespace SplitTunnel {
+    struct Plan {
+        QStringList addIps;
+        QStringList removeIps;
+        QStringList addHosts;
+        QStringList removeHosts;
+        int importedEntries = 0;
+        int aggregatedIps = 0;
+        int ignoredLines = 0;
+
+        bool isEmpty() const {
+            return addIps.isEmpty() && removeIps.isEmpty() && addHosts.isEmpty() && removeHosts.isEmpty();
+        }
+    };
+
+    // importLines: one CIDR, address or host name per line, '#' starts a comment.
+    // ipListOutput / hostListOutput: raw "warp-cli tunnel ip|host list" output.
+    Plan plan(const QStringList &importLines, const QString &ipListOutput, const QString &hostListOutput);
+
+    // removals first so a replaced range is never briefly duplicated
+    QVector<CommandBatch::Command> commands(const Plan &plan);
+} // namespace SplitTunnel
+
+#endif // SPLITTUNNEL_H
@@ -0,0 +1,49 @@
+#include "statesnapshot.h"
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+static constexpr quint32 kSnapshotMagic = 0x57515331; // "WQS1"
+
+QString StateSnapshot::defaultPath() {
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/state.v1.bin";
+}
+
+StateSnapshot StateSnapshot::load(const QString &path) {
+    StateSnapshot snap;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return snap;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_12);
+    quint32 magic = 0;
+    in >> magic;
+    if (magic != kSnapshotMagic)
+        return snap;
+
+    StateSnapshot read;
+    in >> read.connected >> read.serviceActive >> read.mode >> read.proxyPort >> read.timestampMs;
+    // a torn or foreign file is as good as none
+    if (in.status() != QDataStream::Ok)
+        return snap;
+    return read;
+}
+
+bool StateSnapshot::save(const QString &path) {
+    timestampMs = QDateTime::currentMSecsSinceEpoch();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    // write-and-rename, a crash mid-save keeps the previous snapshot
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_12);
+    out << kSnapshotMagic << connected << serviceActive << mode << proxyPort << timestampMs;
+    return file.commit();
+}
@@ -0,0 +1,25 @@
+#ifndef STATESNAPSHOT_H
+#define STATESNAPSHOT_H
+
+#include <QString>
+
+// Last known tray state, written on every change and read back at startup so the icon,
+// tooltip and popup can be drawn right away (marked stale) while the real state is
+// probed in the background.
+struct StateSnapshot {
+    bool connected = false;
+    bool serviceActive = false;
+    QString mode; // warp-cli name, readable across WarpMode changes
+    quint16 proxyPort = 0;
+    qint64 timestampMs = 0; // wall clock of the last save, 0 if there never was one
+
+    bool isValid() const { return timestampMs > 0; }
+
+    static StateSnapshot load(const QString &path = defaultPath());
+
+    bool save(const QString &path = defaultPath());
+
+    static QString defaultPath();
+};
+
+#endif // STATESNAPSHOT_H
@@ -0,0 +1,402 @@
+#include "statusbroker.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QSocketNotifier>
+#include <QTimer>
+#include <QVector>
+#include <cerrno>
+#include <cstring>
+#include <grp.h>
+#include <pwd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static_assert(sizeof(StatusBroker::Message) == 16, "broker messages are fixed size on the wire");
+
+// same cadence a single tray polls at, only once per host now
+static constexpr int kPollMs = 5000;
+// connected is checked every tick, the full probe (systemctl, warp-cli settings) every n ticks
+static constexpr int kFullProbeTicks = 6;
+static constexpr int kClientRetryMs = 30000;
+
+namespace {
+    bool fillAddress(const QString &path, sockaddr_un &addr) {
+        const QByteArray encoded = QFile::encodeName(path);
+        if (encoded.isEmpty() || encoded.size() >= static_cast<int>(sizeof(addr.sun_path)))
+            return false;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, encoded.constData(), static_cast<size_t>(encoded.size()));
+        return true;
+    }
+
+    // blocking connect, a Unix socket either answers at once or not at all
+    int connectTo(const QString &path, int flags) {
+        sockaddr_un addr;
+        if (!fillAddress(path, addr))
+            return -1;
+        const int fd = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC | flags, 0);
+        if (fd < 0)
+            return -1;
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    bool peerCredentials(int fd, ucred &cred) {
+        socklen_t len = sizeof(cred);
+        return ::getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) == 0 && len == sizeof(cred);
+    }
+} // namespace
+
+StatusBroker::StatusBroker(MainFunctions *mf, QObject *parent)
+    : QObject(parent), mf(mf), listenFd(-1), listenNotifier(nullptr), allowedGid(-1),
+      pollTimer(new QTimer(this)), ticksSinceProbe(0), probing(false), haveState(false), seq(0) {
+    pollTimer->setInterval(kPollMs);
+    connect(pollTimer, &QTimer::timeout, this, &StatusBroker::onTick);
+}
+
+StatusBroker::~StatusBroker() {
+    for (auto it = subscribers.cbegin(); it != subscribers.cend(); ++it) {
+        delete it.value().notifier;
+        ::close(it.key());
+    }
+    delete listenNotifier;
+    if (listenFd >= 0) {
+        ::close(listenFd);
+        ::unlink(QFile::encodeName(path).constData());
+    }
+}
+
+QString StatusBroker::defaultSocketPath() {
+    const QString fromEnv = qEnvironmentVariable("WARPQT_BROKER_SOCKET");
+    return fromEnv.isEmpty() ? QStringLiteral("/run/warp-qt/broker.sock") : fromEnv;
+}
+
+StatusBroker::Message StatusBroker::encode(const MainFunctions::StateProbe &probe, quint32 seq) {
+    Message msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.magic = kMagic;
+    msg.version = kVersion;
+    msg.flags = (probe.serviceActive ? ServiceActive : 0) | (probe.connected ? Connected : 0);
+    msg.mode = static_cast<quint8>(probe.mode);
+    msg.proxyPort = probe.proxyPort;
+    msg.seq = seq;
+    return msg;
+}
+
+bool StatusBroker::decode(const Message &msg, MainFunctions::StateProbe &probe) {
+    if (msg.magic != kMagic || msg.version != kVersion)
+        return false;
+    probe.serviceActive = msg.flags & ServiceActive;
+    probe.connected = msg.flags & Connected;
+    probe.mode = WarpModes::fromCode(msg.mode);
+    probe.proxyPort = msg.proxyPort;
+    return true;
+}
+
+bool StatusBroker::listen(const QString &socketPath, const QString &allowedGroup) {
+    if (listenFd >= 0)
+        return true;
+    if (!allowedGroup.isEmpty()) {
+        const group *gr = ::getgrnam(allowedGroup.toLocal8Bit().constData());
+        if (!gr) {
+            qWarning() << "status broker: no such group" << allowedGroup;
+            return false;
+        }
+        allowedGid = gr->gr_gid;
+    }
+
+    sockaddr_un addr;
+    if (!fillAddress(socketPath, addr)) {
+        qWarning() << "status broker: socket path too long:" << socketPath;
+        return false;
+    }
+    QDir().mkpath(QFileInfo(socketPath).absolutePath());
+
+    // a live broker answers, a file left behind by a crashed one does not
+    const int other = connectTo(socketPath, 0);
+    if (other >= 0) {
+        ::close(other);
+        qWarning() << "status broker: another broker is already listening on" << socketPath;
+        return false;
+    }
+    struct stat st;
+    if (::lstat(addr.sun_path, &st) == 0 && S_ISSOCK(st.st_mode))
+        ::unlink(addr.sun_path);
+
+    const int fd = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return false;
+    if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0
+        // anyone may connect, who gets served is decided on the peer credentials
+        || ::chmod(addr.sun_path, 0666) != 0
+        || ::listen(fd, 64) != 0) {
+        qWarning() << "status broker: cannot listen on" << socketPath << ":" << std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+
+    path = socketPath;
+    listenFd = fd;
+    listenNotifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(listenNotifier, &QSocketNotifier::activated, this, &StatusBroker::onAcceptable);
+    return true;
+}
+
+int StatusBroker::subscriberCount() const {
+    return subscribers.size();
+}
+
+void StatusBroker::onAcceptable() {
+    for (;;) {
+        const int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        ucred cred;
+        if (!peerCredentials(fd, cred)) {
+            ::close(fd);
+            continue;
+        }
+        if (!peerAllowed(cred.uid, cred.gid)) {
+            qDebug() << "status broker: refused uid" << cred.uid;
+            ::close(fd);
+            continue;
+        }
+        // nobody was subscribed, whatever we knew is old
+        if (subscribers.isEmpty())
+            haveState = false;
+
+        Subscriber sub;
+        sub.notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+        sub.uid = cred.uid;
+        sub.wantsState = !haveState;
+        connect(sub.notifier, &QSocketNotifier::activated, this, [this, fd]() { onReadable(fd); });
+        subscribers.insert(fd, sub);
+        qDebug() << "status broker: uid" << cred.uid << "subscribed," << subscribers.size() << "in total";
+
+        if (haveState && !send(fd)) {
+            dropSubscriber(fd);
+            continue;
+        }
+        if (subscribers.size() == 1) {
+            probe();
+            pollTimer->start();
+        }
+        emit subscribersChanged(subscribers.size());
+    }
+}
+
+void StatusBroker::onReadable(int fd) {
+    char buf[64];
+    bool refresh = false;
+    for (;;) {
+        const ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && errno == EAGAIN)
+            break;
+        if (n <= 0) {
+            dropSubscriber(fd);
+            return;
+        }
+        if (std::memchr(buf, kRequestRefresh, static_cast<size_t>(n)))
+            refresh = true;
+    }
+    if (refresh) {
+        subscribers[fd].wantsState = true;
+        probe();
+    }
+}
+
+void StatusBroker::dropSubscriber(int fd) {
+    auto it = subscribers.find(fd);
+    if (it == subscribers.end())
+        return;
+    // may be called from the notifier's own signal
+    it->notifier->setEnabled(false);
+    it->notifier->deleteLater();
+    subscribers.erase(it);
+    ::close(fd);
+    if (subscribers.isEmpty())
+        pollTimer->stop();
+    emit subscribersChanged(subscribers.size());
+}
+
+bool StatusBroker::peerAllowed(quint32 uid, quint32 gid) const {
+    if (allowedGid < 0 || uid == 0 || gid == allowedGid)
+        return true;
+    const passwd *pw = ::getpwuid(uid);
+    if (!pw)
+        return false;
+    int count = 32;
+    QVector<gid_t> groups(count);
+    if (::getgrouplist(pw->pw_name, gid, groups.data(), &count) < 0) {
+        // count now holds what is needed
+        groups.resize(count);
+        if (::getgrouplist(pw->pw_name, gid, groups.data(), &count) < 0)
+            return false;
+    }
+    for (int i = 0; i < count; ++i) {
+        if (groups.at(i) == static_cast<gid_t>(allowedGid))
+            return true;
+    }
+    return false;
+}
+
+void StatusBroker::onTick() {
+    // nothing cheap to check while the daemon is down, and the mode may change behind our back
+    if (!haveState || !state.serviceActive || ++ticksSinceProbe >= kFullProbeTicks) {
+        probe();
+        return;
+    }
+    MainFunctions::StateProbe next = state;
+    next.connected = mf->isWarpConnected();
+    publish(next);
+}
+
+void StatusBroker::probe() {
+    // a refresh asked for during a probe is answered by it
+    if (probing)
+        return;
+    probing = true;
+    ticksSinceProbe = 0;
+    auto watcher = new QFutureWatcher<MainFunctions::StateProbe>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher]() {
+        watcher->deleteLater();
+        probing = false;
+        const MainFunctions::StateProbe result = watcher->result();
+        mf->applyStateProbe(result);
+        publish(result);
+    });
+    watcher->setFuture(mf->probeStateAsync());
+}
+
+void StatusBroker::publish(const MainFunctions::StateProbe &next) {
+    const bool changed = !haveState || next.serviceActive != state.serviceActive || next.mode != state.mode
+                         || next.proxyPort != state.proxyPort || next.connected != state.connected;
+    if (changed) {
+        state = next;
+        haveState = true;
+        ++seq;
+    }
+
+    QVector<int> failed;
+    for (auto it = subscribers.begin(); it != subscribers.end(); ++it) {
+        if (!changed && !it->wantsState)
+            continue;
+        it->wantsState = false;
+        if (!send(it.key()))
+            failed.append(it.key());
+    }
+    for (int fd : failed)
+        dropSubscriber(fd);
+}
+
+bool StatusBroker::send(int fd) {
+    const Message msg = encode(state, seq);
+    // a subscriber that lets 200 kB of 16 byte messages pile up is gone, not slow
+    const ssize_t n = ::send(fd, &msg, sizeof(msg), MSG_NOSIGNAL | MSG_DONTWAIT);
+    return n == static_cast<ssize_t>(sizeof(msg));
+}
+
+BrokerClient::BrokerClient(const QString &path, QObject *parent)
+    : QObject(parent), path(path), fd(-1), notifier(nullptr), retryTimer(new QTimer(this)) {
+    retryTimer->setInterval(kClientRetryMs);
+    connect(retryTimer, &QTimer::timeout, this, [this]() {
+        if (tryConnect())
+            retryTimer->stop();
+    });
+}
+
+BrokerClient::~BrokerClient() {
+    delete notifier;
+    if (fd >= 0)
+        ::close(fd);
+}
+
+bool BrokerClient::isConnected() const {
+    return fd >= 0;
+}
+
+void BrokerClient::start() {
+    if (isConnected())
+        return;
+    if (!tryConnect())
+        retryTimer->start();
+}
+
+void BrokerClient::requestRefresh() {
+    if (fd < 0)
+        return;
+    const char request = StatusBroker::kRequestRefresh;
+    if (::send(fd, &request, 1, MSG_NOSIGNAL | MSG_DONTWAIT) != 1 && errno != EAGAIN)
+        disconnectFromBroker();
+}
+
+bool BrokerClient::tryConnect() {
+    // no broker on this host, the common case
+    if (!QFileInfo::exists(path))
+        return false;
+    const int sock = connectTo(path, SOCK_NONBLOCK);
+    if (sock < 0)
+        return false;
+
+    // anyone could have put a socket there, only root or ourselves get to tell us the state
+    ucred cred;
+    if (!peerCredentials(sock, cred) || (cred.uid != 0 && cred.uid != ::getuid())) {
+        qWarning() << "status broker: ignoring" << path << ", it is not run by root or this user";
+        ::close(sock);
+        return false;
+    }
+
+    fd = sock;
+    notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(notifier, &QSocketNotifier::activated, this, &BrokerClient::onReadable);
+    qDebug() << "status broker: subscribed via" << path;
+    emit connectedChanged(true);
+    return true;
+}
+
+void BrokerClient::onReadable() {
+    for (;;) {
+        StatusBroker::Message msg;
+        const ssize_t n = ::recv(fd, &msg, sizeof(msg), 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && errno == EAGAIN)
+            return;
+        if (n <= 0) {
+            disconnectFromBroker();
+            return;
+        }
+        MainFunctions::StateProbe probe;
+        // a newer broker's message, skipped rather than misread
+        if (n == static_cast<ssize_t>(sizeof(msg)) && StatusBroker::decode(msg, probe))
+            emit stateReceived(probe);
+    }
+}
+
+void BrokerClient::disconnectFromBroker() {
+    if (fd < 0)
+        return;
+    // may be called from the notifier's own signal
+    notifier->setEnabled(false);
+    notifier->deleteLater();
+    notifier = nullptr;
+    ::close(fd);
+    fd = -1;
+    qDebug() << "status broker: lost the broker, probing locally";
+    emit connectedChanged(false);
+    retryTimer->start();
+}
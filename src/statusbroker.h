@@ -0,0 +1,136 @@
+#ifndef STATUSBROKER_H
+#define STATUSBROKER_H
+
+#include <QHash>
+#include <QObject>
+#include "mainfunctions.h"
+
+class QSocketNotifier;
+class QTimer;
+
+// Host-wide status broker for multi-user machines. The daemon state (service, mode, connected)
+// is the same for every session, so one process probes it and pushes changes over a Unix
+// socket; the per-user instances subscribe instead of running their own probes. Probing only
+// runs while someone is subscribed.
+//
+// Wire format: SOCK_SEQPACKET, one fixed size StatusBroker::Message per state, clients send a
+// single kRequestRefresh byte to get a fresh probe (after resume, around a toggle).
+class StatusBroker : public QObject {
+    Q_OBJECT
+
+public:
+    struct Message {
+        quint32 magic;
+        quint8 version;
+        quint8 flags;
+        quint8 mode; // WarpMode
+        quint8 reserved;
+        quint16 proxyPort;
+        quint16 reserved2;
+        quint32 seq;
+    };
+
+    enum MessageFlags : quint8 {
+        ServiceActive = 0x01,
+        Connected = 0x02
+    };
+
+    static constexpr quint32 kMagic = 0x57514231; // "WQB1"
+    static constexpr quint8 kVersion = 1;
+    static constexpr char kRequestRefresh = 'R';
+
+    explicit StatusBroker(MainFunctions *mf, QObject *parent = nullptr);
+
+    ~StatusBroker() override;
+
+    // fails if another broker is answering on path; an empty group lets every local user subscribe
+    bool listen(const QString &path, const QString &allowedGroup = QString());
+
+    int subscriberCount() const;
+
+    // $WARPQT_BROKER_SOCKET, /run/warp-qt/broker.sock otherwise
+    static QString defaultSocketPath();
+
+    static Message encode(const MainFunctions::StateProbe &probe, quint32 seq);
+
+    static bool decode(const Message &msg, MainFunctions::StateProbe &probe);
+
+signals:
+    void subscribersChanged(int count);
+
+private:
+    struct Subscriber {
+        QSocketNotifier *notifier;
+        quint32 uid;
+        // asked for a refresh, gets the next probe even if nothing changed
+        bool wantsState;
+    };
+
+    void onAcceptable();
+
+    void onReadable(int fd);
+
+    void dropSubscriber(int fd);
+
+    bool peerAllowed(quint32 uid, quint32 gid) const;
+
+    void onTick();
+
+    void probe();
+
+    void publish(const MainFunctions::StateProbe &probe);
+
+    bool send(int fd);
+
+    MainFunctions *mf;
+    QString path;
+    int listenFd;
+    QSocketNotifier *listenNotifier;
+    qint64 allowedGid; // -1 for everyone
+
+    QHash<int, Subscriber> subscribers;
+
+    QTimer *pollTimer;
+    int ticksSinceProbe;
+    bool probing;
+    bool haveState;
+    MainFunctions::StateProbe state;
+    quint32 seq;
+};
+
+// The subscriber side, used by StatusTracker. Connects when a broker is listening, retries in the
+// background when none is, and only trusts a broker running as root or as the same user.
+class BrokerClient : public QObject {
+    Q_OBJECT
+
+public:
+    explicit BrokerClient(const QString &path = StatusBroker::defaultSocketPath(), QObject *parent = nullptr);
+
+    ~BrokerClient() override;
+
+    bool isConnected() const;
+
+    // tries right away, then every so often while not connected
+    void start();
+
+    void requestRefresh();
+
+signals:
+    void stateReceived(const MainFunctions::StateProbe &probe);
+
+    void connectedChanged(bool connected);
+
+private:
+    bool tryConnect();
+
+    void onReadable();
+
+    void disconnectFromBroker();
+
+    QString path;
+    int fd;
+    QSocketNotifier *notifier;
+    QTimer *retryTimer;
+};
+
+#endif // STATUSBROKER_H
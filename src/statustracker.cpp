@@ -0,0 +1,321 @@
+#include "statustracker.h"
+#include "sessionmonitor.h"
+#include "settingsstore.h"
+#include "statusbroker.h"
+#include "tunnelwatchdog.h"
+#include <QCoreApplication>
+#include <QFutureWatcher>
+#include <QTimer>
+
+static const int kPollDelays[] = {500, 1000, 2000, 3000, 4000, 5000};
+static constexpr int kPollDelaysCount = sizeof(kPollDelays) / sizeof(kPollDelays[0]);
+// a request older than this is not the reason for a state change anymore
+static constexpr qint64 kCauseExpiryMs = 120000;
+static constexpr int kStatusPollMs = 5000;
+// WARP renegotiates for a few seconds after resume, poll faster until it settles
+static constexpr int kFastPollMs = 1000;
+static constexpr int kFastPollCount = 10;
+
+StatusTracker::StatusTracker(MainFunctions *mf, QObject *parent)
+    : QObject(parent), mf(mf), pollTimer(new QTimer(this)), lastKnownState(false),
+      snapshot(StateSnapshot::load()), stale(true), revalidating(false), firstProbeDone(false),
+      session(new SessionMonitor(QDBusConnection::systemBus(), this)), paused(false), fastProbesLeft(0),
+      watchdog(new TunnelWatchdog(QStringLiteral("CloudflareWARP"), this)),
+      broker(new BrokerClient(StatusBroker::defaultSocketPath(), this)),
+      pendingCause(HistoryLog::Cause::Unknown), historyOpen(false), togglePollTimer(new QTimer(this)), toggling(false),
+      toggleExpectedState(false), togglePollAttempt(0) {
+    // render the last known state right away, revalidate() confirms it off the GUI thread
+    if (snapshot.isValid()) {
+        lastKnownState = snapshot.connected;
+        mf->seedMode(WarpModes::fromCliName(snapshot.mode), snapshot.proxyPort);
+    }
+    stateClock.start();
+
+    connect(this->mf, &MainFunctions::errorOccurred, this, [this]() {
+        // back off polling after error
+        if (!paused && !broker->isConnected())
+            pollTimer->start(10000);
+    });
+    connect(this->mf, &MainFunctions::connectRetryScheduled, this, [this]() {
+        requestCause(HistoryLog::Cause::Retry);
+    });
+    connect(this->mf, &MainFunctions::connectRetryStopped, this, [this](bool recovered) {
+        if (recovered)
+            checkStatus();
+    });
+    connect(this->mf, &MainFunctions::connectFailed, this, [this](MainFunctions::FailureKind) {
+        const auto current = lastKnownState ? HistoryLog::State::Connected : HistoryLog::State::Disconnected;
+        log.append(current, HistoryLog::State::Failed, this->mf->currentMode(), HistoryLog::Cause::Error, 0);
+    });
+
+    connect(watchdog, &TunnelWatchdog::stallDetected, this, &StatusTracker::onTunnelStalled);
+    connect(this, &StatusTracker::connectionChanged, watchdog, [this](bool connected) {
+        if (connected && !paused)
+            watchdog->start();
+        else
+            watchdog->stop();
+    });
+    connect(session, &SessionMonitor::pausedChanged, this, &StatusTracker::onSessionPaused);
+    connect(broker, &BrokerClient::stateReceived, this, &StatusTracker::applyProbe);
+    connect(broker, &BrokerClient::connectedChanged, this, &StatusTracker::onBrokerConnected);
+
+    connect(pollTimer, &QTimer::timeout, this, &StatusTracker::checkStatus);
+    // started once the first probe is back
+
+    togglePollTimer->setSingleShot(true);
+    connect(togglePollTimer, &QTimer::timeout, this, &StatusTracker::pollToggleState);
+    // without it the history can't tell a quit from a session that stayed connected
+    if (QCoreApplication::instance())
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, &StatusTracker::closeHistory);
+
+    // a broker sends the current state as soon as we subscribe, no probe of our own needed
+    broker->start();
+    if (!broker->isConnected())
+        revalidate();
+}
+
+StatusTracker::~StatusTracker() {
+    closeHistory();
+}
+
+bool StatusTracker::isConnected() const {
+    return lastKnownState;
+}
+
+bool StatusTracker::isStale() const {
+    return stale;
+}
+
+bool StatusTracker::isToggling() const {
+    return toggling;
+}
+
+bool StatusTracker::isPaused() const {
+    return paused;
+}
+
+bool StatusTracker::isSubscribed() const {
+    return broker->isConnected();
+}
+
+const HistoryLog &StatusTracker::history() const {
+    return log;
+}
+
+void StatusTracker::revalidate() {
+    if (broker->isConnected()) {
+        broker->requestRefresh();
+        return;
+    }
+    // resume and unlock can both ask for one, a probe already in flight answers both
+    if (revalidating)
+        return;
+    revalidating = true;
+    auto watcher = new QFutureWatcher<MainFunctions::StateProbe>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher]() {
+        watcher->deleteLater();
+        revalidating = false;
+        applyProbe(watcher->result());
+    });
+    watcher->setFuture(mf->probeStateAsync());
+}
+
+void StatusTracker::applyProbe(const MainFunctions::StateProbe &probe) {
+    mf->applyStateProbe(probe);
+    snapshot.serviceActive = probe.serviceActive;
+    // went to sleep while probing, the resume asks again
+    if (paused)
+        return;
+    setStale(false);
+
+    if (!historyOpen) {
+        // the snapshot may be days old, start the history from what is there now
+        const auto found = probe.connected ? HistoryLog::State::Connected : HistoryLog::State::Disconnected;
+        log.append(HistoryLog::State::Stopped, found, mf->currentMode(), HistoryLog::Cause::External, 0);
+        historyOpen = true;
+        stateClock.restart();
+        if (!toggling && probe.connected != lastKnownState) {
+            lastKnownState = probe.connected;
+            saveSnapshot();
+        }
+    }
+
+    // a toggle started in the meantime has its own polling, dont fight it
+    if (!toggling) {
+        if (probe.connected != lastKnownState)
+            setKnownState(probe.connected, HistoryLog::Cause::External);
+        else
+            saveSnapshot();
+        // first confirmed state, the watchdog and front ends start from here
+        emit connectionChanged(probe.connected);
+
+        // only at startup, not after every resume the user spent disconnected
+        if (!firstProbeDone && !probe.connected && probe.serviceActive
+            && SettingsStore::instance().flag(SettingsStore::Key::AutoConnect))
+            toggle(HistoryLog::Cause::AutoConnect);
+    }
+    firstProbeDone = true;
+    if (!pollTimer->isActive() && !toggling)
+        startPolling();
+}
+
+void StatusTracker::onBrokerConnected(bool subscribed) {
+    if (subscribed) {
+        // the broker probes for every session on the host from here on
+        pollTimer->stop();
+        return;
+    }
+    // what it told us last may be old by now, back to probing ourselves
+    revalidate();
+}
+
+void StatusTracker::startPolling() {
+    if (paused || broker->isConnected())
+        return;
+    pollTimer->start(fastProbesLeft > 0 ? kFastPollMs : kStatusPollMs);
+}
+
+void StatusTracker::setStale(bool staleNow) {
+    if (stale == staleNow)
+        return;
+    stale = staleNow;
+    emit staleChanged(stale);
+}
+
+void StatusTracker::onSessionPaused(bool pausedNow) {
+    paused = pausedNow;
+    mf->setRetryPaused(paused);
+    emit pausedChanged(paused);
+    if (paused) {
+        pollTimer->stop();
+        watchdog->stop();
+        fastProbesLeft = 0;
+        // a toggle in flight is settled by the probe after resume
+        if (toggling) {
+            togglePollTimer->stop();
+            toggling = false;
+            emit toggleFinished(lastKnownState);
+        }
+        return;
+    }
+
+    // whatever we showed before sleeping is a guess now
+    setStale(true);
+    fastProbesLeft = kFastPollCount;
+    revalidate();
+}
+
+void StatusTracker::saveSnapshot() {
+    snapshot.connected = lastKnownState;
+    snapshot.mode = WarpModes::cliName(mf->currentMode());
+    snapshot.proxyPort = mf->proxyPort();
+    snapshot.save();
+}
+
+void StatusTracker::checkStatus() {
+    if (broker->isConnected()) {
+        broker->requestRefresh();
+        return;
+    }
+    if (fastProbesLeft > 0 && --fastProbesLeft == 0)
+        pollTimer->setInterval(kStatusPollMs);
+
+    bool actualState = mf->isWarpConnected();
+
+    if (actualState != lastKnownState) {
+        setKnownState(actualState, HistoryLog::Cause::External);
+        emit connectionChanged(actualState);
+    }
+}
+
+void StatusTracker::pollToggleState() {
+    bool reality = mf->isWarpConnected();
+
+    if (reality == toggleExpectedState || togglePollAttempt >= kPollDelaysCount) {
+        toggling = false;
+        if (reality != lastKnownState) {
+            setKnownState(reality, HistoryLog::Cause::User);
+            emit connectionChanged(reality);
+        }
+        emit toggleFinished(reality);
+        startPolling();
+        return;
+    }
+
+    int delay = kPollDelays[togglePollAttempt++];
+    togglePollTimer->start(delay);
+}
+
+void StatusTracker::toggle(HistoryLog::Cause cause) {
+    if (toggling)
+        return;
+    toggling = true;
+    pollTimer->stop();
+    requestCause(cause);
+
+    const bool connecting = !lastKnownState;
+    emit toggleStarted(connecting);
+
+    auto watcher = new QFutureWatcher<MainFunctions::CommandResult>(this);
+    if (connecting) {
+        watcher->setFuture(mf->cliConnectAsync());
+    } else {
+        mf->cancelConnectRetry();
+        watcher->setFuture(mf->cliDisconnectAsync());
+    }
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, connecting]() {
+        watcher->deleteLater();
+        if (connecting)
+            mf->handleConnectResult(watcher->result());
+        // suspended while warp-cli was running, the resume probe settles it
+        if (!toggling)
+            return;
+        toggleExpectedState = connecting;
+        togglePollAttempt = 0;
+        const int initialDelay = toggleExpectedState ? 2000 : 800;
+        togglePollTimer->start(initialDelay);
+    });
+}
+
+void StatusTracker::onTunnelStalled(int stalledForMs) {
+    const bool reconnect = SettingsStore::instance().flag(SettingsStore::Key::StallReconnect);
+    emit tunnelStalled(stalledForMs, reconnect);
+    if (reconnect) {
+        requestCause(HistoryLog::Cause::Stall);
+        mf->reconnect();
+    }
+}
+
+void StatusTracker::requestCause(HistoryLog::Cause cause) {
+    // the next observed transition is attributed to this request, timed from the first one
+    if (pendingCause == cause && connectRequestClock.isValid()
+        && connectRequestClock.elapsed() < kCauseExpiryMs)
+        return;
+    pendingCause = cause;
+    connectRequestClock.start();
+}
+
+void StatusTracker::closeHistory() {
+    if (!historyOpen)
+        return;
+    historyOpen = false;
+    log.append(lastKnownState ? HistoryLog::State::Connected : HistoryLog::State::Disconnected,
+               HistoryLog::State::Stopped, mf->currentMode(), HistoryLog::Cause::Unknown, stateClock.elapsed());
+}
+
+void StatusTracker::setKnownState(bool connected, HistoryLog::Cause cause) {
+    const bool requested = pendingCause != HistoryLog::Cause::Unknown
+                           && connectRequestClock.elapsed() < kCauseExpiryMs;
+    if (requested)
+        cause = pendingCause;
+    const qint64 latency = requested && connected ? connectRequestClock.elapsed() : 0;
+    // a stall reconnect goes down first, keep the cause for the way back up
+    if (connected || cause != HistoryLog::Cause::Stall)
+        pendingCause = HistoryLog::Cause::Unknown;
+
+    log.append(lastKnownState ? HistoryLog::State::Connected : HistoryLog::State::Disconnected,
+               connected ? HistoryLog::State::Connected : HistoryLog::State::Disconnected,
+               mf->currentMode(), cause, stateClock.restart(), latency);
+    lastKnownState = connected;
+    saveSnapshot();
+}
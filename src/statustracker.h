@@ -0,0 +1,129 @@
+#ifndef STATUSTRACKER_H
+#define STATUSTRACKER_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include "mainfunctions.h"
+#include "historylog.h"
+#include "statesnapshot.h"
+
+class BrokerClient;
+class QTimer;
+class SessionMonitor;
+class TunnelWatchdog;
+
+// Owns the connection state: warm start from the snapshot, the startup probe, status polling,
+// toggle confirmation, history, stall reconnects and suspend/lock pauses. Front ends (the tray,
+// the headless daemon) only render what it reports. When a host-wide status broker is running
+// it subscribes to that instead of polling on its own. QtCore only.
+class StatusTracker : public QObject {
+    Q_OBJECT
+
+public:
+    explicit StatusTracker(MainFunctions *mf, QObject *parent = nullptr);
+
+    ~StatusTracker() override;
+
+    bool isConnected() const;
+
+    // still showing the snapshot of the last run (or of before a suspend)
+    bool isStale() const;
+
+    bool isToggling() const;
+
+    bool isPaused() const;
+
+    // getting the state pushed by the status broker instead of probing
+    bool isSubscribed() const;
+
+    const HistoryLog &history() const;
+
+public
+    slots:
+
+    
+
+    void toggle(HistoryLog::Cause cause = HistoryLog::Cause::User);
+
+    // the next observed transition is attributed to this cause
+    void requestCause(HistoryLog::Cause cause);
+
+    void checkStatus();
+
+    void revalidate();
+
+    signals:
+
+    
+
+    // on every change, and once for each confirmed probe even if nothing changed
+    void connectionChanged(bool connected);
+
+    void staleChanged(bool stale);
+
+    void toggleStarted(bool connecting);
+
+    void toggleFinished(bool connected);
+
+    void tunnelStalled(int stalledForMs, bool reconnecting);
+
+    // the session went to sleep or was locked, everything that polls should hold off
+    void pausedChanged(bool paused);
+
+private:
+    MainFunctions *mf;
+    QTimer *pollTimer;
+    bool lastKnownState;
+
+    // state restored from the last run, shown until the first probe comes back
+    StateSnapshot snapshot;
+    bool stale;
+    bool revalidating;
+    bool firstProbeDone;
+
+    // no probing while suspended or locked, a short burst of fast polls after resume
+    SessionMonitor *session;
+    bool paused;
+    int fastProbesLeft;
+
+    TunnelWatchdog *watchdog;
+
+    BrokerClient *broker;
+
+    // connection history
+    HistoryLog log;
+    QElapsedTimer stateClock;
+    QElapsedTimer connectRequestClock;
+    HistoryLog::Cause pendingCause;
+    // a startup record was written and the matching Stopped is still due
+    bool historyOpen;
+
+    // Toggle polling state
+    QTimer *togglePollTimer;
+    bool toggling;
+    bool toggleExpectedState;
+    int togglePollAttempt;
+
+    void pollToggleState();
+
+    void applyProbe(const MainFunctions::StateProbe &probe);
+
+    void onBrokerConnected(bool subscribed);
+
+    void startPolling();
+
+    void setStale(bool stale);
+
+    void onSessionPaused(bool paused);
+
+    void onTunnelStalled(int stalledForMs);
+
+    void setKnownState(bool connected, HistoryLog::Cause cause);
+
+    // appends the Stopped record on quit
+    void closeHistory();
+
+    void saveSnapshot();
+};
+
+#endif // STATUSTRACKER_H
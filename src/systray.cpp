@@ -1,96 +1,171 @@
 #include "systray.h"
+#include "memoryusage.h"
+#include "settingsstore.h"
 #include <QApplication>
 #include <QMenu>
 #include <QFutureWatcher>
-
-static const int kPollDelays[] = {500, 1000, 2000, 3000, 4000, 5000};
-static constexpr int kPollDelaysCount = sizeof(kPollDelays) / sizeof(kPollDelays[0]);
+#include <QDateTime>
+#include <QPixmapCache>
+#include <QtConcurrent>
 
 SysTray::SysTray(MainFunctions *mf, QObject *parent)
-    : QObject(parent), trayIcon(nullptr), popupWidget(nullptr), mf(mf), toggleAction(nullptr), lastKnownState(false),
-      togglePollTimer(new QTimer(this)), toggleExpectedState(false), togglePollAttempt(0) {
+    : QObject(parent), trayIcon(nullptr), popupWidget(nullptr), mf(mf), tracker(new StatusTracker(mf, this)),
+      guard(new FlapGuard(tracker->isConnected(), this)), toggleAction(nullptr),
+      displayedState(tracker->isConnected()), details(new TrayDetails(mf, this)), trayMenu(nullptr),
+      modeAction(nullptr), accountAction(nullptr), addressAction(nullptr), uptimeAction(nullptr),
+      throughput(new ThroughputMonitor(QStringLiteral("CloudflareWARP"), this)), releaseTimer(new QTimer(this)),
+      officialTray(new OfficialTrayMonitor(this)), offerSuppress(false), daemonMonitor(new DaemonMonitor(this)) {
     iconConnected = QIcon(":/icons/connected.png");
     iconDisconnected = QIcon(":/icons/disconnected.png");
 
     connect(this->mf, &MainFunctions::infoOccurred, this, &SysTray::showInfoNotification);
-    connect(this->mf, &MainFunctions::errorOccurred, this, &SysTray::handleErrorBackoff);
+    connect(this->mf, &MainFunctions::errorOccurred, guard, &FlapGuard::reportError);
+    connect(this->mf, &MainFunctions::connectRetryScheduled, this, &SysTray::onRetryScheduled);
+    connect(this->mf, &MainFunctions::connectRetryStopped, this, &SysTray::onRetryStopped);
 
-    pollTimer = new QTimer(this);
-    connect(pollTimer, &QTimer::timeout, this, &SysTray::checkStatus);
-    pollTimer->start(5000);
+    connect(tracker, &StatusTracker::connectionChanged, guard, &FlapGuard::reportState);
+    connect(guard, &FlapGuard::stateChanged, this, [this](bool connected) {
+        emit connectionChanged(connected);
+        updateStatus(connected);
+    });
+    connect(guard, &FlapGuard::flappingChanged, this, &SysTray::refreshToolTip);
+    connect(guard, &FlapGuard::notify, this,
+            [this](FlapGuard::Severity severity, const QString &title, const QString &message) {
+                if (severity == FlapGuard::Severity::Error)
+                    showErrorNotification(title, message);
+                else
+                    showInfoNotification(title, message);
+            });
+    connect(tracker, &StatusTracker::staleChanged, this, [this](bool stale) {
+        if (popupWidget)
+            popupWidget->setStateStale(stale);
+        refreshToolTip();
+    });
+    connect(tracker, &StatusTracker::toggleStarted, this, &SysTray::onToggleStarted);
+    connect(tracker, &StatusTracker::toggleFinished, this, &SysTray::onToggleFinished);
+    connect(tracker, &StatusTracker::tunnelStalled, this, &SysTray::onTunnelStalled);
 
-    togglePollTimer->setSingleShot(true);
-    connect(togglePollTimer, &QTimer::timeout, this, &SysTray::pollToggleState);
-}
+    connect(throughput, &ThroughputMonitor::sampleAdded, this, &SysTray::refreshToolTip);
 
-void SysTray::checkStatus() {
-    bool actualState = mf->isWarpConnected();
+    releaseTimer->setSingleShot(true);
+    releaseTimer->setTimerType(Qt::VeryCoarseTimer);
+    connect(releaseTimer, &QTimer::timeout, this, &SysTray::releasePopup);
 
-    if (actualState != lastKnownState) {
-        lastKnownState = actualState;
-        emit connectionChanged(actualState);
-        updateStatus(actualState);
-    }
+    connect(officialTray, &OfficialTrayMonitor::conflictDetected, this, &SysTray::onOfficialTrayDetected);
+
+    connect(details, &TrayDetails::updated, this, [this]() {
+        if (trayMenu && trayMenu->isVisible())
+            refreshMenuDetails();
+    });
+
+    connect(tracker, &StatusTracker::pausedChanged, throughput, &ThroughputMonitor::setPaused);
+    connect(tracker, &StatusTracker::pausedChanged, daemonMonitor, &DaemonMonitor::setPaused);
+    connect(daemonMonitor, &DaemonMonitor::thresholdExceeded, this->mf, &MainFunctions::infoOccurred);
+    daemonMonitor->start();
 }
 
 Widget *SysTray::ensureWidget() {
     if (!popupWidget) {
         popupWidget = new Widget(mf, nullptr);
-        connect(popupWidget, &Widget::connectionChanged, this, &SysTray::updateStatus);
+        popupWidget->setThroughputMonitor(throughput);
+        popupWidget->setHistoryLog(&tracker->history());
+        popupWidget->setDaemonMonitor(daemonMonitor);
+        popupWidget->setStateStale(tracker->isStale());
+        popupWidget->onConnectionChanged(guard->displayedState());
+        connect(popupWidget, &Widget::toggleRequested, this, [this]() {
+            tracker->requestCause(HistoryLog::Cause::User);
+        });
+        // confirmed after a toggle from the popup, shown without hysteresis
+        connect(popupWidget, &Widget::connectionChanged, guard, &FlapGuard::commitState);
+        connect(popupWidget, &Widget::visibilityChanged, this, &SysTray::onPopupVisibilityChanged);
         connect(this, &SysTray::connectionChanged, popupWidget, &Widget::onConnectionChanged);
     }
     return popupWidget;
 }
 
-void SysTray::pollToggleState() {
-    bool reality = mf->isWarpConnected();
+void SysTray::onPopupVisibilityChanged(bool visible) {
+    if (visible) {
+        releaseTimer->stop();
+        return;
+    }
+    const SettingsStore &settings = SettingsStore::instance();
+    if (!settings.flag(SettingsStore::Key::LowMemoryMode))
+        return;
+    releaseTimer->start(qMax(5, settings.number(SettingsStore::Key::LowMemoryIdleSec)) * 1000);
+}
 
-    if (reality == toggleExpectedState || togglePollAttempt >= kPollDelaysCount) {
-        if (reality != lastKnownState) {
-            lastKnownState = reality;
-            emit connectionChanged(reality);
-        }
-        updateStatus(reality);
-        toggleAction->setEnabled(true);
-        if (pollTimer)
-            pollTimer->start(5000);
+void SysTray::releasePopup() {
+    if (!popupWidget || popupWidget->isVisible())
+        return;
+    // the settings dialog runs a nested event loop with the popup as parent, try again later
+    if (QApplication::activeModalWidget()) {
+        releaseTimer->start();
+        return;
+    }
+
+    const qint64 rssBefore = MemoryUsage::residentBytes();
+    Widget *w = popupWidget;
+    // trim once the widget tree and its style/font data are really gone
+    connect(w, &QObject::destroyed, this, [rssBefore]() {
+        QPixmapCache::clear();
+        const MemoryUsage::Release r = MemoryUsage::recordRelease(rssBefore);
+        qDebug() << "low-memory mode: released popup, RSS" << r.rssBeforeBytes / 1024 << "KiB ->"
+                 << r.rssAfterBytes / 1024 << "KiB";
+    });
+    w->deleteLater();
+}
+
+void SysTray::onOfficialTrayDetected() {
+    if (SettingsStore::instance().flag(SettingsStore::Key::AutoSuppressOfficialTray)) {
+        suppressOfficialTray();
         return;
     }
+    showInfoNotification("Official WARP Tray Running",
+                         "Cloudflare's own tray is running next to this one. Click to disable it, "
+                         "or let Preferences keep it disabled.");
+    offerSuppress = true;
+}
 
-    int delay = kPollDelays[togglePollAttempt++];
-    togglePollTimer->start(delay);
+void SysTray::suppressOfficialTray() {
+    offerSuppress = false;
+    auto watcher = new QFutureWatcher<OfficialTray::SuppressResult>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher]() {
+        const OfficialTray::SuppressResult r = watcher->result();
+        watcher->deleteLater();
+        if (r.unitHandled && r.overrideWritten)
+            showInfoNotification("Official WARP Tray Disabled",
+                                 "It was stopped and will stay off for this user.");
+        else
+            showErrorNotification("Official WARP Tray",
+                                  "Could not disable it, try Preferences > Troubleshooting.");
+    });
+    MainFunctions *mainFunctions = mf;
+    const QVector<qint64> pids = officialTray->pids();
+    watcher->setFuture(QtConcurrent::run([mainFunctions, pids]() {
+        return OfficialTray::suppress(mainFunctions, pids);
+    }));
 }
 
 void SysTray::startToggle() {
+    tracker->toggle(HistoryLog::Cause::User);
+}
+
+void SysTray::onToggleStarted(bool connecting) {
     toggleAction->setEnabled(false);
-    if (pollTimer &&pollTimer
-    ->
-    isActive()
-    )
-    {
-        pollTimer->stop();
-    }
-    if (lastKnownState) {
-        toggleAction->setText("Disconnecting...");
-        trayIcon->setToolTip("Warp: Disconnecting...");
-    } else {
+    if (connecting) {
         toggleAction->setText("Connecting...");
         trayIcon->setToolTip("Warp: Connecting...");
-    }
-
-    auto watcher = new QFutureWatcher<MainFunctions::CommandResult>(this);
-    if (lastKnownState) {
-        watcher->setFuture(mf->cliDisconnectAsync());
     } else {
-        watcher->setFuture(mf->cliConnectAsync());
+        toggleAction->setText("Disconnecting...");
+        trayIcon->setToolTip("Warp: Disconnecting...");
     }
-    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher]() {
-        watcher->deleteLater();
-        toggleExpectedState = !lastKnownState;
-        togglePollAttempt = 0;
-        const int initialDelay = toggleExpectedState ? 2000 : 800;
-        togglePollTimer->start(initialDelay);
-    });
+}
+
+void SysTray::onToggleFinished(bool connected) {
+    // the user asked for this, no hysteresis
+    guard->commitState(connected);
+    updateStatus(connected);
+    toggleAction->setEnabled(true);
 }
 
 void SysTray::setupTray() {
@@ -98,6 +173,7 @@ void SysTray::setupTray() {
 
     QMenu *menu = new QMenu();
     trayIcon->setContextMenu(menu);
+    trayMenu = menu;
 
     toggleAction = new QAction("Connect", this);
 
@@ -106,6 +182,19 @@ void SysTray::setupTray() {
     menu->addAction(toggleAction);
     menu->addSeparator();
 
+    // read-only details, nothing is fetched for them while the menu is closed
+    modeAction = menu->addAction(QString());
+    accountAction = menu->addAction(QString());
+    addressAction = menu->addAction(QString());
+    uptimeAction = menu->addAction(QString());
+    for (QAction *a : {modeAction, accountAction, addressAction, uptimeAction})
+        a->setEnabled(false);
+    connect(menu, &QMenu::aboutToShow, this, [this]() {
+        details->prefetch();
+        refreshMenuDetails();
+    });
+    menu->addSeparator();
+
     menu->addAction("Show", [this]() { ensureWidget()->showPositioned(); });
 
     menu->addAction("Preferences", [this]() { ensureWidget()->openSettings(); });
@@ -113,6 +202,8 @@ void SysTray::setupTray() {
     menu->addAction("Quit", qApp, &QApplication::quit);
 
     connect(trayIcon, &QSystemTrayIcon::activated, [this](QSystemTrayIcon::ActivationReason reason) {
+        // Qt has no hover signal for tray icons, any click is the earliest hint the menu is next
+        details->prefetch();
         if (reason == QSystemTrayIcon::Trigger) {
             Widget *w = ensureWidget();
             if (w->isVisible()) {
@@ -123,27 +214,89 @@ void SysTray::setupTray() {
         }
     });
 
-    updateStatus(lastKnownState);
+    connect(trayIcon, &QSystemTrayIcon::messageClicked, this, [this]() {
+        if (offerSuppress)
+            suppressOfficialTray();
+    });
+
+    updateStatus(guard->displayedState());
     trayIcon->show();
+    // after show(), the notifications need the icon
+    officialTray->start();
 }
 
-void SysTray::handleErrorBackoff(const QString &, const QString &) {
-    // back off polling after error
-    if (pollTimer) {
-        pollTimer->start(10000);
+void SysTray::refreshMenuDetails() {
+    modeAction->setText("Mode: " + WarpModes::label(mf->currentMode()));
+
+    const QString account = details->accountType();
+    accountAction->setText(account.isEmpty()
+                               ? (details->isFetching() ? QStringLiteral("Account: ...") : QStringLiteral("Account: unknown"))
+                               : "Account: " + account);
+
+    const bool connected = tracker->isConnected();
+    const QStringList addresses = connected ? TrayDetails::tunnelAddresses() : QStringList();
+    addressAction->setVisible(!addresses.isEmpty());
+    addressAction->setText("Tunnel: " + addresses.join(", "));
+
+    // the history knows when we last went up, even across restarts
+    HistoryLog::Record last;
+    const bool upSince = connected && tracker->history().lastTransition(last)
+                         && last.newState == static_cast<quint8>(HistoryLog::State::Connected);
+    uptimeAction->setVisible(upSince);
+    if (upSince) {
+        const qint64 minutes = qMax<qint64>(0, QDateTime::currentMSecsSinceEpoch() - last.timestampMs) / 60000;
+        uptimeAction->setText(minutes < 1 ? QStringLiteral("Connected for less than a minute")
+                              : minutes < 60 ? QString("Connected for %1 min").arg(minutes)
+                              : QString("Connected for %1 h %2 min").arg(minutes / 60).arg(minutes % 60));
     }
 }
 
+void SysTray::onRetryScheduled(int attempt, int maxAttempts, int delayMs, const QString &reason) {
+    retryStatus = QString("Reconnecting (attempt %1/%2, next in %3 s): %4")
+            .arg(attempt)
+            .arg(maxAttempts)
+            .arg((delayMs + 999) / 1000)
+            .arg(reason);
+    refreshToolTip();
+}
+
+void SysTray::onRetryStopped(bool) {
+    retryStatus.clear();
+    refreshToolTip();
+}
+
+void SysTray::onTunnelStalled(int stalledForMs, bool reconnecting) {
+    const QString msg = QString("The tunnel has sent traffic without receiving anything for %1 s.")
+            .arg(stalledForMs / 1000);
+    showInfoNotification("Warp Tunnel Stalled", reconnecting ? msg + "\nReconnecting..." : msg);
+}
+
+void SysTray::refreshToolTip() {
+    if (!trayIcon)
+        return;
+    QString tip = displayedState ? QStringLiteral("Warp: Connected") : QStringLiteral("Warp: Disconnected");
+    if (tracker->isStale())
+        tip += QStringLiteral(" (last known, checking...)");
+    if (guard->isFlapping())
+        tip += QStringLiteral("\nConnection unstable, changes are shown with a delay");
+    if (!retryStatus.isEmpty())
+        tip += QLatin1Char('\n') + retryStatus;
+    const QString rates = throughput->summary();
+    if (!rates.isEmpty())
+        tip += QLatin1Char('\n') + rates;
+    trayIcon->setToolTip(tip);
+}
+
 void SysTray::updateStatus(bool connected) {
+    displayedState = connected;
     if (connected) {
         toggleAction->setText("Disconnect");
         trayIcon->setIcon(iconConnected);
-        trayIcon->setToolTip("Warp: Connected");
     } else {
         toggleAction->setText("Connect");
         trayIcon->setIcon(iconDisconnected);
-        trayIcon->setToolTip("Warp: Disconnected");
     }
+    refreshToolTip();
 }
 
 void SysTray::showErrorNotification(const QString &title, const QString &message) {
@@ -152,6 +305,7 @@ void SysTray::showErrorNotification(const QString &title, const QString &message
     isSystemTrayAvailable()
     )
     {
+        offerSuppress = false;
         trayIcon->showMessage(title, message, QSystemTrayIcon::Critical, 5000);
     }
     else
@@ -166,6 +320,7 @@ void SysTray::showInfoNotification(const QString &title, const QString &message)
     isSystemTrayAvailable()
     )
     {
+        offerSuppress = false;
         trayIcon->showMessage(title, message, QSystemTrayIcon::Information, 5000);
     }
     else
@@ -8,6 +8,12 @@
 #include <QPointer>
 #include "mainfunctions.h"
 #include "widget.h"
+#include "throughputmonitor.h"
+#include "statustracker.h"
+#include "officialtray.h"
+#include "traydetails.h"
+#include "flapguard.h"
+#include "daemonmonitor.h"
 
 class SysTray : public QObject {
     Q_OBJECT
@@ -22,8 +28,6 @@ public
 
     
 
-    void handleErrorBackoff(const QString &title, const QString &message);
-
     void setupTray();
 
 public
@@ -33,12 +37,16 @@ public
 
     void updateStatus(bool connected);
 
-    void checkStatus();
-
     void showErrorNotification(const QString &title, const QString &message);
 
     void showInfoNotification(const QString &title, const QString &message);
 
+    void onRetryScheduled(int attempt, int maxAttempts, int delayMs, const QString &reason);
+
+    void onRetryStopped(bool recovered);
+
+    void onTunnelStalled(int stalledForMs, bool reconnecting);
+
     signals:
 
     
@@ -49,21 +57,53 @@ private:
     QSystemTrayIcon *trayIcon;
     QPointer<Widget> popupWidget;
     MainFunctions *mf;
+    StatusTracker *tracker;
+    // debounces what the icon, popup and notifications show
+    FlapGuard *guard;
     QAction *toggleAction;
-    QTimer *pollTimer;
-    bool lastKnownState;
+    bool displayedState;
+
+    // menu details, filled when the menu opens
+    TrayDetails *details;
+    QMenu *trayMenu;
+    QAction *modeAction;
+    QAction *accountAction;
+    QAction *addressAction;
+    QAction *uptimeAction;
+
+    QString retryStatus;
+    ThroughputMonitor *throughput;
 
     QIcon iconConnected;
     QIcon iconDisconnected;
 
-    // Toggle polling state
-    QTimer *togglePollTimer;
-    bool toggleExpectedState;
-    int togglePollAttempt;
+    // low-memory mode: the hidden popup is destroyed after an idle period
+    QTimer *releaseTimer;
+
+    OfficialTrayMonitor *officialTray;
+    // the last notification offered to disable the official tray, a click on it does that
+    bool offerSuppress;
 
-    void pollToggleState();
+    // warp-svc CPU and memory, warns through infoOccurred
+    DaemonMonitor *daemonMonitor;
+
+    void onOfficialTrayDetected();
+
+    void suppressOfficialTray();
+
+    void onPopupVisibilityChanged(bool visible);
+
+    void releasePopup();
 
     void startToggle();
+
+    void onToggleStarted(bool connecting);
+
+    void onToggleFinished(bool connected);
+
+    void refreshToolTip();
+
+    void refreshMenuDetails();
 };
 
 #endif // SYSTRAY_H
\ No newline at end of file
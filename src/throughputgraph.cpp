@@ -0,0 +1,90 @@
+#include "throughputgraph.h"
+#include <QPainter>
+#include <QPaintEvent>
+#include <algorithm>
+
+static constexpr int kStep = 3; // px per sample
+static constexpr double kMinScale = 1024.0;
+
+static const QColor kBackground(0x1a, 0x1a, 0x1a);
+static const QColor kRxColor(0xF4, 0x81, 0x20);
+static const QColor kTxColor(0xb0, 0xb0, 0xb0);
+
+ThroughputGraph::ThroughputGraph(const ThroughputMonitor *monitor, QWidget *parent)
+    : QWidget(parent), monitor(monitor), scale(kMinScale) {
+    // we paint every pixel ourselves, lets scroll() reuse what is already on screen
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setFixedHeight(48);
+}
+
+QSize ThroughputGraph::sizeHint() const {
+    return {280, 48};
+}
+
+double ThroughputGraph::scaleBytesPerSec() const {
+    return scale;
+}
+
+double ThroughputGraph::computeScale() const {
+    const ThroughputMonitor::Ring &ring = monitor->samples();
+    const int n = static_cast<int>(ring.size());
+    const int visible = std::min(n, width() / kStep + 2);
+    float peak = 0;
+    for (int i = n - visible; i < n; ++i) {
+        const ThroughputMonitor::Rate &r = ring.at(i);
+        peak = std::max({peak, r.rxBytesPerSec, r.txBytesPerSec});
+    }
+    // power of two steps so the scale (and a full repaint) only changes on real shifts
+    double s = kMinScale;
+    while (s < peak)
+        s *= 2;
+    return s;
+}
+
+void ThroughputGraph::onSampleAdded() {
+    if (!isVisible())
+        return;
+    const double newScale = computeScale();
+    if (newScale != scale) {
+        scale = newScale;
+        update();
+        return;
+    }
+    scroll(-kStep, 0);
+}
+
+void ThroughputGraph::resizeEvent(QResizeEvent *event) {
+    scale = computeScale();
+    QWidget::resizeEvent(event);
+}
+
+void ThroughputGraph::paintEvent(QPaintEvent *event) {
+    const QRect r = event->rect();
+    QPainter p(this);
+    p.fillRect(r, kBackground);
+
+    const ThroughputMonitor::Ring &ring = monitor->samples();
+    const int n = static_cast<int>(ring.size());
+    if (n < 2)
+        return;
+
+    const int w = width();
+    const double usable = height() - 2;
+    auto xAt = [&](int i) { return w - 1 - (n - 1 - i) * kStep; };
+    auto yAt = [&](float v) { return height() - 1 - v / scale * usable; };
+
+    p.setRenderHint(QPainter::Antialiasing);
+    const int first = std::max(1, n - 1 - (w - 1 - r.left()) / kStep);
+    for (int i = first; i < n; ++i) {
+        const int x0 = xAt(i - 1);
+        if (x0 > r.right())
+            break;
+        const int x1 = xAt(i);
+        const ThroughputMonitor::Rate &a = ring.at(i - 1);
+        const ThroughputMonitor::Rate &b = ring.at(i);
+        p.setPen(QPen(kTxColor, 1));
+        p.drawLine(QPointF(x0, yAt(a.txBytesPerSec)), QPointF(x1, yAt(b.txBytesPerSec)));
+        p.setPen(QPen(kRxColor, 1.5));
+        p.drawLine(QPointF(x0, yAt(a.rxBytesPerSec)), QPointF(x1, yAt(b.rxBytesPerSec)));
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef THROUGHPUTGRAPH_H
+#define THROUGHPUTGRAPH_H
+
+#include <QWidget>
+#include "throughputmonitor.h"
+
+// Scrolling rx/tx line graph. New samples scroll the existing pixels and only the
+// newly exposed strip is painted; a full repaint happens only when the scale changes.
+class ThroughputGraph : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit ThroughputGraph(const ThroughputMonitor *monitor, QWidget *parent = nullptr);
+
+    QSize sizeHint() const override;
+
+    double scaleBytesPerSec() const;
+
+public slots:
+    void onSampleAdded();
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+    void resizeEvent(QResizeEvent *event) override;
+
+private:
+    double computeScale() const;
+
+    const ThroughputMonitor *monitor;
+    double scale;
+};
+
+#endif // THROUGHPUTGRAPH_H
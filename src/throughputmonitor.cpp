@@ -0,0 +1,101 @@
+#include "throughputmonitor.h"
+#include <QTimer>
+
+// tooltip summary is only shown for recent samples
+static constexpr qint64 kSummaryMaxAgeMs = 10000;
+// a longer hole than this (popup hidden, tunnel down) starts the trend over
+static constexpr qint64 kMaxGapMs = 3000;
+
+ThroughputMonitor::ThroughputMonitor(const QString &iface, QObject *parent)
+    : QObject(parent), counters(iface), timer(new QTimer(this)), haveLast(false), wanted(false),
+      paused(false) {
+    timer->setInterval(1000);
+    connect(timer, &QTimer::timeout, this, &ThroughputMonitor::sample);
+}
+
+void ThroughputMonitor::setActive(bool active) {
+    wanted = active;
+    if (!active || paused) {
+        timer->stop();
+        counters.close();
+        haveLast = false;
+        return;
+    }
+    if (timer->isActive())
+        return;
+    if (!counters.open())
+        return; // no tunnel interface (disconnected or DNS-only mode)
+    haveLast = counters.read(last);
+    dropStale(InterfaceCounters::monotonicMs());
+    timer->start();
+}
+
+bool ThroughputMonitor::isActive() const {
+    return timer->isActive();
+}
+
+void ThroughputMonitor::setPaused(bool pausedNow) {
+    paused = pausedNow;
+    setActive(wanted);
+}
+
+const ThroughputMonitor::Ring &ThroughputMonitor::samples() const {
+    return ring;
+}
+
+QString ThroughputMonitor::summary() const {
+    if (ring.isEmpty())
+        return QString();
+    const Rate &r = ring.last();
+    if (InterfaceCounters::monotonicMs() - r.timestampMs > kSummaryMaxAgeMs)
+        return QString();
+    return QString::fromUtf8("↓ %1  ↑ %2")
+            .arg(formatRate(r.rxBytesPerSec), formatRate(r.txBytesPerSec));
+}
+
+QString ThroughputMonitor::formatRate(double bytesPerSec) {
+    if (bytesPerSec >= 1024.0 * 1024.0)
+        return QString("%1 MB/s").arg(bytesPerSec / (1024.0 * 1024.0), 0, 'f', 1);
+    if (bytesPerSec >= 1024.0)
+        return QString("%1 KB/s").arg(bytesPerSec / 1024.0, 0, 'f', 1);
+    return QString("%1 B/s").arg(bytesPerSec, 0, 'f', 0);
+}
+
+void ThroughputMonitor::dropStale(qint64 nowMs) {
+    if (ring.isEmpty() || nowMs - ring.last().timestampMs <= kMaxGapMs)
+        return;
+    // otherwise the graph draws a line from the old samples straight onto the new ones
+    ring.clear();
+    emit samplesCleared();
+}
+
+void ThroughputMonitor::sample() {
+    if (!counters.isOpen() && !counters.open())
+        return; // still waiting for the interface to come back
+    InterfaceCounters::Sample now;
+    if (!counters.read(now)) {
+        // recreated by a reconnect, the old descriptors stay dead; reopen on the next tick
+        counters.close();
+        haveLast = false;
+        return;
+    }
+    if (!haveLast || now.timestampMs <= last.timestampMs) {
+        last = now;
+        haveLast = true;
+        return;
+    }
+
+    const double secs = (now.timestampMs - last.timestampMs) / 1000.0;
+    Rate r;
+    // counters can reset when the interface is recreated, clamp instead of wrapping
+    r.rxBytesPerSec = now.rxBytes >= last.rxBytes ? float((now.rxBytes - last.rxBytes) / secs) : 0.f;
+    r.txBytesPerSec = now.txBytes >= last.txBytes ? float((now.txBytes - last.txBytes) / secs) : 0.f;
+    r.rxPacketsPerSec = now.rxPackets >= last.rxPackets ? float((now.rxPackets - last.rxPackets) / secs) : 0.f;
+    r.txPacketsPerSec = now.txPackets >= last.txPackets ? float((now.txPackets - last.txPackets) / secs) : 0.f;
+    r.timestampMs = now.timestampMs;
+    last = now;
+
+    dropStale(r.timestampMs);
+    ring.push(r);
+    emit sampleAdded();
+}
@@ -0,0 +1,61 @@
+#ifndef THROUGHPUTMONITOR_H
+#define THROUGHPUTMONITOR_H
+
+#include <QObject>
+#include "ifacecounters.h"
+#include "samplering.h"
+
+class QTimer;
+
+// 1 Hz rate sampler for the tunnel interface, only runs while someone is looking at it.
+class ThroughputMonitor : public QObject {
+    Q_OBJECT
+
+public:
+    struct Rate {
+        float rxBytesPerSec = 0;
+        float txBytesPerSec = 0;
+        float rxPacketsPerSec = 0;
+        float txPacketsPerSec = 0;
+        qint64 timestampMs = 0;
+    };
+
+    using Ring = SampleRing<Rate, 120>;
+
+    explicit ThroughputMonitor(const QString &iface = QStringLiteral("CloudflareWARP"),
+                               QObject *parent = nullptr);
+
+    void setActive(bool active);
+
+    bool isActive() const;
+
+    // overrides setActive(true) while the session sleeps or is locked
+    void setPaused(bool paused);
+
+    const Ring &samples() const;
+
+    QString summary() const;
+
+    static QString formatRate(double bytesPerSec);
+
+signals:
+    void sampleAdded();
+
+    // samples() was emptied, anything drawn from it is stale
+    void samplesCleared();
+
+private:
+    void sample();
+
+    void dropStale(qint64 nowMs);
+
+    InterfaceCounters counters;
+    QTimer *timer;
+    Ring ring;
+    InterfaceCounters::Sample last;
+    bool haveLast;
+    bool wanted;
+    bool paused;
+};
+
+#endif // THROUGHPUTMONITOR_H
@@ -0,0 +1,72 @@
+#include "traydetails.h"
+#include "linescanner.h"
+#include "mainfunctions.h"
+#include <QFutureWatcher>
+#include <QtConcurrent>
+#include <arpa/inet.h>
+#include <ifaddrs.h>
+#include <netinet/in.h>
+
+// the account type only changes on re-registration or a license key
+static constexpr qint64 kAccountTtlMs = 5 * 60 * 1000;
+
+TrayDetails::TrayDetails(MainFunctions *mf, QObject *parent) : QObject(parent), mf(mf), fetching(false) {
+}
+
+void TrayDetails::prefetch() {
+    if (fetching || (fetchedAt.isValid() && fetchedAt.elapsed() < kAccountTtlMs))
+        return;
+    fetching = true;
+
+    auto watcher = new QFutureWatcher<QString>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher]() {
+        watcher->deleteLater();
+        fetching = false;
+        const QString line = watcher->result();
+        // "Account type: Free"
+        const int colon = line.indexOf(QLatin1Char(':'));
+        if (colon >= 0) {
+            account = line.mid(colon + 1).trimmed();
+            fetchedAt.start();
+        }
+        emit updated();
+    });
+    MainFunctions *mainFunctions = mf;
+    watcher->setFuture(QtConcurrent::run([mainFunctions]() {
+        LineScanner scanner;
+        const int field = scanner.addField("Account type:");
+        mainFunctions->scanCommand("warp-cli", {"registration", "show"}, 3000, scanner);
+        return scanner.line(field);
+    }));
+}
+
+bool TrayDetails::isFetching() const {
+    return fetching;
+}
+
+QString TrayDetails::accountType() const {
+    return account;
+}
+
+QStringList TrayDetails::tunnelAddresses(const QString &iface) {
+    QStringList out;
+    ifaddrs *list = nullptr;
+    if (::getifaddrs(&list) != 0)
+        return out;
+    const QByteArray name = iface.toLocal8Bit();
+    for (ifaddrs *ifa = list; ifa; ifa = ifa->ifa_next) {
+        if (!ifa->ifa_addr || name != ifa->ifa_name)
+            continue;
+        char buf[INET6_ADDRSTRLEN];
+        const int family = ifa->ifa_addr->sa_family;
+        const void *addr = nullptr;
+        if (family == AF_INET)
+            addr = &reinterpret_cast<const sockaddr_in *>(ifa->ifa_addr)->sin_addr;
+        else if (family == AF_INET6)
+            addr = &reinterpret_cast<const sockaddr_in6 *>(ifa->ifa_addr)->sin6_addr;
+        if (addr && ::inet_ntop(family, addr, buf, sizeof(buf)))
+            out.append(QString::fromLatin1(buf));
+    }
+    ::freeifaddrs(list);
+    return out;
+}
@@ -0,0 +1,40 @@
+#ifndef TRAYDETAILS_H
+#define TRAYDETAILS_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QStringList>
+
+class MainFunctions;
+
+// Details for the tray menu that nothing else polls for. Cheap ones are read on the spot, the
+// account type costs a warp-cli call and is only fetched when someone is about to look at it,
+// then served from cache while a background refresh runs.
+class TrayDetails : public QObject {
+    Q_OBJECT
+
+public:
+    explicit TrayDetails(MainFunctions *mf, QObject *parent = nullptr);
+
+    // refreshes the expensive fields in the background unless the cache is fresh or a fetch runs
+    void prefetch();
+
+    bool isFetching() const;
+
+    // "Free", "Unlimited", "Team", ... empty until the first fetch came back
+    QString accountType() const;
+
+    // addresses on the tunnel interface straight from getifaddrs(), no command involved
+    static QStringList tunnelAddresses(const QString &iface = QStringLiteral("CloudflareWARP"));
+
+signals:
+    void updated();
+
+private:
+    MainFunctions *mf;
+    QString account;
+    QElapsedTimer fetchedAt;
+    bool fetching;
+};
+
+#endif // TRAYDETAILS_H
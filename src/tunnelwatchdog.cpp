@@ -0,0 +1,110 @@
+#include "tunnelwatchdog.h"
+#include <QTimer>
+#include <QDebug>
+
+// a few packets of tx per sample are needed before a flat rx counts as a stall,
+// otherwise an idle tunnel would look stalled
+static constexpr quint64 kMinTxPacketsPerSample = 2;
+
+TunnelWatchdog::TunnelWatchdog(const QString &iface, QObject *parent)
+    : QObject(parent), counters(iface), timer(new QTimer(this)), haveLast(false), stalled(false),
+      stallSinceMs(-1), stallWindowMs(10000) {
+    timer->setInterval(2000);
+    timer->setTimerType(Qt::VeryCoarseTimer);
+    connect(timer, &QTimer::timeout, this, &TunnelWatchdog::sample);
+}
+
+void TunnelWatchdog::start() {
+    if (timer->isActive())
+        return;
+    haveLast = false;
+    stalled = false;
+    stallSinceMs = -1;
+    // DNS-only modes have no tunnel interface, nothing to watch
+    if (!counters.open())
+        return;
+    timer->start();
+}
+
+void TunnelWatchdog::stop() {
+    timer->stop();
+    counters.close();
+    haveLast = false;
+    if (stalled) {
+        stalled = false;
+        emit stallCleared();
+    }
+}
+
+bool TunnelWatchdog::isRunning() const {
+    return timer->isActive();
+}
+
+bool TunnelWatchdog::isStalled() const {
+    return stalled;
+}
+
+void TunnelWatchdog::setIntervalMs(int ms) {
+    // very coarse timers round to whole seconds, which would swallow a short interval
+    timer->setTimerType(ms >= 1000 ? Qt::VeryCoarseTimer : Qt::CoarseTimer);
+    timer->setInterval(ms);
+}
+
+void TunnelWatchdog::setStallWindowMs(int ms) {
+    stallWindowMs = ms;
+}
+
+void TunnelWatchdog::setSysfsRoot(const QString &root) {
+    if (!timer->isActive())
+        counters.setSysfsRoot(root);
+}
+
+void TunnelWatchdog::sample() {
+    // a reconnect recreates the interface, keep trying until it is back or we are stopped
+    if (!counters.isOpen() && !counters.open())
+        return;
+    InterfaceCounters::Sample now;
+    if (!counters.read(now)) {
+        // the old descriptors stay dead, a real disconnect stops us through connectionChanged
+        counters.close();
+        haveLast = false;
+        stallSinceMs = -1;
+        if (stalled) {
+            stalled = false;
+            emit stallCleared();
+        }
+        return;
+    }
+    if (!haveLast) {
+        last = now;
+        haveLast = true;
+        return;
+    }
+
+    const bool txGrowing = now.txPackets - last.txPackets >= kMinTxPacketsPerSample
+                           && now.txBytes > last.txBytes;
+    const bool rxFlat = now.rxPackets == last.rxPackets;
+    last = now;
+
+    if (!rxFlat) {
+        stallSinceMs = -1;
+        if (stalled) {
+            stalled = false;
+            emit stallCleared();
+        }
+        return;
+    }
+    if (!txGrowing) {
+        // idle, not evidence either way
+        return;
+    }
+
+    if (stallSinceMs < 0)
+        stallSinceMs = now.timestampMs;
+    const qint64 stalledFor = now.timestampMs - stallSinceMs;
+    if (!stalled && stalledFor >= stallWindowMs) {
+        stalled = true;
+        qWarning() << "tunnel stalled on" << counters.interfaceName() << "for" << stalledFor << "ms";
+        emit stallDetected(static_cast<int>(stalledFor));
+    }
+}
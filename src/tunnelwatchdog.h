@@ -0,0 +1,50 @@
+#ifndef TUNNELWATCHDOG_H
+#define TUNNELWATCHDOG_H
+
+#include <QObject>
+#include "ifacecounters.h"
+
+class QTimer;
+
+// Detects a tunnel that is up but dead: we keep sending (tx grows) while
+// nothing comes back (rx_packets flat) for longer than the stall window.
+class TunnelWatchdog : public QObject {
+    Q_OBJECT
+
+public:
+    explicit TunnelWatchdog(const QString &iface = QStringLiteral("CloudflareWARP"),
+                            QObject *parent = nullptr);
+
+    void start();
+
+    void stop();
+
+    bool isRunning() const;
+
+    bool isStalled() const;
+
+    void setIntervalMs(int ms);
+
+    void setStallWindowMs(int ms);
+
+    // ignored while running, tests point this at a fake tree
+    void setSysfsRoot(const QString &root);
+
+signals:
+    void stallDetected(int stalledForMs);
+
+    void stallCleared();
+
+private:
+    void sample();
+
+    InterfaceCounters counters;
+    QTimer *timer;
+    InterfaceCounters::Sample last;
+    bool haveLast;
+    bool stalled;
+    qint64 stallSinceMs;
+    int stallWindowMs;
+};
+
+#endif // TUNNELWATCHDOG_H
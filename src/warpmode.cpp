@@ -0,0 +1,37 @@
+#include "warpmode.h"
+
+namespace {
+    WarpMode lookup(const QString &name, const std::array<quint8, WarpModes::detail::kSlots> &slots, bool cli) {
+        if (name.isEmpty())
+            return WarpMode::Unknown;
+        const std::size_t slot = WarpModes::detail::hash(static_cast<std::size_t>(name.size()),
+                                                         name.at(0).toLatin1(), name.at(name.size() - 1).toLatin1());
+        const quint8 row = slots[slot];
+        if (row == WarpModes::detail::kEmpty)
+            return WarpMode::Unknown;
+        // one compare against the only candidate, anything else hashing here is not a mode
+        const char *candidate = WarpModes::detail::nameOf(row, cli);
+        return name == QLatin1String(candidate) ? WarpModes::kTable[row].mode : WarpMode::Unknown;
+    }
+} // namespace
+
+WarpMode WarpModes::fromDaemonName(const QString &name) {
+    return lookup(name, detail::kDaemonSlots, false);
+}
+
+WarpMode WarpModes::fromCliName(const QString &name) {
+    return lookup(name, detail::kCliSlots, true);
+}
+
+QString WarpModes::cliName(WarpMode mode) {
+    const char *name = info(mode).cliName;
+    return name ? QString::fromLatin1(name) : QString();
+}
+
+QString WarpModes::label(WarpMode mode) {
+    return QString::fromLatin1(info(mode).label);
+}
+
+WarpMode WarpModes::fromCode(quint8 code) {
+    return code < kCount ? static_cast<WarpMode>(code) : WarpMode::Unknown;
+}
@@ -0,0 +1,140 @@
+#ifndef WARPMODE_H
+#define WARPMODE_H
+
+#include <QString>
+#include <array>
+#include <cstddef>
+
+// WARP operation modes. The values double as the history log's on-disk mode codes, only append.
+enum class WarpMode : quint8 {
+    Unknown = 0,
+    Warp = 1,
+    DnsOverHttps = 2,
+    WarpWithDnsOverHttps = 3,
+    DnsOverTls = 4,
+    WarpWithDnsOverTls = 5,
+    Proxy = 6,
+    TunnelOnly = 7,
+    PostureOnly = 8
+};
+
+// One compile-time table drives parsing of warp-cli output, the mode combo box and the
+// connection check. Name lookups go through a perfect hash built from the table.
+namespace WarpModes {
+    // how isWarpConnected() tells that a mode is up
+    enum class Detection : quint8 {
+        TunnelInterface, // the CloudflareWARP link exists
+        ResolvConf,      // WARP's local DNS proxy is in /etc/resolv.conf
+        ProxyListener    // something listens on the local SOCKS5/HTTP proxy port
+    };
+
+    struct Info {
+        WarpMode mode;
+        const char *daemonName; // "Mode: <name>" in warp-cli settings
+        const char *cliName;    // argument to warp-cli mode, nullptr if it can't be set from here
+        const char *label;
+        Detection detection;
+    };
+
+    inline constexpr Info kTable[] = {
+        {WarpMode::Unknown, nullptr, nullptr, "Unknown", Detection::TunnelInterface},
+        {WarpMode::Warp, "Warp", "warp", "WARP", Detection::TunnelInterface},
+        {WarpMode::DnsOverHttps, "DnsOverHttps", "doh", "DNS over HTTPS", Detection::ResolvConf},
+        {WarpMode::WarpWithDnsOverHttps, "WarpWithDnsOverHttps", "warp+doh", "WARP + DNS over HTTPS",
+         Detection::TunnelInterface},
+        {WarpMode::DnsOverTls, "DnsOverTls", "dot", "DNS over TLS", Detection::ResolvConf},
+        {WarpMode::WarpWithDnsOverTls, "WarpWithDnsOverTls", "warp+dot", "WARP + DNS over TLS",
+         Detection::TunnelInterface},
+        {WarpMode::Proxy, "WarpProxy", "proxy", "Local Proxy", Detection::ProxyListener},
+        {WarpMode::TunnelOnly, "TunnelOnly", "tunnel_only", "Tunnel Only", Detection::TunnelInterface},
+        // org managed, nothing to check really, the interface test is as good as any
+        {WarpMode::PostureOnly, "PostureOnly", nullptr, "Device Posture Only", Detection::TunnelInterface},
+    };
+
+    inline constexpr std::size_t kCount = sizeof(kTable) / sizeof(kTable[0]);
+
+    constexpr bool tableInEnumOrder() {
+        for (std::size_t i = 0; i < kCount; ++i) {
+            if (static_cast<std::size_t>(kTable[i].mode) != i)
+                return false;
+        }
+        return true;
+    }
+
+    static_assert(tableInEnumOrder(), "kTable rows must be indexed by their WarpMode value");
+
+    namespace detail {
+        constexpr std::size_t kSlots = 32;
+        constexpr quint8 kEmpty = 0xff;
+
+        constexpr std::size_t length(const char *s) {
+            std::size_t n = 0;
+            while (s[n])
+                ++n;
+            return n;
+        }
+
+        // length plus first and last character is enough to tell all names apart, checked below
+        constexpr std::size_t hash(std::size_t len, char first, char last) {
+            return (len + static_cast<unsigned char>(first) + static_cast<unsigned char>(last)) % kSlots;
+        }
+
+        constexpr const char *nameOf(std::size_t row, bool cli) {
+            return cli ? kTable[row].cliName : kTable[row].daemonName;
+        }
+
+        constexpr std::array<quint8, kSlots> buildSlots(bool cli) {
+            std::array<quint8, kSlots> slots{};
+            for (auto &slot : slots)
+                slot = kEmpty;
+            for (std::size_t i = 0; i < kCount; ++i) {
+                const char *name = nameOf(i, cli);
+                if (!name)
+                    continue;
+                const std::size_t len = length(name);
+                slots[hash(len, name[0], name[len - 1])] = static_cast<quint8>(i);
+            }
+            return slots;
+        }
+
+        constexpr bool collisionFree(bool cli) {
+            const std::array<quint8, kSlots> slots = buildSlots(cli);
+            for (std::size_t i = 0; i < kCount; ++i) {
+                const char *name = nameOf(i, cli);
+                if (!name)
+                    continue;
+                const std::size_t len = length(name);
+                if (slots[hash(len, name[0], name[len - 1])] != i)
+                    return false;
+            }
+            return true;
+        }
+
+        inline constexpr std::array<quint8, kSlots> kDaemonSlots = buildSlots(false);
+        inline constexpr std::array<quint8, kSlots> kCliSlots = buildSlots(true);
+    } // namespace detail
+
+    static_assert(detail::collisionFree(false) && detail::collisionFree(true),
+                  "mode names collide in the hash, change detail::hash or kSlots");
+
+    constexpr const Info &info(WarpMode mode) {
+        const auto row = static_cast<std::size_t>(mode);
+        return kTable[row < kCount ? row : 0];
+    }
+
+    // "Warp", "WarpProxy", ... as printed by warp-cli settings
+    WarpMode fromDaemonName(const QString &name);
+
+    // "warp", "proxy", ... as taken by warp-cli mode; also what settings and snapshots store
+    WarpMode fromCliName(const QString &name);
+
+    // "" for modes without a CLI name
+    QString cliName(WarpMode mode);
+
+    QString label(WarpMode mode);
+
+    // history log and other persisted codes, Unknown if out of range
+    WarpMode fromCode(quint8 code);
+}
+
+#endif // WARPMODE_H
@@ -1,10 +1,17 @@
 #include "widget.h"
 #include "settingsdiag.h"
+#include "throughputgraph.h"
+#include "throughputmonitor.h"
+#include "rttprober.h"
+#include "historylog.h"
+#include "settingsstore.h"
 #include <QApplication>
 #include <QCursor>
 #include <QScreen>
-#include <QSettings>
 #include <QFutureWatcher>
+#include <QLabel>
+#include <QPushButton>
+#include <QHBoxLayout>
 #include "./ui_widget.h"
 
 static const int kPollDelays[] = {500, 1000, 2000, 3000, 4000, 5000};
@@ -21,42 +28,204 @@ static const QString kNotPrivateHtml = QStringLiteral(
     "color:#ffffff;'>not private</span></p></body></html>");
 
 Widget::Widget(MainFunctions *mf, QWidget *parent)
-    : QWidget(parent), ui(new Ui::Widget), mf(mf), connectedState(false), shouldUnfocus(false),
-      pendingState(TransitionState::None), pollTimer(new QTimer(this)), expectedState(false), pollAttempt(0) {
+    : QWidget(parent), ui(new Ui::Widget), mf(mf), connectedState(false), staleState(false), shouldUnfocus(false),
+      pendingState(TransitionState::None), pollTimer(new QTimer(this)), expectedState(false), pollAttempt(0),
+      throughput(nullptr), graph(nullptr), rateLabel(nullptr),
+      prober(nullptr), btnProbe(nullptr), rttLabel(nullptr), history(nullptr), historyLabel(nullptr),
+      daemonMonitor(nullptr) {
     ui->setupUi(this);
-    setFixedSize(310, 405);
+    setFixedSize(310, 520);
     setWindowFlags(Qt::Tool | Qt::WindowStaysOnTopHint);
 
     pollTimer->setSingleShot(true);
     connect(pollTimer, &QTimer::timeout, this, &Widget::pollConnectionState);
 
     refreshSettings();
+    SettingsStore::instance().onChanged(SettingsStore::Key::MinimizeOnUnfocus, this,
+                                        [this](const QVariant &value) { shouldUnfocus = value.toBool(); });
+    setupLatencyProbe();
 
-    QSettings settings;
-    bool shouldAutoConnect = settings.value("autoConnect", false).toBool();
-    bool actuallyConnected = mf->isWarpConnected();
-
-    if (shouldAutoConnect && !actuallyConnected) {
-        mf->cliConnect();
-    }
-
-    connectedState = actuallyConnected;
+    // the tray hands over its known state, no blocking probe here
     updateUI();
 }
 
 Widget::~Widget() {
+    if (throughput)
+        throughput->setActive(false);
     delete ui;
 }
 
+void Widget::setThroughputMonitor(ThroughputMonitor *monitor) {
+    if (throughput || !monitor)
+        return;
+    throughput = monitor;
+
+    graph = new ThroughputGraph(throughput, this);
+    rateLabel = new QLabel(this);
+    rateLabel->setAlignment(Qt::AlignCenter);
+    rateLabel->setStyleSheet("color: #b0b0b0; font-size: 9pt;");
+    // above the latency probe row
+    ui->detailsLayout->insertWidget(0, graph);
+    ui->detailsLayout->insertWidget(1, rateLabel);
+
+    connect(throughput, &ThroughputMonitor::sampleAdded, graph, &ThroughputGraph::onSampleAdded);
+    connect(throughput, &ThroughputMonitor::samplesCleared, graph, QOverload<>::of(&ThroughputGraph::update));
+    connect(throughput, &ThroughputMonitor::sampleAdded, this, &Widget::updateRateLabel);
+    updateRateLabel();
+    updateSampling();
+}
+
+void Widget::setHistoryLog(const HistoryLog *log) {
+    if (history || !log)
+        return;
+    history = log;
+    historyLabel = new QLabel(this);
+    historyLabel->setAlignment(Qt::AlignCenter);
+    historyLabel->setStyleSheet("color: #808080; font-size: 8pt;");
+    ui->detailsLayout->addWidget(historyLabel);
+    updateHistoryLabel();
+}
+
+void Widget::setStateStale(bool stale) {
+    if (staleState == stale)
+        return;
+    staleState = stale;
+    updateUI();
+}
+
+void Widget::updateHistoryLabel() {
+    if (!historyLabel)
+        return;
+    // mmap'd scan of the history file, cheap enough to redo on every show
+    const HistoryLog::Stats week = history->stats(7LL * 24 * 60 * 60 * 1000);
+    QString text = QString("7 days: %1% connected · %2 failures")
+            .arg(week.uptimeRatio() * 100.0, 0, 'f', 1)
+            .arg(week.failures);
+    if (week.failures > 0)
+        text += QString(" (%1% of attempts)").arg(week.failureRate() * 100.0, 0, 'f', 0);
+    const qint64 avgConnect = week.averageConnectMs();
+    if (avgConnect >= 0)
+        text += QString(" · connect avg %1 s").arg(avgConnect / 1000.0, 0, 'f', 1);
+    historyLabel->setText(text);
+}
+
+void Widget::showEvent(QShowEvent *event) {
+    QWidget::showEvent(event);
+    updateSampling();
+    updateHistoryLabel();
+    emit visibilityChanged(true);
+}
+
+void Widget::hideEvent(QHideEvent *event) {
+    QWidget::hideEvent(event);
+    updateSampling();
+    emit visibilityChanged(false);
+}
+
+void Widget::updateSampling() {
+    // sampling and painting only while someone can see it
+    if (throughput)
+        throughput->setActive(isVisible() && connectedState);
+}
+
+void Widget::updateRateLabel() {
+    if (!rateLabel)
+        return;
+    if (!throughput->isActive() || throughput->samples().isEmpty()) {
+        rateLabel->setText(connectedState ? "Waiting for tunnel traffic..." : "No tunnel traffic");
+        return;
+    }
+    const ThroughputMonitor::Rate &r = throughput->samples().last();
+    rateLabel->setText(QString::fromUtf8("<span style='color:#F48120;'>↓ %1</span> %2 pkt/s"
+                                         "&nbsp;&nbsp;↑ %3 %4 pkt/s")
+        .arg(ThroughputMonitor::formatRate(r.rxBytesPerSec))
+        .arg(qRound(r.rxPacketsPerSec))
+        .arg(ThroughputMonitor::formatRate(r.txBytesPerSec))
+        .arg(qRound(r.txPacketsPerSec)));
+}
+
+void Widget::setupLatencyProbe() {
+    prober = new RttProber(QStringLiteral("CloudflareWARP"), this);
+
+    btnProbe = new QPushButton("Measure Latency", this);
+    btnProbe->setCursor(Qt::PointingHandCursor);
+    btnProbe->setStyleSheet(
+        "QPushButton { background: transparent; color: #aaaaaa; border: 1px solid #444444; "
+        "border-radius: 8px; padding: 3px 10px; font-size: 9pt; } "
+        "QPushButton:hover { color: #ffffff; border-color: #888888; } "
+        "QPushButton:disabled { color: #555555; border-color: #333333; }");
+    rttLabel = new QLabel(this);
+    rttLabel->setAlignment(Qt::AlignCenter);
+    rttLabel->setStyleSheet("color: #b0b0b0; font-size: 9pt;");
+    rttLabel->hide();
+
+    auto row = new QHBoxLayout();
+    row->addStretch();
+    row->addWidget(btnProbe);
+    row->addStretch();
+    ui->detailsLayout->addLayout(row);
+    ui->detailsLayout->addWidget(rttLabel);
+
+    connect(btnProbe, &QPushButton::clicked, this, &Widget::startLatencyProbe);
+    connect(prober, &RttProber::progress, this, [this](int done, int total) {
+        btnProbe->setText(QString("Measuring... %1/%2").arg(done).arg(total));
+    });
+    connect(prober, &RttProber::finished, this, [this]() {
+        btnProbe->setText("Measure Latency");
+        btnProbe->setEnabled(true);
+        updateLatencyLabel();
+    });
+}
+
+void Widget::startLatencyProbe() {
+    const SettingsStore &settings = SettingsStore::instance();
+    const QString target = settings.text(SettingsStore::Key::RttTarget);
+    const auto protocol = settings.text(SettingsStore::Key::RttProtocol) == "tcp"
+                              ? RttProber::Protocol::Tcp
+                              : RttProber::Protocol::Udp;
+    if (!prober->setTarget(target, protocol)) {
+        rttLabel->setText(QString("Invalid probe target '%1'").arg(target));
+        rttLabel->show();
+        return;
+    }
+    btnProbe->setEnabled(false);
+    btnProbe->setText("Measuring...");
+    prober->start(5);
+}
+
+void Widget::updateLatencyLabel() {
+    auto line = [this](RttProber::Path path, const QString &name) {
+        const LatencyStats st = prober->stats(path);
+        if (st.count == 0) {
+            const QString err = prober->lastError(path);
+            return QString("%1: %2").arg(name, err.isEmpty() ? QStringLiteral("no replies") : err);
+        }
+        QString text = QString("%1: min %2 · med %3 · p95 %4 ms")
+                .arg(name)
+                .arg(st.min / 1000.0, 0, 'f', 1)
+                .arg(st.median / 1000.0, 0, 'f', 1)
+                .arg(st.p95 / 1000.0, 0, 'f', 1);
+        const int lost = prober->lost(path);
+        if (lost > 0)
+            text += QString(" (%1 lost)").arg(lost);
+        return text;
+    };
+    rttLabel->setText(line(RttProber::Path::Tunnel, "Tunnel") + "\n" + line(RttProber::Path::Direct, "Direct"));
+    rttLabel->show();
+}
+
 void Widget::refreshSettings() {
-    QSettings settings;
-    shouldUnfocus = settings.value("minimizeOnUnfocus", true).toBool();
+    shouldUnfocus = SettingsStore::instance().flag(SettingsStore::Key::MinimizeOnUnfocus);
+}
+
+void Widget::setDaemonMonitor(DaemonMonitor *monitor) {
+    daemonMonitor = monitor;
 }
 
 void Widget::openSettings() {
     SettingsDiag dlg(mf, this);
+    dlg.setDaemonMonitor(daemonMonitor);
     dlg.exec();
-    refreshSettings();
 }
 
 void Widget::on_btn_settings_clicked() {
@@ -139,7 +308,7 @@ void Widget::updateUI() {
         ui->btn_start->setText("Disconnect");
         ui->connected_status->setText("CONNECTED");
         ui->connected_status->setStyleSheet("color: #F48120; font-weight: bold;");
-        ui->sub_status->setText(getPrivateHtml());
+        ui->sub_status->setText(staleState ? QStringLiteral("Last known state, checking...") : getPrivateHtml());
 
         ui->btn_start->setStyleSheet(
             "QPushButton { background-color: #F48120; color: #ffffff; "
@@ -149,7 +318,7 @@ void Widget::updateUI() {
         ui->btn_start->setText("Connect");
         ui->connected_status->setText("DISCONNECTED");
         ui->connected_status->setStyleSheet("color: #ffffff; font-weight: bold;");
-        ui->sub_status->setText(getNotPrivateHtml());
+        ui->sub_status->setText(staleState ? QStringLiteral("Last known state, checking...") : getNotPrivateHtml());
 
         ui->btn_start->setStyleSheet(
             "QPushButton { background-color: #ffffff; color: #404041; "
@@ -166,6 +335,7 @@ void Widget::pollConnectionState() {
         setPending(TransitionState::None);
         emit connectionChanged(connectedState);
         updateUI();
+        updateSampling();
         return;
     }
 
@@ -174,18 +344,23 @@ void Widget::pollConnectionState() {
 }
 
 void Widget::on_btn_start_clicked() {
+    emit toggleRequested();
     setPending(connectedState ? TransitionState::Disconnecting : TransitionState::Connecting);
     updateUI();
 
     auto watcher = new QFutureWatcher<MainFunctions::CommandResult>(this);
-    if (!connectedState) {
+    const bool connecting = !connectedState;
+    if (connecting) {
         watcher->setFuture(mf->cliConnectAsync());
     } else {
+        mf->cancelConnectRetry();
         watcher->setFuture(mf->cliDisconnectAsync());
     }
 
-    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher]() {
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, connecting]() {
         watcher->deleteLater();
+        if (connecting)
+            mf->handleConnectResult(watcher->result());
         expectedState = !connectedState;
         pollAttempt = 0;
         const int initialDelay = expectedState ? 2000 : 800;
@@ -198,6 +373,7 @@ void Widget::onConnectionChanged(bool connected) {
         connectedState = connected;
         setPending(TransitionState::None);
         updateUI();
+        updateSampling();
     }
 }
 
@@ -8,6 +8,13 @@
 #include "mainfunctions.h"
 
 class SettingsDiag;
+class ThroughputMonitor;
+class ThroughputGraph;
+class QLabel;
+class QPushButton;
+class RttProber;
+class HistoryLog;
+class DaemonMonitor;
 
 QT_BEGIN_NAMESPACE
 
@@ -27,11 +34,25 @@ public:
 
     void showPositioned();
 
+    void setThroughputMonitor(ThroughputMonitor *monitor);
+
+    void setHistoryLog(const HistoryLog *log);
+
+    // handed on to the settings dialog for its warp-svc readout
+    void setDaemonMonitor(DaemonMonitor *monitor);
+
+    // the shown state comes from the last run and hasn't been confirmed yet
+    void setStateStale(bool stale);
+
 protected:
     void closeEvent(QCloseEvent *event) override;
 
     bool event(QEvent *event) override;
 
+    void showEvent(QShowEvent *event) override;
+
+    void hideEvent(QHideEvent *event) override;
+
 private
     slots:
 
@@ -56,6 +77,10 @@ public
 
     void connectionChanged(bool connected);
 
+    void toggleRequested();
+
+    void visibilityChanged(bool visible);
+
 private:
     enum class TransitionState {
         None,
@@ -66,6 +91,7 @@ private:
     Ui::Widget *ui;
     MainFunctions *mf;
     bool connectedState;
+    bool staleState;
     bool shouldUnfocus;
     TransitionState pendingState;
 
@@ -76,6 +102,33 @@ private:
 
     void pollConnectionState();
 
+    // live throughput view, fed by the tray owned monitor
+    ThroughputMonitor *throughput;
+    ThroughputGraph *graph;
+    QLabel *rateLabel;
+
+    void updateSampling();
+
+    void updateRateLabel();
+
+    // on-demand latency comparison, tunnel vs direct
+    RttProber *prober;
+    QPushButton *btnProbe;
+    QLabel *rttLabel;
+
+    void setupLatencyProbe();
+
+    void startLatencyProbe();
+
+    void updateLatencyLabel();
+
+    const HistoryLog *history;
+    QLabel *historyLabel;
+
+    void updateHistoryLabel();
+
+    DaemonMonitor *daemonMonitor;
+
 private:
     void refreshSettings();
 
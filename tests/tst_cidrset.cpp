@@ -0,0 +1,75 @@
+#include "cidrset.h"
+#include <QtTest>
+
+class TestCidrSet : public QObject {
+    Q_OBJECT
+
+private slots:
+    void canonical_data() {
+        QTest::addColumn<QString>("entry");
+        QTest::addColumn<QString>("expected");
+        QTest::newRow("host bits cleared") << "10.1.2.3/8" << "10.0.0.0/8";
+        QTest::newRow("bare v4 address") << "192.168.1.7" << "192.168.1.7/32";
+        QTest::newRow("surrounding space") << "  172.16.0.0/12 " << "172.16.0.0/12";
+        QTest::newRow("v6") << "2001:db8::1/32" << "2001:db8::/32";
+        QTest::newRow("bare v6 address") << "::1" << "::1/128";
+        QTest::newRow("prefix too long") << "10.0.0.0/33" << QString();
+        QTest::newRow("prefix not a number") << "10.0.0.0/x" << QString();
+        QTest::newRow("host name") << "example.com" << QString();
+        QTest::newRow("empty") << "" << QString();
+    }
+
+    void canonical() {
+        QFETCH(QString, entry);
+        QFETCH(QString, expected);
+        QCOMPARE(CidrSet::canonical(entry), expected);
+    }
+
+    void aggregated_data() {
+        QTest::addColumn<QStringList>("entries");
+        QTest::addColumn<QStringList>("expected");
+        QTest::newRow("sibling halves merge")
+                << QStringList{"10.0.0.0/25", "10.0.0.128/25"} << QStringList{"10.0.0.0/24"};
+        QTest::newRow("merges cascade")
+                << QStringList{"10.0.3.0/24", "10.0.1.0/24", "10.0.0.0/24", "10.0.2.0/24"}
+                << QStringList{"10.0.0.0/22"};
+        QTest::newRow("covered after")
+                << QStringList{"10.0.0.0/8", "10.1.2.0/24"} << QStringList{"10.0.0.0/8"};
+        QTest::newRow("covered before")
+                << QStringList{"10.1.2.0/24", "10.1.2.7", "10.0.0.0/8"} << QStringList{"10.0.0.0/8"};
+        QTest::newRow("gap kept")
+                << QStringList{"10.0.2.0/24", "10.0.0.0/24"} << QStringList{"10.0.0.0/24", "10.0.2.0/24"};
+        QTest::newRow("not siblings")
+                << QStringList{"10.0.1.0/24", "10.0.2.0/24"} << QStringList{"10.0.1.0/24", "10.0.2.0/24"};
+        QTest::newRow("duplicates")
+                << QStringList{"192.168.0.1", "192.168.0.1/32"} << QStringList{"192.168.0.1/32"};
+        QTest::newRow("v4 before v6")
+                << QStringList{"2001:db8::/33", "10.0.0.0/8", "2001:db8:8000::/33"}
+                << QStringList{"10.0.0.0/8", "2001:db8::/32"};
+        QTest::newRow("everything") << QStringList{"0.0.0.0/1", "128.0.0.0/1"} << QStringList{"0.0.0.0/0"};
+        QTest::newRow("nothing") << QStringList() << QStringList();
+    }
+
+    void aggregated() {
+        QFETCH(QStringList, entries);
+        QFETCH(QStringList, expected);
+        CidrSet set;
+        for (const QString &entry : entries)
+            QVERIFY(set.add(entry));
+        QCOMPARE(set.inserted(), entries.size());
+        QCOMPARE(set.aggregated(), expected);
+    }
+
+    void rejectsNonAddresses() {
+        CidrSet set;
+        QVERIFY(!set.add("example.com"));
+        QVERIFY(!set.add("10.0.0.0/40"));
+        QVERIFY(set.add("10.0.0.0/8"));
+        QCOMPARE(set.inserted(), 1);
+        QCOMPARE(set.aggregated(), QStringList{"10.0.0.0/8"});
+    }
+};
+
+QTEST_GUILESS_MAIN(TestCidrSet)
+
+#include "tst_cidrset.moc"
@@ -0,0 +1,164 @@
+#include "commandtranscript.h"
+#include <QProcess>
+#include <QTemporaryDir>
+#include <QtTest>
+
+using CommandTranscript::Entry;
+
+namespace {
+    Entry entry(const QStringList &arguments, const QByteArray &out, int exitCode = 0, bool scan = false) {
+        Entry e;
+        e.program = QStringLiteral("warp-cli");
+        e.arguments = arguments;
+        e.exitCode = exitCode;
+        e.out = out;
+        e.latencyMs = 40;
+        e.scan = scan;
+        return e;
+    }
+
+    bool sameCommand(const Entry &a, const Entry &b) {
+        return a.program == b.program && a.arguments == b.arguments && a.exitCode == b.exitCode
+               && a.timedOut == b.timedOut && a.out == b.out && a.err == b.err && a.latencyMs == b.latencyMs
+               && a.scan == b.scan;
+    }
+}
+
+// The transcript mode is picked from the environment once per process: this process records,
+// replayChild() runs in a second copy of it that replays what was recorded here.
+class TestCommandTranscript : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase() {
+        if (qEnvironmentVariableIsSet("WARPQT_REPLAY"))
+            return;
+        QVERIFY(dir.isValid());
+        recordPath = dir.filePath(QStringLiteral("commands.wqt"));
+        qputenv("WARPQT_RECORD", QFile::encodeName(recordPath));
+    }
+
+    void recordAndLoad() {
+        if (recordPath.isEmpty())
+            QSKIP("replaying");
+        QVERIFY(CommandTranscript::isRecording());
+        QVERIFY(!CommandTranscript::isReplaying());
+
+        Entry timedOut = entry({"connect"}, QByteArray(), -1);
+        timedOut.timedOut = true;
+        timedOut.err = "still waiting";
+        recorded = {
+            entry({"status"}, "Status update: Connected\n"),
+            entry({"status"}, "Status update: Disconnected\n"),
+            // long enough to be stored compressed
+            entry({"tunnel", "ip", "list"}, QByteArray("  10.0.0.0/8\n").repeated(500)),
+            entry({"settings"}, "Mode: Warp\n", 0, true),
+            entry({"settings"}, "Merged configuration:\nMode: Warp\nAlways On: true\n"),
+            timedOut,
+        };
+        for (const Entry &e : recorded)
+            CommandTranscript::record(e);
+
+        bool ok = false;
+        const QVector<Entry> loaded = CommandTranscript::load(recordPath, &ok);
+        QVERIFY(ok);
+        QCOMPARE(loaded.size(), recorded.size());
+        for (int i = 0; i < loaded.size(); ++i) {
+            QVERIFY2(sameCommand(loaded.at(i), recorded.at(i)), qPrintable(QString("entry %1").arg(i)));
+            if (i > 0)
+                QVERIFY(loaded.at(i).offsetMs >= loaded.at(i - 1).offsetMs);
+        }
+        // compressed on disk
+        QVERIFY(QFileInfo(recordPath).size() < recorded.at(2).out.size());
+    }
+
+    // a record cut short by a crash ends the transcript, the ones before it still load
+    void tornRecord() {
+        if (recordPath.isEmpty())
+            QSKIP("replaying");
+        QFile full(recordPath);
+        QVERIFY(full.open(QIODevice::ReadOnly));
+        const QByteArray data = full.readAll();
+        QFile torn(dir.filePath(QStringLiteral("torn.wqt")));
+        QVERIFY(torn.open(QIODevice::WriteOnly));
+        torn.write(data.left(data.size() - 7));
+        torn.close();
+
+        bool ok = false;
+        const QVector<Entry> loaded = CommandTranscript::load(torn.fileName(), &ok);
+        QVERIFY(ok);
+        QCOMPARE(loaded.size(), recorded.size() - 1);
+    }
+
+    void notATranscript() {
+        if (recordPath.isEmpty())
+            QSKIP("replaying");
+        QFile other(dir.filePath(QStringLiteral("other.txt")));
+        QVERIFY(other.open(QIODevice::WriteOnly));
+        other.write("Status update: Connected\n");
+        other.close();
+        bool ok = true;
+        QVERIFY(CommandTranscript::load(other.fileName(), &ok).isEmpty());
+        QVERIFY(!ok);
+        QVERIFY(CommandTranscript::load(dir.filePath(QStringLiteral("missing.wqt")), &ok).isEmpty());
+        QVERIFY(!ok);
+    }
+
+    void replay() {
+        if (recordPath.isEmpty())
+            QSKIP("replaying");
+        QProcess child;
+        QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+        env.remove(QStringLiteral("WARPQT_RECORD"));
+        env.insert(QStringLiteral("WARPQT_REPLAY"), recordPath);
+        env.insert(QStringLiteral("WARPQT_REPLAY_SPEED"), QStringLiteral("0"));
+        child.setProcessEnvironment(env);
+        child.setProcessChannelMode(QProcess::ForwardedChannels);
+        child.start(QCoreApplication::applicationFilePath(), {QStringLiteral("replayChild")});
+        QVERIFY(child.waitForFinished(30000));
+        QCOMPARE(child.exitStatus(), QProcess::NormalExit);
+        QCOMPARE(child.exitCode(), 0);
+    }
+
+    // only does something in the copy started by replay()
+    void replayChild() {
+        if (!qEnvironmentVariableIsSet("WARPQT_REPLAY"))
+            QSKIP("run by replay()");
+        QVERIFY(CommandTranscript::isReplaying());
+        QVERIFY(!CommandTranscript::isRecording());
+
+        Entry e;
+        // served in recorded order, the last one repeats
+        QVERIFY(CommandTranscript::take("warp-cli", {"status"}, e));
+        QCOMPARE(e.out, QByteArray("Status update: Connected\n"));
+        QVERIFY(CommandTranscript::take("warp-cli", {"status"}, e));
+        QCOMPARE(e.out, QByteArray("Status update: Disconnected\n"));
+        QVERIFY(CommandTranscript::replay("warp-cli", {"status"}, e));
+        QCOMPARE(e.out, QByteArray("Status update: Disconnected\n"));
+
+        // a scan and a full run of the same command are kept apart
+        QVERIFY(CommandTranscript::take("warp-cli", {"settings"}, e, true));
+        QVERIFY(e.scan);
+        QCOMPARE(e.out, QByteArray("Mode: Warp\n"));
+        QVERIFY(CommandTranscript::take("warp-cli", {"settings"}, e));
+        QVERIFY(!e.scan);
+        QVERIFY(e.out.startsWith("Merged configuration:"));
+
+        QVERIFY(CommandTranscript::take("warp-cli", {"connect"}, e));
+        QVERIFY(e.timedOut);
+        QCOMPARE(e.err, QByteArray("still waiting"));
+
+        QVERIFY(!CommandTranscript::take("warp-cli", {"disconnect"}, e));
+        QVERIFY(!CommandTranscript::take("warp-cli", {"status"}, e, true));
+        QCOMPARE(CommandTranscript::replayDelayMs(e), 0);
+    }
+
+private:
+    QTemporaryDir dir;
+    QString recordPath;
+    QVector<Entry> recorded;
+};
+
+QTEST_GUILESS_MAIN(TestCommandTranscript)
+
+#include "tst_commandtranscript.moc"
@@ -0,0 +1,224 @@
+#include "dnsbenchmark.h"
+#include <QSet>
+#include <QSocketNotifier>
+#include <QTimer>
+#include <QtTest>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+    constexpr int kColdDelayMs = 30;
+
+    // a caching resolver on 127.0.0.1: names it has not seen are answered after
+    // kColdDelayMs, repeated names straight away. stray replies test the id matching
+    class FakeResolver : public QObject {
+    public:
+        bool dropFirstSeen = false;
+        bool sendStrays = false;
+        int received = 0;
+        quint16 port = 0;
+
+        FakeResolver() {
+            fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            socklen_t len = sizeof(addr);
+            if (fd < 0 || ::bind(fd, reinterpret_cast<sockaddr *>(&addr), len) < 0 ||
+                ::getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &len) < 0)
+                return;
+            port = ntohs(addr.sin_port);
+            auto *notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+            connect(notifier, &QSocketNotifier::activated, this, [this] { onReadable(); });
+        }
+
+        ~FakeResolver() override {
+            if (fd >= 0)
+                ::close(fd);
+        }
+
+        QString address() const {
+            return QString("127.0.0.1:%1").arg(port);
+        }
+
+    private:
+        void onReadable() {
+            char buf[1500];
+            sockaddr_storage from{};
+            socklen_t fromLen = sizeof(from);
+            ssize_t n;
+            while ((n = ::recvfrom(fd, buf, sizeof(buf), 0, reinterpret_cast<sockaddr *>(&from), &fromLen)) >= 12) {
+                ++received;
+                QByteArray reply(buf, static_cast<int>(n));
+                reply[2] = static_cast<char>(reply[2] | 0x80);
+                const QByteArray question = reply.mid(12);
+                if (!cache.contains(question)) {
+                    cache.insert(question);
+                    if (dropFirstSeen)
+                        continue;
+                    QTimer::singleShot(kColdDelayMs, this, [this, reply, from, fromLen] { sendTo(reply, from, fromLen); });
+                    continue;
+                }
+                if (sendStrays) {
+                    // the same query answered with the other round's id, and an id past the batch
+                    QByteArray other = reply;
+                    other[0] = static_cast<char>(other[0] ^ 0x80);
+                    sendTo(other, from, fromLen);
+                    QByteArray outside = reply;
+                    outside[0] = static_cast<char>((outside[0] & 0x80) | 0x7f);
+                    sendTo(outside, from, fromLen);
+                }
+                sendTo(reply, from, fromLen);
+                // a duplicate answer must not count twice
+                sendTo(reply, from, fromLen);
+            }
+        }
+
+        void sendTo(const QByteArray &data, const sockaddr_storage &to, socklen_t toLen) {
+            ::sendto(fd, data.constData(), data.size(), 0, reinterpret_cast<const sockaddr *>(&to), toLen);
+        }
+
+        int fd = -1;
+        QSet<QByteArray> cache;
+    };
+}
+
+class TestDnsBenchmark : public QObject {
+    Q_OBJECT
+
+private slots:
+    void serverSpec() {
+        DnsBenchmark bench;
+        QVERIFY(bench.setServer("127.0.2.2"));
+        QCOMPARE(bench.server(), QStringLiteral("127.0.2.2"));
+        QVERIFY(bench.setServer(" 127.0.0.1:5353 "));
+        QCOMPARE(bench.server(), QStringLiteral("127.0.0.1:5353"));
+        QVERIFY(!bench.setServer("127.0.0.1:0"));
+        QVERIFY(!bench.setServer("localhost"));
+    }
+
+    void percentiles() {
+        QVector<quint32> values;
+        for (quint32 v = 100; v >= 1; --v)
+            values.append(v);
+        const LatencyStats s = LatencyStats::compute(values.data(), values.size());
+        QCOMPARE(s.count, 100);
+        QCOMPARE(s.min, 1u);
+        QCOMPARE(s.median, 50u);
+        QCOMPARE(s.p95, 95u);
+        QCOMPARE(s.p99, 99u);
+        QCOMPARE(s.max, 100u);
+
+        quint32 few[] = {30, 10, 20};
+        const LatencyStats small = LatencyStats::compute(few, 3);
+        QCOMPARE(small.median, 20u);
+        QCOMPARE(small.p95, 30u);
+        QCOMPARE(LatencyStats::compute(few, 0).count, 0);
+    }
+
+    void coldAndWarmRounds() {
+        FakeResolver resolver;
+        QVERIFY(resolver.port != 0);
+        resolver.sendStrays = true;
+        DnsBenchmark bench;
+        QVERIFY(bench.setServer(resolver.address()));
+        QSignalSpy progress(&bench, &DnsBenchmark::progress);
+        QSignalSpy finished(&bench, &DnsBenchmark::finished);
+
+        const int queries = 50;
+        bench.start(queries);
+        QVERIFY(bench.isRunning());
+        QTRY_COMPARE(finished.count(), 1);
+        QVERIFY(finished.at(0).at(0).toBool());
+        QVERIFY(!bench.isRunning());
+        QCOMPARE(resolver.received, 2 * queries);
+
+        int lastCold = 0;
+        int lastWarm = 0;
+        for (const QList<QVariant> &args : progress) {
+            const int answered = args.at(0).toInt();
+            QCOMPARE(args.at(1).toInt(), queries);
+            QVERIFY(answered <= queries);
+            if (args.at(2).toBool()) {
+                lastWarm = answered;
+            } else {
+                // no warm answer shows up before the cold round is done
+                QCOMPARE(lastWarm, 0);
+                lastCold = answered;
+            }
+        }
+        QCOMPARE(lastCold, queries);
+        QCOMPARE(lastWarm, queries);
+
+        const DnsBenchmark::Result r = bench.result();
+        QCOMPARE(r.sent, queries);
+        QCOMPARE(r.coldLost, 0);
+        QCOMPARE(r.warmLost, 0);
+        QCOMPARE(r.cold.count, queries);
+        QCOMPARE(r.warm.count, queries);
+        // a little slack for a timer firing early
+        QVERIFY(r.cold.min >= (kColdDelayMs - 5) * 1000u);
+        QVERIFY(r.warm.median < r.cold.min);
+        for (const LatencyStats &s : {r.cold, r.warm}) {
+            QVERIFY(s.min <= s.median);
+            QVERIFY(s.median <= s.p95);
+            QVERIFY(s.p95 <= s.p99);
+            QVERIFY(s.p99 <= s.max);
+        }
+    }
+
+    // unanswered cold queries are counted lost once the round times out
+    void lostAnswers() {
+        FakeResolver resolver;
+        QVERIFY(resolver.port != 0);
+        resolver.dropFirstSeen = true;
+        DnsBenchmark bench;
+        QVERIFY(bench.setServer(resolver.address()));
+        QSignalSpy finished(&bench, &DnsBenchmark::finished);
+
+        bench.start(10);
+        QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 1, 10000);
+        QVERIFY(finished.at(0).at(0).toBool());
+        const DnsBenchmark::Result r = bench.result();
+        QCOMPARE(r.coldLost, 10);
+        QCOMPARE(r.cold.count, 0);
+        QCOMPARE(r.warmLost, 0);
+        QCOMPARE(r.warm.count, 10);
+    }
+
+    void nothingListening() {
+        quint16 port;
+        {
+            FakeResolver closed;
+            port = closed.port;
+        }
+        QVERIFY(port != 0);
+        DnsBenchmark bench;
+        QVERIFY(bench.setServer(QString("127.0.0.1:%1").arg(port)));
+        QSignalSpy finished(&bench, &DnsBenchmark::finished);
+        bench.start(5);
+        QTRY_COMPARE(finished.count(), 1);
+        QVERIFY(!finished.at(0).at(0).toBool());
+        QVERIFY(!bench.lastError().isEmpty());
+    }
+
+    void cancelled() {
+        FakeResolver resolver;
+        resolver.dropFirstSeen = true;
+        DnsBenchmark bench;
+        QVERIFY(bench.setServer(resolver.address()));
+        QSignalSpy finished(&bench, &DnsBenchmark::finished);
+        bench.start(5);
+        bench.cancel();
+        QCOMPARE(finished.count(), 1);
+        QVERIFY(!finished.at(0).at(0).toBool());
+        QCOMPARE(bench.lastError(), QStringLiteral("Cancelled"));
+        QVERIFY(!bench.isRunning());
+    }
+};
+
+QTEST_GUILESS_MAIN(TestDnsBenchmark)
+
+#include "tst_dnsbenchmark.moc"
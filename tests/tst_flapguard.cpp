@@ -0,0 +1,122 @@
+#include "flapguard.h"
+#include <QtTest>
+
+class TestFlapGuard : public QObject {
+    Q_OBJECT
+
+private slots:
+    void firstReportShownAtOnce() {
+        FlapGuard guard(false);
+        QSignalSpy changed(&guard, &FlapGuard::stateChanged);
+        guard.reportState(true);
+        QCOMPARE(changed.count(), 1);
+        QVERIFY(guard.displayedState());
+    }
+
+    void changeShownAfterHold() {
+        FlapGuard guard(true);
+        guard.setHoldMs(50, 5000);
+        guard.reportState(true);
+        QSignalSpy changed(&guard, &FlapGuard::stateChanged);
+        guard.reportState(false);
+        QVERIFY(guard.displayedState());
+        QTRY_COMPARE(changed.count(), 1);
+        QCOMPARE(changed.at(0).at(0).toBool(), false);
+        QVERIFY(!guard.displayedState());
+    }
+
+    void bounceIsSwallowed() {
+        FlapGuard guard(true);
+        guard.setHoldMs(100, 5000);
+        guard.reportState(true);
+        QSignalSpy changed(&guard, &FlapGuard::stateChanged);
+        guard.reportState(false);
+        guard.reportState(true);
+        QTest::qWait(250);
+        QCOMPARE(changed.count(), 0);
+        QVERIFY(guard.displayedState());
+    }
+
+    void commitSkipsHold() {
+        FlapGuard guard(false);
+        guard.setHoldMs(5000, 5000);
+        guard.reportState(false);
+        QSignalSpy changed(&guard, &FlapGuard::stateChanged);
+        guard.commitState(true);
+        QCOMPARE(changed.count(), 1);
+        QVERIFY(guard.displayedState());
+    }
+
+    // enough transitions inside the window switch to the long hold
+    void flappingHoldsLonger() {
+        FlapGuard guard(false);
+        guard.setHoldMs(20, 400);
+        guard.setFlapThreshold(4, 60000);
+        QSignalSpy flappingSpy(&guard, &FlapGuard::flappingChanged);
+        guard.reportState(true);
+        guard.reportState(false);
+        guard.reportState(true);
+        QVERIFY(!guard.isFlapping());
+        guard.reportState(false);
+        QVERIFY(guard.isFlapping());
+        QCOMPARE(flappingSpy.count(), 1);
+
+        QTest::qWait(150);
+        QVERIFY(guard.displayedState());
+        QTRY_VERIFY_WITH_TIMEOUT(!guard.displayedState(), 2000);
+    }
+
+    void flappingEndsWithWindow() {
+        FlapGuard guard(false);
+        guard.setFlapThreshold(2, 150);
+        QSignalSpy flappingSpy(&guard, &FlapGuard::flappingChanged);
+        guard.reportState(true);
+        guard.reportState(false);
+        QVERIFY(guard.isFlapping());
+        QTRY_VERIFY_WITH_TIMEOUT(!guard.isFlapping(), 2000);
+        QCOMPARE(flappingSpy.count(), 2);
+    }
+
+    // the first error goes out, the rest of the burst becomes one summary at the window's end
+    void errorsCoalesced() {
+        FlapGuard guard(false);
+        guard.setCoalesceMs(100);
+        QStringList messages;
+        connect(&guard, &FlapGuard::notify, this,
+                [&messages](FlapGuard::Severity, const QString &, const QString &message) {
+                    messages << message;
+                });
+        for (int i = 0; i < 5; ++i)
+            guard.reportError("Warp Connect Error", QString("failure %1").arg(i));
+        QCOMPARE(messages.size(), 1);
+        QCOMPARE(messages.at(0), QStringLiteral("failure 0"));
+
+        QTRY_COMPARE(messages.size(), 2);
+        QVERIFY(messages.at(1).startsWith(QStringLiteral("4 more errors")));
+        QVERIFY(messages.at(1).endsWith(QStringLiteral("failure 4")));
+
+        // a quiet window ends the burst, the next error is shown right away again
+        QTest::qWait(250);
+        QCOMPARE(messages.size(), 2);
+        guard.reportError("Warp Connect Error", "after");
+        QCOMPARE(messages.size(), 3);
+    }
+
+    void singleSuppressedErrorShownAsIs() {
+        FlapGuard guard(false);
+        guard.setCoalesceMs(50);
+        QStringList messages;
+        connect(&guard, &FlapGuard::notify, this,
+                [&messages](FlapGuard::Severity, const QString &, const QString &message) {
+                    messages << message;
+                });
+        guard.reportError("title", "one");
+        guard.reportError("title", "two");
+        QTRY_COMPARE(messages.size(), 2);
+        QCOMPARE(messages.at(1), QStringLiteral("two"));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestFlapGuard)
+
+#include "tst_flapguard.moc"
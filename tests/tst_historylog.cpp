@@ -0,0 +1,175 @@
+#include "historylog.h"
+#include <QDateTime>
+#include <QTemporaryDir>
+#include <QtTest>
+
+using State = HistoryLog::State;
+using Cause = HistoryLog::Cause;
+
+namespace {
+    HistoryLog::Record record(qint64 timestampMs, State oldState, State newState, quint32 latencyMs = 0) {
+        HistoryLog::Record rec{};
+        rec.timestampMs = timestampMs;
+        rec.latencyMs = latencyMs;
+        rec.oldState = static_cast<quint8>(oldState);
+        rec.newState = static_cast<quint8>(newState);
+        rec.mode = static_cast<quint8>(WarpMode::Warp);
+        rec.cause = static_cast<quint8>(Cause::External);
+        return rec;
+    }
+
+    // records with made up timestamps, as an earlier run would have left them
+    void writeRecords(const QString &path, const QVector<HistoryLog::Record> &records) {
+        QFile f(path);
+        QVERIFY(f.open(QIODevice::WriteOnly | QIODevice::Append));
+        for (const HistoryLog::Record &rec : records)
+            f.write(reinterpret_cast<const char *>(&rec), sizeof(rec));
+    }
+}
+
+class TestHistoryLog : public QObject {
+    Q_OBJECT
+
+private slots:
+    void init() {
+        QVERIFY(dir.isValid());
+        path = dir.filePath(QString("history-%1.bin").arg(++counter));
+    }
+
+    void countsTransitions() {
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        writeRecords(path, {
+                         record(now - 30000, State::Disconnected, State::Connected, 800),
+                         record(now - 20000, State::Connected, State::Disconnected),
+                         record(now - 15000, State::Disconnected, State::Failed),
+                         record(now - 10000, State::Disconnected, State::Connected, 400),
+                         record(now - 5000, State::Connected, State::Disconnected),
+                     });
+        const HistoryLog::Stats s = HistoryLog(path).stats(60000);
+        QCOMPARE(s.windowMs, qint64(60000));
+        QCOMPARE(s.connects, 2);
+        QCOMPARE(s.disconnects, 2);
+        QCOMPARE(s.failures, 1);
+        QCOMPARE(s.timedConnects, 2);
+        QCOMPARE(s.averageConnectMs(), qint64(600));
+        QCOMPARE(s.connectedMs, qint64(15000));
+        QCOMPARE(s.failureRate(), 1.0 / 3.0);
+    }
+
+    // the state going into the window counts from the window's start
+    void clipsToWindow() {
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        writeRecords(path, {
+                         record(now - 10000, State::Disconnected, State::Connected),
+                         record(now - 4000, State::Connected, State::Disconnected),
+                     });
+        const HistoryLog::Stats s = HistoryLog(path).stats(5000);
+        QCOMPARE(s.connects, 0);
+        QCOMPARE(s.disconnects, 1);
+        // about 1 s, less the time between now and the stats() call
+        QVERIFY(s.connectedMs > 900 && s.connectedMs <= 1000);
+    }
+
+    void readsRotatedFile() {
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        writeRecords(path + ".1", {record(now - 10000, State::Disconnected, State::Connected)});
+        writeRecords(path, {record(now - 4000, State::Connected, State::Disconnected)});
+        const HistoryLog::Stats s = HistoryLog(path).stats(60000);
+        QCOMPARE(s.connects, 1);
+        QCOMPARE(s.disconnects, 1);
+        QCOMPARE(s.connectedMs, qint64(6000));
+    }
+
+    // without a writer in this process nothing vouches for the time after the last record
+    void readerStopsAtLastRecord() {
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        writeRecords(path, {
+                         record(now - 10000, State::Disconnected, State::Connected),
+                         record(now - 8000, State::Connected, State::Failed),
+                     });
+        const HistoryLog::Stats s = HistoryLog(path).stats(60000);
+        QCOMPARE(s.failures, 1);
+        QCOMPARE(s.connectedMs, qint64(2000));
+    }
+
+    void writerRunsOnToNow() {
+        HistoryLog writer(path);
+        writer.append(State::Disconnected, State::Connected, WarpMode::Warp, Cause::User, 0);
+        QTest::qSleep(60);
+        QVERIFY(writer.stats(60000).connectedMs >= 50);
+        QCOMPARE(HistoryLog(path).stats(60000).connectedMs, qint64(0));
+    }
+
+    // a stop ends connected time without counting as a disconnect, the startup record after it
+    // sets the state without counting as a connect
+    void stopAndStartup() {
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        writeRecords(path, {
+                         record(now - 50000, State::Disconnected, State::Connected),
+                         record(now - 40000, State::Connected, State::Stopped),
+                         // not running for 20 s
+                         record(now - 20000, State::Stopped, State::Connected),
+                         record(now - 15000, State::Connected, State::Stopped),
+                     });
+        const HistoryLog::Stats s = HistoryLog(path).stats(60000);
+        QCOMPARE(s.connects, 1);
+        QCOMPARE(s.disconnects, 0);
+        QCOMPARE(s.connectedMs, qint64(15000));
+    }
+
+    void stoppedWriterDoesNotRunOn() {
+        HistoryLog writer(path);
+        writer.append(State::Disconnected, State::Connected, WarpMode::Warp, Cause::User, 0);
+        QTest::qSleep(30);
+        writer.append(State::Connected, State::Stopped, WarpMode::Warp, Cause::Unknown, 30);
+        const qint64 atStop = writer.stats(60000).connectedMs;
+        QTest::qSleep(60);
+        QCOMPARE(writer.stats(60000).connectedMs, atStop);
+
+        // running again from here on
+        writer.append(State::Stopped, State::Connected, WarpMode::Warp, Cause::External, 0);
+        QTest::qSleep(60);
+        const HistoryLog::Stats s = writer.stats(60000);
+        QVERIFY(s.connectedMs >= atStop + 50);
+        QCOMPARE(s.connects, 1);
+    }
+
+    void lastTransitionSkipsStops() {
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        writeRecords(path, {
+                         record(now - 50000, State::Disconnected, State::Connected),
+                         record(now - 40000, State::Connected, State::Stopped),
+                         record(now - 30000, State::Stopped, State::Connected),
+                         record(now - 20000, State::Connected, State::Failed),
+                     });
+        HistoryLog::Record rec{};
+        QVERIFY(HistoryLog(path).lastTransition(rec));
+        // found connected again at startup, the connect before the stop is still the last one
+        QCOMPARE(rec.timestampMs, now - 50000);
+
+        writeRecords(path, {
+                         record(now - 10000, State::Connected, State::Stopped),
+                         record(now - 5000, State::Stopped, State::Disconnected),
+                     });
+        QVERIFY(HistoryLog(path).lastTransition(rec));
+        // changed while not running, the startup record is as close as it gets
+        QCOMPARE(rec.timestampMs, now - 5000);
+    }
+
+    void emptyLog() {
+        const HistoryLog::Stats s = HistoryLog(path).stats(60000);
+        QCOMPARE(s.connectedMs, qint64(0));
+        QCOMPARE(s.averageConnectMs(), qint64(-1));
+        HistoryLog::Record rec{};
+        QVERIFY(!HistoryLog(path).lastTransition(rec));
+    }
+
+private:
+    QTemporaryDir dir;
+    QString path;
+    int counter = 0;
+};
+
+QTEST_GUILESS_MAIN(TestHistoryLog)
+
+#include "tst_historylog.moc"
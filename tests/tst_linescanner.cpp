@@ -0,0 +1,122 @@
+#include "linescanner.h"
+#include <QtTest>
+
+namespace {
+    const QByteArray kSettings = "Merged configuration:\n"
+            "Mode: WarpProxy\tPort: 40000\n"
+            "Always On: true\n"
+            "Excluded hosts:\n"
+            "  example.com\n";
+
+    void feed(LineScanner &scanner, const QByteArray &data) {
+        scanner.feed(data.constData(), data.size());
+    }
+}
+
+class TestLineScanner : public QObject {
+    Q_OBJECT
+
+private slots:
+    void wholeBuffer() {
+        LineScanner scanner;
+        const int mode = scanner.addField("Mode:");
+        const int always = scanner.addField("Always On:");
+        QVERIFY(scanner.feed(kSettings.constData(), kSettings.size()));
+        QCOMPARE(scanner.line(mode), QStringLiteral("Mode: WarpProxy\tPort: 40000"));
+        QCOMPARE(scanner.line(always), QStringLiteral("Always On: true"));
+    }
+
+    // the same output cut at every possible point, lines and patterns split across chunks
+    void chunkSplits() {
+        for (int cut = 1; cut < kSettings.size(); ++cut) {
+            LineScanner scanner;
+            const int mode = scanner.addField("Mode:");
+            const int always = scanner.addField("Always On:");
+            scanner.feed(kSettings.constData(), cut);
+            scanner.feed(kSettings.constData() + cut, kSettings.size() - cut);
+            scanner.finish();
+            QVERIFY2(scanner.done(), qPrintable(QString("cut at %1").arg(cut)));
+            QCOMPARE(scanner.line(mode), QStringLiteral("Mode: WarpProxy\tPort: 40000"));
+            QCOMPARE(scanner.line(always), QStringLiteral("Always On: true"));
+        }
+    }
+
+    void byteAtATime() {
+        LineScanner scanner;
+        const int mode = scanner.addField("Mode:");
+        for (char c : kSettings)
+            scanner.feed(&c, 1);
+        QCOMPARE(scanner.line(mode), QStringLiteral("Mode: WarpProxy\tPort: 40000"));
+    }
+
+    void firstMatchWins() {
+        LineScanner scanner;
+        const int field = scanner.addField("Mode:");
+        feed(scanner, "Mode: first\nMode: second\n");
+        QCOMPARE(scanner.line(field), QStringLiteral("Mode: first"));
+    }
+
+    void stopsWhenDone() {
+        LineScanner scanner;
+        scanner.addField("Mode:");
+        QVERIFY(!scanner.feed("Status: up\n", 11));
+        QVERIFY(scanner.feed("Mode: Warp\n", 11));
+        QVERIFY(scanner.done());
+    }
+
+    // a line that goes over the cap while being buffered is dropped up to its newline
+    void overLongLineCapped() {
+        LineScanner scanner(64);
+        const int field = scanner.addField("Mode:");
+        const QByteArray longLine = "Mode: " + QByteArray(100, 'x');
+        feed(scanner, longLine.left(30));
+        feed(scanner, longLine.mid(30) + "\n");
+        QVERIFY(!scanner.done());
+        QVERIFY(scanner.line(field).isEmpty());
+
+        // the next line is matched normally again
+        feed(scanner, "Mode: Warp\n");
+        QCOMPARE(scanner.line(field), QStringLiteral("Mode: Warp"));
+    }
+
+    void overLongLineAcrossManyChunks() {
+        LineScanner scanner(16);
+        const int field = scanner.addField("Mode:");
+        feed(scanner, "Mode: ");
+        for (int i = 0; i < 100; ++i)
+            feed(scanner, "yyyyyyyy");
+        feed(scanner, "\nMode: ok");
+        scanner.finish();
+        QCOMPARE(scanner.line(field), QStringLiteral("Mode: ok"));
+    }
+
+    void finishMatchesLastLine() {
+        LineScanner scanner;
+        const int field = scanner.addField("Always On:");
+        feed(scanner, "Mode: Warp\nAlways On: false");
+        QVERIFY(!scanner.done());
+        scanner.finish();
+        QVERIFY(scanner.done());
+        QCOMPARE(scanner.line(field), QStringLiteral("Always On: false"));
+    }
+
+    void finishDropsOverLongTail() {
+        LineScanner scanner(8);
+        const int field = scanner.addField("Mode:");
+        feed(scanner, "Mode:");
+        feed(scanner, " much too long");
+        scanner.finish();
+        QVERIFY(!scanner.done());
+        QVERIFY(scanner.line(field).isEmpty());
+    }
+
+    void unknownField() {
+        LineScanner scanner;
+        QVERIFY(scanner.line(0).isEmpty());
+        QVERIFY(scanner.line(-1).isEmpty());
+    }
+};
+
+QTEST_GUILESS_MAIN(TestLineScanner)
+
+#include "tst_linescanner.moc"
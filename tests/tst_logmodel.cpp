@@ -0,0 +1,110 @@
+#include "logmodel.h"
+#include <QtTest>
+
+namespace {
+    QStringList numbered(const QString &prefix, int from, int count) {
+        QStringList lines;
+        for (int i = from; i < from + count; ++i)
+            lines << prefix + QString::number(i);
+        return lines;
+    }
+
+    QStringList rows(const LogModel &model) {
+        QStringList out;
+        for (int row = 0; row < model.rowCount(); ++row)
+            out << model.data(model.index(row)).toString();
+        return out;
+    }
+}
+
+class TestLogModel : public QObject {
+    Q_OBJECT
+
+private slots:
+    void evictsOldest() {
+        LogModel model(5);
+        model.appendLines(numbered("l", 0, 3));
+        QCOMPARE(model.rowCount(), 3);
+
+        QSignalSpy removed(&model, &QAbstractItemModel::rowsRemoved);
+        QSignalSpy inserted(&model, &QAbstractItemModel::rowsInserted);
+        model.appendLines(numbered("l", 3, 4));
+        QCOMPARE(model.rowCount(), 5);
+        QCOMPARE(model.bufferedLines(), 5);
+        QCOMPARE(rows(model), numbered("l", 2, 5));
+
+        // evicted rows go first, in one batch, then the new ones after what is left
+        QCOMPARE(removed.count(), 1);
+        QCOMPARE(removed.at(0).at(1).toInt(), 0);
+        QCOMPARE(removed.at(0).at(2).toInt(), 1);
+        QCOMPARE(inserted.count(), 1);
+        QCOMPARE(inserted.at(0).at(1).toInt(), 1);
+        QCOMPARE(inserted.at(0).at(2).toInt(), 4);
+    }
+
+    void burstLargerThanCapacity() {
+        LogModel model(5);
+        model.appendLines(numbered("a", 0, 2));
+        model.appendLines(numbered("b", 0, 12));
+        QCOMPARE(rows(model), numbered("b", 7, 5));
+    }
+
+    void wrapsManyTimes() {
+        LogModel model(7);
+        for (int i = 0; i < 100; ++i)
+            model.appendLines(numbered("n", i * 3, 3));
+        QCOMPARE(model.bufferedLines(), 7);
+        QCOMPARE(rows(model), numbered("n", 293, 7));
+    }
+
+    void filteredEviction() {
+        LogModel model(4);
+        model.setFilter("x");
+        model.appendLines({"x0", "a", "x1", "b"});
+        QCOMPARE(rows(model), (QStringList{"x0", "x1"}));
+
+        // pushes out x0 and a, only x0 was visible
+        QSignalSpy removed(&model, &QAbstractItemModel::rowsRemoved);
+        model.appendLines({"c", "X2"});
+        QCOMPARE(rows(model), (QStringList{"x1", "X2"}));
+        QCOMPARE(removed.count(), 1);
+        QCOMPARE(removed.at(0).at(2).toInt(), 0);
+
+        model.appendLines({"d"});
+        QCOMPARE(removed.count(), 2);
+        QCOMPARE(rows(model), QStringList{"X2"});
+
+        // b goes, it was never visible so no rows are removed
+        model.appendLines({"e"});
+        QCOMPARE(removed.count(), 2);
+        QCOMPARE(rows(model), QStringList{"X2"});
+    }
+
+    void filterSeesOnlyBufferedLines() {
+        LogModel model(3);
+        model.appendLines({"x0", "x1", "a", "x2"});
+        model.setFilter("x");
+        QCOMPARE(rows(model), (QStringList{"x1", "x2"}));
+        model.setFilter(QString());
+        QCOMPARE(rows(model), (QStringList{"x1", "a", "x2"}));
+    }
+
+    void longLinesCut() {
+        LogModel model(2);
+        model.appendLines({QString(100000, QLatin1Char('z'))});
+        QCOMPARE(model.data(model.index(0)).toString().size(), 4096);
+    }
+
+    void clearStartsOver() {
+        LogModel model(3);
+        model.appendLines(numbered("l", 0, 5));
+        model.clear();
+        QCOMPARE(model.rowCount(), 0);
+        model.appendLines({"new"});
+        QCOMPARE(rows(model), QStringList{"new"});
+    }
+};
+
+QTEST_GUILESS_MAIN(TestLogModel)
+
+#include "tst_logmodel.moc"
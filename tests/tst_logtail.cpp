@@ -0,0 +1,103 @@
+#include "logtail.h"
+#include <QTemporaryDir>
+#include <QtTest>
+
+namespace {
+    void append(const QString &path, const QByteArray &data) {
+        QFile f(path);
+        QVERIFY(f.open(QIODevice::WriteOnly | QIODevice::Append));
+        f.write(data);
+    }
+}
+
+// follows a synthetic log file the way warp-svc's is written: appended to, truncated, rotated
+class TestLogTail : public QObject {
+    Q_OBJECT
+
+private slots:
+    void init() {
+        QVERIFY(dir.isValid());
+        path = dir.filePath(QString("warp-%1.log").arg(++counter));
+        lines.clear();
+    }
+
+    void backlogAndAppend() {
+        append(path, "one\ntwo\n");
+        LogTail tail;
+        follow(tail);
+        QCOMPARE(lines, (QStringList{"one", "two"}));
+
+        append(path, "three\n");
+        QTRY_COMPARE(lines, (QStringList{"one", "two", "three"}));
+
+        // a line written in two parts comes out once it is complete
+        append(path, "fo");
+        QTest::qWait(100);
+        QCOMPARE(lines.size(), 3);
+        append(path, "ur\n");
+        QTRY_COMPARE(lines.last(), QStringLiteral("four"));
+    }
+
+    void backlogLimit() {
+        append(path, "dropped\ncut off line\nkept\n");
+        LogTail tail;
+        connect(&tail, &LogTail::linesAppended, this, [this](const QStringList &l) { lines << l; });
+        tail.followFile(path, 10);
+        QCOMPARE(lines, QStringList{"kept"});
+    }
+
+    void truncated() {
+        append(path, "before truncation\n");
+        LogTail tail;
+        follow(tail);
+        QFile f(path);
+        QVERIFY(f.open(QIODevice::WriteOnly | QIODevice::Truncate));
+        f.write("after\n");
+        f.close();
+        QTRY_COMPARE(lines, (QStringList{"before truncation", "after"}));
+    }
+
+    // rename away, the writer finishes the old file, the new one shows up a little later
+    void rotated() {
+        append(path, "first\n");
+        LogTail tail;
+        follow(tail);
+        QVERIFY(QFile::rename(path, path + ".1"));
+        append(path + ".1", "last of the old file\n");
+        QTest::qWait(200);
+
+        append(path, "new file\n");
+        QTRY_COMPARE(lines, (QStringList{"first", "last of the old file", "new file"}));
+        // and the new file keeps being followed
+        append(path, "more\n");
+        QTRY_COMPARE(lines.last(), QStringLiteral("more"));
+
+        // a second rotation works the same way
+        QVERIFY(QFile::remove(path + ".1"));
+        QVERIFY(QFile::rename(path, path + ".1"));
+        append(path, "third file\n");
+        QTRY_COMPARE(lines.last(), QStringLiteral("third file"));
+    }
+
+    void missingFile() {
+        LogTail tail;
+        QSignalSpy errors(&tail, &LogTail::sourceError);
+        tail.followFile(dir.filePath("missing.log"));
+        QCOMPARE(errors.count(), 1);
+    }
+
+private:
+    void follow(LogTail &tail) {
+        connect(&tail, &LogTail::linesAppended, this, [this](const QStringList &l) { lines << l; });
+        tail.followFile(path, -1);
+    }
+
+    QTemporaryDir dir;
+    QString path;
+    QStringList lines;
+    int counter = 0;
+};
+
+QTEST_GUILESS_MAIN(TestLogTail)
+
+#include "tst_logtail.moc"
@@ -0,0 +1,79 @@
+#include "logmodel.h"
+#include "memoryusage.h"
+#include <QtTest>
+
+// what a popup cycle may leave behind for good, well under one cycle's allocations
+static constexpr qint64 kBudgetBytes = 4 * 1024 * 1024;
+static constexpr int kCycles = 60;
+static constexpr int kWarmupCycles = 3;
+
+class TestMemoryUsage : public QObject {
+    Q_OBJECT
+
+private slots:
+    void residentBytes() {
+        const qint64 rss = MemoryUsage::residentBytes();
+        if (rss < 0)
+            QSKIP("no /proc/self/statm");
+        QVERIFY(rss > 0);
+        // the kept open descriptor is re-read, not stuck at the first value
+        QByteArray block(32 * 1024 * 1024, 'x');
+        QVERIFY(MemoryUsage::residentBytes() > rss + 16 * 1024 * 1024);
+    }
+
+    // The low-memory mode's create -> hide -> release cycle, with a filled log buffer and an
+    // object tree standing in for the popup: freed and trimmed like the release timer does it, and
+    // over a long session the resident size has to come back to where it started.
+    void steadyStateWithinBudget() {
+        if (MemoryUsage::residentBytes() < 0)
+            QSKIP("no /proc/self/statm");
+
+        qint64 baseline = -1;
+        qint64 peak = 0;
+        for (int cycle = 0; cycle < kCycles; ++cycle) {
+            const qint64 rssBefore = runCycle();
+            QCOMPARE(MemoryUsage::lastRelease().rssBeforeBytes, rssBefore);
+            const qint64 rssAfter = MemoryUsage::lastRelease().rssAfterBytes;
+            QVERIFY(rssAfter > 0);
+            if (cycle + 1 == kWarmupCycles)
+                baseline = rssAfter;
+            if (cycle < kWarmupCycles)
+                continue;
+            peak = qMax(peak, rssAfter);
+            QVERIFY2(rssAfter - baseline <= kBudgetBytes,
+                     qPrintable(QString("cycle %1: %2 KiB over the %3 KiB baseline")
+                                .arg(cycle).arg((rssAfter - baseline) / 1024).arg(baseline / 1024)));
+        }
+        qInfo() << "baseline" << baseline / 1024 << "KiB, highest after release" << peak / 1024 << "KiB";
+    }
+
+private:
+    // returns the RSS while everything was still alive
+    static qint64 runCycle() {
+        auto *popup = new QObject;
+        auto *model = new LogModel(20000, popup);
+        for (int i = 0; i < 20; ++i) {
+            auto *child = new QObject(popup);
+            child->setObjectName(QString("child %1").arg(i));
+        }
+        QStringList lines;
+        lines.reserve(1000);
+        for (int batch = 0; batch < 20; ++batch) {
+            lines.clear();
+            for (int i = 0; i < 1000; ++i)
+                lines << QString("%1 warp-svc: batch %2 line %3 ").arg(i).arg(batch).arg(i).repeated(8);
+            model->appendLines(lines);
+        }
+        lines = QStringList();
+
+        const qint64 rssBefore = MemoryUsage::residentBytes();
+        // children included, destroyed() would fire before they are gone
+        delete popup;
+        MemoryUsage::recordRelease(rssBefore);
+        return rssBefore;
+    }
+};
+
+QTEST_GUILESS_MAIN(TestMemoryUsage)
+
+#include "tst_memoryusage.moc"
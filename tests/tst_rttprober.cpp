@@ -0,0 +1,224 @@
+#include "rttprober.h"
+#include <QScopeGuard>
+#include <QSocketNotifier>
+#include <QTimer>
+#include <QtTest>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+    constexpr int kEchoDelayMs = 20;
+
+    // a socket on 127.0.0.1 with an ephemeral port, -1 on failure
+    int loopbackSocket(int type, quint16 &port) {
+        const int fd = ::socket(AF_INET, type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        if (fd < 0 || ::bind(fd, reinterpret_cast<sockaddr *>(&addr), len) < 0 ||
+            ::getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &len) < 0) {
+            if (fd >= 0)
+                ::close(fd);
+            return -1;
+        }
+        port = ntohs(addr.sin_port);
+        return fd;
+    }
+
+    // probes are pinned with SO_BINDTODEVICE, which kernels before 5.7 only allow with CAP_NET_RAW
+    bool canBindToLoopback() {
+        const int fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        const bool ok = fd >= 0 && ::setsockopt(fd, SOL_SOCKET, SO_BINDTODEVICE, "lo", 2) == 0;
+        if (fd >= 0)
+            ::close(fd);
+        return ok;
+    }
+
+    // UDP echo that answers kEchoDelayMs late, after a reply with the wrong id
+    class EchoServer : public QObject {
+    public:
+        bool silent = false;
+        int received = 0;
+        quint16 port = 0;
+
+        EchoServer() {
+            fd = loopbackSocket(SOCK_DGRAM, port);
+            if (fd < 0)
+                return;
+            auto *notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+            connect(notifier, &QSocketNotifier::activated, this, [this] { onReadable(); });
+        }
+
+        ~EchoServer() override {
+            if (fd >= 0)
+                ::close(fd);
+        }
+
+        QString address() const {
+            return QString("127.0.0.1:%1").arg(port);
+        }
+
+    private:
+        void onReadable() {
+            char buf[512];
+            sockaddr_storage from{};
+            socklen_t fromLen = sizeof(from);
+            ssize_t n;
+            while ((n = ::recvfrom(fd, buf, sizeof(buf), 0, reinterpret_cast<sockaddr *>(&from), &fromLen)) >= 2) {
+                ++received;
+                if (silent)
+                    continue;
+                const QByteArray echo(buf, static_cast<int>(n));
+                QByteArray stray = echo;
+                stray[1] = static_cast<char>(stray[1] ^ 0x01);
+                sendTo(stray, from, fromLen);
+                QTimer::singleShot(kEchoDelayMs, this, [this, echo, from, fromLen] { sendTo(echo, from, fromLen); });
+            }
+        }
+
+        void sendTo(const QByteArray &data, const sockaddr_storage &to, socklen_t toLen) {
+            ::sendto(fd, data.constData(), data.size(), 0, reinterpret_cast<const sockaddr *>(&to), toLen);
+        }
+
+        int fd = -1;
+    };
+}
+
+// probes the loopback interface as if it were the tunnel; whatever the direct path
+// does in the sandbox is not looked at
+class TestRttProber : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase() {
+        if (!canBindToLoopback())
+            QSKIP("SO_BINDTODEVICE is not permitted here");
+    }
+
+    void targetSpec() {
+        RttProber prober(QStringLiteral("lo"));
+        QVERIFY(prober.setTarget("1.1.1.1", RttProber::Protocol::Udp));
+        QVERIFY(prober.setTarget("1.1.1.1:5353", RttProber::Protocol::Udp));
+        QVERIFY(prober.setTarget("[2606:4700::1111]:443", RttProber::Protocol::Tcp));
+        QVERIFY(prober.setTarget("[::1]", RttProber::Protocol::Tcp));
+        QVERIFY(!prober.setTarget("[::1", RttProber::Protocol::Tcp));
+        QVERIFY(!prober.setTarget("1.1.1.1:0", RttProber::Protocol::Udp));
+        QVERIFY(!prober.setTarget("one.one.one.one", RttProber::Protocol::Udp));
+    }
+
+    void udpEcho() {
+        EchoServer echo;
+        QVERIFY(echo.port != 0);
+        RttProber prober(QStringLiteral("lo"));
+        prober.setProbeTimeoutMs(500);
+        QVERIFY(prober.setTarget(echo.address(), RttProber::Protocol::Udp));
+        QSignalSpy progress(&prober, &RttProber::progress);
+        QSignalSpy finished(&prober, &RttProber::finished);
+
+        prober.start(5);
+        QVERIFY(prober.isRunning());
+        QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 1, 10000);
+        QVERIFY(!prober.isRunning());
+        // a direct path without a default route is skipped without progress
+        QVERIFY(progress.count() >= 5);
+        QCOMPARE(progress.last().at(1).toInt(), 10);
+
+        const RttProber::Path tunnel = RttProber::Path::Tunnel;
+        QVERIFY(prober.lastError(tunnel).isEmpty());
+        QCOMPARE(prober.history(tunnel).size(), std::size_t(5));
+        QCOMPARE(prober.lost(tunnel), 0);
+        const LatencyStats s = prober.stats(tunnel);
+        QCOMPARE(s.count, 5);
+        // the stray reply with the wrong id came back first and was not taken for the answer
+        QVERIFY(s.min >= (kEchoDelayMs - 5) * 1000u);
+        expectStatsOfHistory(prober, tunnel);
+    }
+
+    void tcpHandshake() {
+        quint16 port = 0;
+        const int listener = loopbackSocket(SOCK_STREAM, port);
+        QVERIFY(listener >= 0);
+        auto closeListener = qScopeGuard([listener] { ::close(listener); });
+        QVERIFY(::listen(listener, 16) == 0);
+
+        RttProber prober(QStringLiteral("lo"));
+        prober.setProbeTimeoutMs(500);
+        QVERIFY(prober.setTarget(QString("127.0.0.1:%1").arg(port), RttProber::Protocol::Tcp));
+        QSignalSpy finished(&prober, &RttProber::finished);
+        prober.start(5);
+        QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 1, 10000);
+
+        QCOMPARE(prober.lost(RttProber::Path::Tunnel), 0);
+        QCOMPARE(prober.stats(RttProber::Path::Tunnel).count, 5);
+        expectStatsOfHistory(prober, RttProber::Path::Tunnel);
+    }
+
+    void unansweredProbesAreLost() {
+        EchoServer echo;
+        echo.silent = true;
+        RttProber prober(QStringLiteral("lo"));
+        prober.setProbeTimeoutMs(100);
+        QVERIFY(prober.setTarget(echo.address(), RttProber::Protocol::Udp));
+        QSignalSpy finished(&prober, &RttProber::finished);
+        prober.start(3);
+        QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 1, 10000);
+        QVERIFY(echo.received >= 3);
+        QCOMPARE(prober.lost(RttProber::Path::Tunnel), 3);
+        QCOMPARE(prober.stats(RttProber::Path::Tunnel).count, 0);
+    }
+
+    // samples of another target or protocol must not mix into the same statistics
+    void setTargetClearsHistory() {
+        EchoServer echo;
+        RttProber prober(QStringLiteral("lo"));
+        prober.setProbeTimeoutMs(500);
+        QVERIFY(prober.setTarget(echo.address(), RttProber::Protocol::Udp));
+        QSignalSpy finished(&prober, &RttProber::finished);
+        prober.start(2);
+        QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 1, 10000);
+        const RttProber::Path tunnel = RttProber::Path::Tunnel;
+        QCOMPARE(prober.history(tunnel).size(), std::size_t(2));
+
+        // the same target again keeps what was measured
+        QVERIFY(prober.setTarget(echo.address(), RttProber::Protocol::Udp));
+        QCOMPARE(prober.history(tunnel).size(), std::size_t(2));
+
+        QVERIFY(prober.setTarget(echo.address(), RttProber::Protocol::Tcp));
+        QCOMPARE(prober.history(tunnel).size(), std::size_t(0));
+        QCOMPARE(prober.stats(tunnel).count, 0);
+
+        QVERIFY(prober.setTarget(echo.address(), RttProber::Protocol::Udp));
+        prober.start(2);
+        QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 2, 10000);
+        QCOMPARE(prober.history(tunnel).size(), std::size_t(2));
+        QVERIFY(prober.setTarget(QString("127.0.0.2:%1").arg(echo.port), RttProber::Protocol::Udp));
+        QCOMPARE(prober.history(tunnel).size(), std::size_t(0));
+    }
+
+private:
+    // min/median/p95 are the nearest-rank picks from the answered samples
+    void expectStatsOfHistory(const RttProber &prober, RttProber::Path path) {
+        const RttProber::History &h = prober.history(path);
+        QVector<quint32> got;
+        for (std::size_t i = 0; i < h.size(); ++i) {
+            if (h.at(i) != 0)
+                got.append(h.at(i));
+        }
+        QVERIFY(!got.isEmpty());
+        std::sort(got.begin(), got.end());
+        const int n = got.size();
+        const LatencyStats s = prober.stats(path);
+        QCOMPARE(s.min, got.first());
+        QCOMPARE(s.median, got.at((50 * n + 99) / 100 - 1));
+        QCOMPARE(s.p95, got.at((95 * n + 99) / 100 - 1));
+        QCOMPARE(s.max, got.last());
+        QVERIFY(s.min <= s.median && s.median <= s.p95 && s.p95 <= s.max);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestRttProber)
+
+#include "tst_rttprober.moc"
@@ -0,0 +1,225 @@
+#include "sessionmonitor.h"
+#include <QDBusConnectionInterface>
+#include <QDBusMessage>
+#include <QDBusObjectPath>
+#include <QProcess>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QtTest>
+
+namespace {
+    const QString kLogindService = QStringLiteral("org.freedesktop.login1");
+    const QString kLogindPath = QStringLiteral("/org/freedesktop/login1");
+    const QString kManagerInterface = QStringLiteral("org.freedesktop.login1.Manager");
+    const QString kSessionInterface = QStringLiteral("org.freedesktop.login1.Session");
+    const QString kSessionPath = QStringLiteral("/org/freedesktop/login1/session/c1");
+    const QString kFakeConnection = QStringLiteral("fake-logind");
+    const QString kClientConnection = QStringLiteral("session-monitor");
+
+    // anyone may own and call anything, nothing else is on this bus
+    const char kBusConfig[] =
+            "<!DOCTYPE busconfig PUBLIC \"-//freedesktop//DTD D-Bus Bus Configuration 1.0//EN\"\n"
+            " \"http://www.freedesktop.org/standards/dbus/1.0/busconfig.dtd\">\n"
+            "<busconfig>\n"
+            "  <type>session</type>\n"
+            "  <listen>unix:tmpdir=%1</listen>\n"
+            "  <policy context=\"default\">\n"
+            "    <allow send_destination=\"*\"/>\n"
+            "    <allow own=\"*\"/>\n"
+            "  </policy>\n"
+            "</busconfig>\n";
+}
+
+// the Manager calls SessionMonitor makes to find its session, signals are sent by the test
+class FakeLogindManager : public QObject {
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.freedesktop.login1.Manager")
+
+public:
+    int sessionLookups = 0;
+
+public slots:
+    QDBusObjectPath GetSession(const QString &) {
+        ++sessionLookups;
+        return QDBusObjectPath(kSessionPath);
+    }
+
+    QDBusObjectPath GetSessionByPID(uint) {
+        ++sessionLookups;
+        return QDBusObjectPath(kSessionPath);
+    }
+};
+
+// Runs SessionMonitor against a stand-in logind on a private dbus-daemon, so suspend and
+// lock can be driven without touching the real session.
+class TestSessionMonitor : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase() {
+        const QString daemon = QStandardPaths::findExecutable(QStringLiteral("dbus-daemon"));
+        if (daemon.isEmpty())
+            QSKIP("dbus-daemon not installed");
+        QVERIFY(dir.isValid());
+        QFile config(dir.filePath(QStringLiteral("bus.conf")));
+        QVERIFY(config.open(QIODevice::WriteOnly));
+        config.write(QString::fromLatin1(kBusConfig).arg(dir.path()).toUtf8());
+        config.close();
+
+        busDaemon.start(daemon, {"--config-file=" + config.fileName(), "--nofork", "--print-address=1"});
+        QVERIFY(busDaemon.waitForStarted());
+        while (!busDaemon.canReadLine())
+            QVERIFY(busDaemon.waitForReadyRead(5000));
+        const QString address = QString::fromUtf8(busDaemon.readLine()).trimmed();
+        QVERIFY(!address.isEmpty());
+
+        QDBusConnection fake = QDBusConnection::connectToBus(address, kFakeConnection);
+        QVERIFY(fake.isConnected());
+        QVERIFY(fake.registerObject(kLogindPath, &manager, QDBusConnection::ExportAllSlots));
+        QVERIFY(fake.interface()->registerService(kLogindService).isValid());
+        QVERIFY(QDBusConnection::connectToBus(address, kClientConnection).isConnected());
+
+        // GetSession rather than GetSessionByPID
+        qputenv("XDG_SESSION_ID", "c1");
+    }
+
+    void cleanupTestCase() {
+        QDBusConnection::disconnectFromBus(kClientConnection);
+        QDBusConnection::disconnectFromBus(kFakeConnection);
+        if (busDaemon.state() != QProcess::NotRunning) {
+            busDaemon.terminate();
+            busDaemon.waitForFinished(3000);
+        }
+    }
+
+    void looksUpSession() {
+        const int before = manager.sessionLookups;
+        SessionMonitor monitor(QDBusConnection(kClientConnection));
+        QTRY_COMPARE(manager.sessionLookups, before + 1);
+        QVERIFY(!monitor.isPaused());
+    }
+
+    void sleepPausesAtOnce() {
+        SessionMonitor monitor(QDBusConnection(kClientConnection));
+        QSignalSpy paused(&monitor, &SessionMonitor::pausedChanged);
+        sendPrepareForSleep(true);
+        QTRY_COMPARE(paused.count(), 1);
+        QCOMPARE(paused.at(0).at(0).toBool(), true);
+        QVERIFY(monitor.isSleeping());
+        QVERIFY(monitor.isPaused());
+    }
+
+    void resumeIsDebounced() {
+        SessionMonitor monitor(QDBusConnection(kClientConnection));
+        QSignalSpy paused(&monitor, &SessionMonitor::pausedChanged);
+        sendPrepareForSleep(true);
+        QTRY_COMPARE(paused.count(), 1);
+        sendPrepareForSleep(false);
+        QTRY_VERIFY(!monitor.isSleeping());
+        // still paused for the debounce after waking up
+        QVERIFY(monitor.isPaused());
+        QCOMPARE(paused.count(), 1);
+        QTRY_COMPARE(paused.count(), 2);
+        QCOMPARE(paused.at(1).at(0).toBool(), false);
+    }
+
+    // Lock only asks the locker to lock, logind sends no Unlock when the user unlocks there;
+    // pausing on it would never end with lockers that don't report LockedHint
+    void lockRequestAloneDoesNotPause() {
+        SessionMonitor monitor(QDBusConnection(kClientConnection));
+        QVERIFY(waitForSession(monitor));
+        QSignalSpy paused(&monitor, &SessionMonitor::pausedChanged);
+        sendSessionSignal(QStringLiteral("Lock"));
+        QTest::qWait(500);
+        QCOMPARE(paused.count(), 0);
+        QVERIFY(!monitor.isLocked());
+        QVERIFY(!monitor.isPaused());
+    }
+
+    void lockedHint() {
+        SessionMonitor monitor(QDBusConnection(kClientConnection));
+        QVERIFY(waitForSession(monitor));
+        QSignalSpy paused(&monitor, &SessionMonitor::pausedChanged);
+        sendLockedHint(true);
+        QTRY_COMPARE(paused.count(), 1);
+        QVERIFY(monitor.isLocked());
+        sendLockedHint(false);
+        QTRY_COMPARE(paused.count(), 2);
+        QVERIFY(!monitor.isPaused());
+    }
+
+    // opening the lid wakes up and unlocks within moments, that is one resume and not two
+    void wakeAndUnlockCoalesced() {
+        SessionMonitor monitor(QDBusConnection(kClientConnection));
+        QVERIFY(waitForSession(monitor));
+        QSignalSpy paused(&monitor, &SessionMonitor::pausedChanged);
+        sendLockedHint(true);
+        sendPrepareForSleep(true);
+        QTRY_VERIFY(monitor.isSleeping());
+        sendPrepareForSleep(false);
+        sendLockedHint(false);
+        QTRY_COMPARE(paused.count(), 2);
+        QCOMPARE(paused.at(0).at(0).toBool(), true);
+        QCOMPARE(paused.at(1).at(0).toBool(), false);
+        QTest::qWait(500);
+        QCOMPARE(paused.count(), 2);
+    }
+
+    // only logind's own signals count, not the same signal from another peer
+    void ignoresOtherSenders() {
+        SessionMonitor monitor(QDBusConnection(kClientConnection));
+        QSignalSpy paused(&monitor, &SessionMonitor::pausedChanged);
+        QDBusMessage msg = QDBusMessage::createSignal(kLogindPath, kManagerInterface,
+                                                      QStringLiteral("PrepareForSleep"));
+        msg << true;
+        QVERIFY(QDBusConnection(kClientConnection).send(msg));
+        QTest::qWait(300);
+        QCOMPARE(paused.count(), 0);
+    }
+
+private:
+    static void send(const QDBusMessage &msg) {
+        QVERIFY(QDBusConnection(kFakeConnection).send(msg));
+    }
+
+    static void sendPrepareForSleep(bool start) {
+        QDBusMessage msg = QDBusMessage::createSignal(kLogindPath, kManagerInterface,
+                                                      QStringLiteral("PrepareForSleep"));
+        msg << start;
+        send(msg);
+    }
+
+    static void sendSessionSignal(const QString &name) {
+        send(QDBusMessage::createSignal(kSessionPath, kSessionInterface, name));
+    }
+
+    static void sendLockedHint(bool locked) {
+        QDBusMessage msg = QDBusMessage::createSignal(kSessionPath, QStringLiteral("org.freedesktop.DBus.Properties"),
+                                                      QStringLiteral("PropertiesChanged"));
+        msg << kSessionInterface << QVariantMap{{QStringLiteral("LockedHint"), locked}} << QStringList();
+        send(msg);
+    }
+
+    // The session signals are subscribed once the GetSession reply is back. Report locked until
+    // it is seen, then unlocked and let the resume go through, so the test starts unpaused.
+    static bool waitForSession(SessionMonitor &monitor) {
+        for (int i = 0; i < 100 && !monitor.isLocked(); ++i) {
+            sendLockedHint(true);
+            QTest::qWait(20);
+        }
+        if (!monitor.isLocked())
+            return false;
+        sendLockedHint(false);
+        for (int i = 0; i < 100 && monitor.isPaused(); ++i)
+            QTest::qWait(20);
+        return !monitor.isPaused();
+    }
+
+    QTemporaryDir dir;
+    QProcess busDaemon;
+    FakeLogindManager manager;
+};
+
+QTEST_GUILESS_MAIN(TestSessionMonitor)
+
+#include "tst_sessionmonitor.moc"
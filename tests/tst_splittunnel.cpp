@@ -0,0 +1,72 @@
+#include "splittunnel.h"
+#include <QtTest>
+
+namespace {
+    // as printed by warp-cli tunnel ip list / tunnel host list
+    const char kIpList[] = "Excluded IPs:\n"
+            "  10.0.0.0/24\n"
+            "  192.168.0.0/16\n";
+    const char kHostList[] = "Excluded hosts:\n"
+            "  example.com\n"
+            "  old.example.net\n";
+}
+
+class TestSplitTunnel : public QObject {
+    Q_OBJECT
+
+private slots:
+    void planDiffsAgainstDaemon() {
+        const QStringList import = {
+            "10.0.0.0/25",
+            "10.0.0.128/25  # office",
+            "# comment",
+            "",
+            "Example.COM",
+            "*.corp.example.org",
+            "not a host!",
+        };
+        const SplitTunnel::Plan plan = SplitTunnel::plan(import, kIpList, kHostList);
+        QCOMPARE(plan.importedEntries, 4);
+        QCOMPARE(plan.ignoredLines, 1);
+        QCOMPARE(plan.aggregatedIps, 1);
+        // the two halves are the /24 the daemon already has
+        QCOMPARE(plan.addIps, QStringList());
+        QCOMPARE(plan.removeIps, QStringList{"192.168.0.0/16"});
+        QCOMPARE(plan.addHosts, QStringList{"*.corp.example.org"});
+        QCOMPARE(plan.removeHosts, QStringList{"old.example.net"});
+        QVERIFY(!plan.isEmpty());
+    }
+
+    void planInSyncIsEmpty() {
+        const QStringList import = {"192.168.0.0/16", "10.0.0.0/24", "example.com", "old.example.net"};
+        const SplitTunnel::Plan plan = SplitTunnel::plan(import, kIpList, kHostList);
+        QVERIFY(plan.isEmpty());
+        QVERIFY(SplitTunnel::commands(plan).isEmpty());
+    }
+
+    void planFromEmptyDaemon() {
+        const SplitTunnel::Plan plan = SplitTunnel::plan({"10.1.2.3/8", "2001:db8::/32"}, QString(), QString());
+        QCOMPARE(plan.addIps, (QStringList{"10.0.0.0/8", "2001:db8::/32"}));
+        QVERIFY(plan.removeIps.isEmpty());
+    }
+
+    void commandsRemoveFirst() {
+        SplitTunnel::Plan plan;
+        plan.addIps = QStringList{"10.0.0.0/8"};
+        plan.removeIps = QStringList{"10.0.0.0/9"};
+        plan.addHosts = QStringList{"new.example.com"};
+        plan.removeHosts = QStringList{"old.example.com"};
+        const QVector<CommandBatch::Command> cmds = SplitTunnel::commands(plan);
+        QCOMPARE(cmds.size(), 4);
+        for (const CommandBatch::Command &cmd : cmds)
+            QCOMPARE(cmd.program, QStringLiteral("warp-cli"));
+        QCOMPARE(cmds.at(0).arguments, (QStringList{"tunnel", "ip", "remove", "10.0.0.0/9"}));
+        QCOMPARE(cmds.at(1).arguments, (QStringList{"tunnel", "host", "remove", "old.example.com"}));
+        QCOMPARE(cmds.at(2).arguments, (QStringList{"tunnel", "ip", "add", "10.0.0.0/8"}));
+        QCOMPARE(cmds.at(3).arguments, (QStringList{"tunnel", "host", "add", "new.example.com"}));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestSplitTunnel)
+
+#include "tst_splittunnel.moc"
@@ -0,0 +1,208 @@
+#include "tunnelwatchdog.h"
+#include <QDir>
+#include <QProcess>
+#include <QScopeGuard>
+#include <QTemporaryDir>
+#include <QTimer>
+#include <QtTest>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+    const QString kIface = QStringLiteral("wqtest0");
+
+    bool ipLink(const QStringList &args) {
+        return QProcess::execute(QStringLiteral("ip"), QStringList{"link"} + args) == 0;
+    }
+}
+
+// drives the watchdog through a fake /sys/class/net tree: the test writes the
+// counters a tunnel would show, the watchdog reads them through its own descriptors
+class TestTunnelWatchdog : public QObject {
+    Q_OBJECT
+
+private slots:
+    void init() {
+        QVERIFY(dir.isValid());
+        rxPackets = txPackets = 0;
+        rxFlowing = false;
+        createInterface();
+        traffic.setInterval(10);
+        connect(&traffic, &QTimer::timeout, this, &TestTunnelWatchdog::tick, Qt::UniqueConnection);
+    }
+
+    void cleanup() {
+        traffic.stop();
+    }
+
+    void idleIsNotStalled() {
+        TunnelWatchdog dog(kIface);
+        configure(dog);
+        QSignalSpy stalls(&dog, &TunnelWatchdog::stallDetected);
+        dog.start();
+        QVERIFY(dog.isRunning());
+        QTest::qWait(300);
+        QCOMPARE(stalls.count(), 0);
+    }
+
+    void stallAndRecovery() {
+        TunnelWatchdog dog(kIface);
+        configure(dog);
+        QSignalSpy stalls(&dog, &TunnelWatchdog::stallDetected);
+        QSignalSpy cleared(&dog, &TunnelWatchdog::stallCleared);
+        dog.start();
+
+        // sending, nothing coming back
+        traffic.start();
+        QTRY_COMPARE(stalls.count(), 1);
+        QVERIFY(dog.isStalled());
+        QVERIFY(stalls.at(0).at(0).toInt() >= 100);
+
+        rxFlowing = true;
+        QTRY_COMPARE(cleared.count(), 1);
+        QVERIFY(!dog.isStalled());
+        QTest::qWait(200);
+        QCOMPARE(stalls.count(), 1);
+    }
+
+    // a reconnect deletes and recreates the interface under the same name
+    void interfaceRecreated() {
+        TunnelWatchdog dog(kIface);
+        configure(dog);
+        QSignalSpy stalls(&dog, &TunnelWatchdog::stallDetected);
+        QSignalSpy cleared(&dog, &TunnelWatchdog::stallCleared);
+        dog.start();
+        traffic.start();
+        QTRY_COMPARE(stalls.count(), 1);
+
+        traffic.stop();
+        removeInterface();
+        QTRY_COMPARE(cleared.count(), 1);
+        QVERIFY(!dog.isStalled());
+        QTest::qWait(100);
+        QVERIFY(dog.isRunning());
+
+        // the new counters start from zero and are only seen through freshly opened descriptors
+        rxPackets = txPackets = 0;
+        createInterface();
+        traffic.start();
+        QTRY_COMPARE(stalls.count(), 2);
+        QVERIFY(dog.isStalled());
+    }
+
+    void stopClearsStall() {
+        TunnelWatchdog dog(kIface);
+        configure(dog);
+        QSignalSpy cleared(&dog, &TunnelWatchdog::stallCleared);
+        dog.start();
+        traffic.start();
+        QTRY_VERIFY(dog.isStalled());
+        dog.stop();
+        QCOMPARE(cleared.count(), 1);
+        QVERIFY(!dog.isRunning());
+    }
+
+    void missingInterface() {
+        removeInterface();
+        TunnelWatchdog dog(kIface);
+        configure(dog);
+        dog.start();
+        QVERIFY(!dog.isRunning());
+    }
+
+    // the same against a real dummy interface, whose tx grows while rx never does
+    void realInterface() {
+        if (!ipLink({"add", kIface, "type", "dummy"}))
+            QSKIP("creating a dummy interface needs CAP_NET_ADMIN");
+        auto cleanupLink = qScopeGuard([] { ipLink({"del", kIface}); });
+        QVERIFY(bringUp());
+
+        TunnelWatchdog dog(kIface);
+        dog.setIntervalMs(50);
+        dog.setStallWindowMs(200);
+        QSignalSpy stalls(&dog, &TunnelWatchdog::stallDetected);
+        QSignalSpy cleared(&dog, &TunnelWatchdog::stallCleared);
+        dog.start();
+        QVERIFY(dog.isRunning());
+
+        const int fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        QVERIFY(fd >= 0);
+        auto closeSocket = qScopeGuard([fd] { ::close(fd); });
+        sockaddr_in peer{};
+        peer.sin_family = AF_INET;
+        peer.sin_port = htons(9);
+        inet_pton(AF_INET, "198.18.255.2", &peer.sin_addr);
+        QTimer sender;
+        sender.setInterval(10);
+        connect(&sender, &QTimer::timeout, this, [&] {
+            ::sendto(fd, "x", 1, 0, reinterpret_cast<sockaddr *>(&peer), sizeof(peer));
+        });
+        sender.start();
+        QTRY_COMPARE_WITH_TIMEOUT(stalls.count(), 1, 5000);
+
+        QVERIFY(ipLink({"del", kIface}));
+        QTRY_COMPARE(cleared.count(), 1);
+        QVERIFY(ipLink({"add", kIface, "type", "dummy"}));
+        QVERIFY(bringUp());
+        QTRY_COMPARE_WITH_TIMEOUT(stalls.count(), 2, 5000);
+    }
+
+private:
+    void configure(TunnelWatchdog &dog) {
+        dog.setSysfsRoot(dir.path());
+        dog.setIntervalMs(20);
+        dog.setStallWindowMs(100);
+    }
+
+    QString statisticsDir() const {
+        return dir.filePath(kIface + "/statistics");
+    }
+
+    void createInterface() {
+        QVERIFY(QDir().mkpath(statisticsDir()));
+        writeCounters();
+    }
+
+    // open descriptors read an empty attribute, the way sysfs fails them once the device is gone
+    void removeInterface() {
+        for (const char *name : {"rx_bytes", "tx_bytes", "rx_packets", "tx_packets"}) {
+            QFile f(statisticsDir() + '/' + name);
+            QVERIFY(f.open(QIODevice::WriteOnly | QIODevice::Truncate));
+        }
+        QVERIFY(QDir(dir.filePath(kIface)).removeRecursively());
+    }
+
+    void writeCounters() {
+        const quint64 values[] = {rxPackets * 100, txPackets * 100, rxPackets, txPackets};
+        const char *names[] = {"rx_bytes", "tx_bytes", "rx_packets", "tx_packets"};
+        for (int i = 0; i < 4; ++i) {
+            QFile f(statisticsDir() + '/' + names[i]);
+            QVERIFY(f.open(QIODevice::WriteOnly | QIODevice::Truncate));
+            f.write(QByteArray::number(values[i]) + '\n');
+        }
+    }
+
+    void tick() {
+        txPackets += 5;
+        if (rxFlowing)
+            rxPackets += 5;
+        writeCounters();
+    }
+
+    static bool bringUp() {
+        return QProcess::execute("ip", {"addr", "add", "198.18.255.1/30", "dev", kIface}) == 0
+               && ipLink({"set", kIface, "up"});
+    }
+
+    QTemporaryDir dir;
+    QTimer traffic;
+    quint64 rxPackets = 0;
+    quint64 txPackets = 0;
+    bool rxFlowing = false;
+};
+
+QTEST_GUILESS_MAIN(TestTunnelWatchdog)
+
+#include "tst_tunnelwatchdog.moc"
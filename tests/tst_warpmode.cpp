@@ -0,0 +1,67 @@
+#include "warpmode.h"
+#include <QtTest>
+
+class TestWarpMode : public QObject {
+    Q_OBJECT
+
+private slots:
+    // every name in the table finds its own row through the hash
+    void namesRoundTrip() {
+        for (const WarpModes::Info &info : WarpModes::kTable) {
+            if (info.daemonName)
+                QCOMPARE(WarpModes::fromDaemonName(QString::fromLatin1(info.daemonName)), info.mode);
+            if (info.cliName) {
+                QCOMPARE(WarpModes::fromCliName(QString::fromLatin1(info.cliName)), info.mode);
+                QCOMPARE(WarpModes::cliName(info.mode), QString::fromLatin1(info.cliName));
+            } else {
+                QVERIFY(WarpModes::cliName(info.mode).isEmpty());
+            }
+            QCOMPARE(WarpModes::label(info.mode), QString::fromLatin1(info.label));
+        }
+    }
+
+    void knownNames() {
+        QCOMPARE(WarpModes::fromDaemonName("WarpProxy"), WarpMode::Proxy);
+        QCOMPARE(WarpModes::fromDaemonName("WarpWithDnsOverTls"), WarpMode::WarpWithDnsOverTls);
+        QCOMPARE(WarpModes::fromCliName("warp+doh"), WarpMode::WarpWithDnsOverHttps);
+        QCOMPARE(WarpModes::fromCliName("tunnel_only"), WarpMode::TunnelOnly);
+    }
+
+    void unknownNames_data() {
+        QTest::addColumn<QString>("name");
+        QTest::newRow("empty") << QString();
+        QTest::newRow("wrong case") << "WARP";
+        QTest::newRow("trailing space") << "warp ";
+        // same length and first/last character as a real name, so it lands in that slot
+        QTest::newRow("slot collision") << "wxrp";
+        QTest::newRow("daemon name") << "WarpProxy";
+        QTest::newRow("non-latin") << QString::fromUtf8("wärp");
+    }
+
+    void unknownNames() {
+        QFETCH(QString, name);
+        QCOMPARE(WarpModes::fromCliName(name), WarpMode::Unknown);
+    }
+
+    void cliNamesAreNotDaemonNames() {
+        QCOMPARE(WarpModes::fromDaemonName("proxy"), WarpMode::Unknown);
+        QCOMPARE(WarpModes::fromDaemonName("PostureOnly"), WarpMode::PostureOnly);
+        QCOMPARE(WarpModes::fromCliName("PostureOnly"), WarpMode::Unknown);
+    }
+
+    void codes() {
+        for (quint8 code = 0; code < WarpModes::kCount; ++code)
+            QCOMPARE(static_cast<quint8>(WarpModes::fromCode(code)), code);
+        QCOMPARE(WarpModes::fromCode(static_cast<quint8>(WarpModes::kCount)), WarpMode::Unknown);
+        QCOMPARE(WarpModes::fromCode(0xff), WarpMode::Unknown);
+    }
+
+    void infoOutOfRange() {
+        QCOMPARE(WarpModes::info(static_cast<WarpMode>(200)).mode, WarpMode::Unknown);
+        QCOMPARE(WarpModes::label(static_cast<WarpMode>(200)), QStringLiteral("Unknown"));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestWarpMode)
+
+#include "tst_warpmode.moc"